@@ -3,6 +3,8 @@
 //
 #include <chrono>
 #include <thread>
+#include <algorithm>
+#include <iterator>
 
 #include "Renderer/DeviceContext.h"
 #include "Renderer/model.h"
@@ -16,6 +18,9 @@
 #include "Renderer/OffscreenRenderer.h"
 
 #include "Scene.h"
+#if USE_PHYSICS_THREAD
+#include "PhysicsThread.h"
+#endif
 
 Application * g_application = NULL;
 
@@ -93,6 +98,12 @@ void Application::Initialize() {
 
 	m_isPaused = true;
 	m_stepFrame = false;
+
+#if USE_PHYSICS_THREAD
+	m_physicsThread = new PhysicsThread;
+	m_physicsThread->SetPaused( m_isPaused );
+	m_physicsThread->Start( m_scene );
+#endif
 }
 
 /*
@@ -285,6 +296,12 @@ void Application::Cleanup() {
 	m_copyPipeline.Cleanup( &m_deviceContext );
 	m_modelFullScreen.Cleanup( m_deviceContext );
 
+#if USE_PHYSICS_THREAD
+	// The thread steps the scene, so it has to stop first
+	delete m_physicsThread;
+	m_physicsThread = NULL;
+#endif
+
 	// Delete the screen so that it can clean itself up
 	delete m_scene;
 	m_scene = NULL;
@@ -432,7 +449,11 @@ Application::Keyboard
 */
 void Application::Keyboard( int key, int scancode, int action, int modifiers ) {
 	if ( GLFW_KEY_R == key && GLFW_RELEASE == action ) {
+#if USE_PHYSICS_THREAD
+		m_physicsThread->RequestReset();
+#else
 		m_scene->Reset();
+#endif
 	}
 	if ( GLFW_KEY_T == key && GLFW_RELEASE == action ) {
 		m_isPaused = !m_isPaused;
@@ -471,6 +492,45 @@ void Application::MainLoop() {
 		// Get User Input
 		glfwPollEvents();
 
+#if USE_PHYSICS_THREAD
+		// The physics thread steps the scene at its own rate, only pass the input on
+		if ( m_isPaused ) {
+			if ( m_stepFrame ) {
+				m_physicsThread->RequestStep();
+				m_stepFrame = false;
+			}
+		}
+		m_physicsThread->SetPaused( m_isPaused );
+#elif USE_FIXED_STEP
+		// The scene steps at its own fixed rate, and guards against
+		// falling behind itself, so the frame time is passed through as is.
+		float elapsed_sec = dt_us * 0.001f * 0.001f;
+		if ( m_isPaused ) {
+			elapsed_sec = 0.0f;
+			if ( m_stepFrame ) {
+				elapsed_sec = m_scene->m_fixedDt;
+				m_stepFrame = false;
+			}
+			numSamples = 0;
+			maxTime = 0.0f;
+		}
+
+		if ( elapsed_sec > 0.0f ) {
+			int startTime = GetTimeMicroseconds();
+			const int numSteps = m_scene->Step( elapsed_sec );
+			int endTime = GetTimeMicroseconds();
+
+			dt_us = (float)endTime - (float)startTime;
+			if ( dt_us > maxTime ) {
+				maxTime = dt_us;
+			}
+
+			avgTime = ( avgTime * float( numSamples ) + dt_us ) / float( numSamples + 1 );
+			numSamples++;
+
+			printf( "frame dt_ms: %.2f %.2f %.2f steps: %i", avgTime * 0.001f, maxTime * 0.001f, dt_us * 0.001f, numSteps );
+		}
+#else
 		// If the time is greater than 33ms (30fps)
 		// then force the time difference to smaller
 		// to prevent super large simulation steps.
@@ -510,6 +570,7 @@ void Application::MainLoop() {
 
 			printf( "frame dt_ms: %.2f %.2f %.2f", avgTime * 0.001f, maxTime * 0.001f, dt_us * 0.001f );
 		}
+#endif
 
 		// Draw the Scene
 		DrawFrame();
@@ -535,6 +596,11 @@ void Application::UpdateUniforms() {
 		Mat4 pad1;
 	};
 	camera_t camera;
+#if USE_SCENE_QUERY
+	// Bodies outside of both views are culled, the shadow camera needs the ones off screen that cast into it
+	frustum_t viewFrustum;
+	frustum_t shadowFrustum;
+#endif
 
 	//
 	//	Update the uniform buffers
@@ -568,9 +634,11 @@ void Application::UpdateUniforms() {
 			const float fovy	= 45.0f;
 			const float aspect	= (float)windowHeight / (float)windowWidth;
 			camera.matProj.PerspectiveVulkan( fovy, aspect, zNear, zFar );
-			camera.matProj = camera.matProj.Transpose();
-
 			camera.matView.LookAt( camPos, camLookAt, camUp );
+#if USE_SCENE_QUERY
+			viewFrustum = frustum_t( camera.matProj, camera.matView, 1.0f );
+#endif
+			camera.matProj = camera.matProj.Transpose();
 			camera.matView = camera.matView.Transpose();
 
 			// Update the uniform buffer for the camera matrices
@@ -605,9 +673,11 @@ void Application::UpdateUniforms() {
 			const float zNear	= 25.0f;
 			const float zFar	= 175.0f;
 			camera.matProj.OrthoVulkan( xmin, xmax, ymin, ymax, zNear, zFar );
-			camera.matProj = camera.matProj.Transpose();
-
 			camera.matView.LookAt( camPos, camLookAt, camUp );
+#if USE_SCENE_QUERY
+			shadowFrustum = frustum_t( camera.matProj, camera.matView, 1.0f );
+#endif
+			camera.matProj = camera.matProj.Transpose();
 			camera.matView = camera.matView.Transpose();
 
 			// Update the uniform buffer for the camera matrices
@@ -622,14 +692,69 @@ void Application::UpdateUniforms() {
 		//
 		//	Update the uniform buffer with the body positions/orientations
 		//
-		for ( int i = 0; i < m_scene->m_bodies.size(); i++ ) {
+#if USE_PHYSICS_THREAD
+		// Never touch the scene here, the physics thread owns it
+		const sceneSnapshot_t & snapshot = m_physicsThread->AcquireSnapshot();
+		const float alpha = snapshot.GetAlpha( PhysicsThread::GetTimeSeconds() );
+		printf( "physics steps: %lli step_ms: %.2f    ", snapshot.numSteps, snapshot.stepMS );
+#endif
+#if USE_SCENE_QUERY
+		std::vector< int > visible;
+		std::vector< int > shadowCasters;
+		std::vector< int > drawn;
+#if USE_PHYSICS_THREAD
+		// The snapshot's bounds cover both of the steps its bodies are blended between
+		snapshot.QueryFrustum( viewFrustum, visible );
+		snapshot.QueryFrustum( shadowFrustum, shadowCasters );
+#else
+		// The trees hold the bodies as of the last step, they're drawn up to a step
+		// behind that, which the one unit margin of the frustums covers
+		m_scene->QueryFrustum( viewFrustum, visible );
+		m_scene->QueryFrustum( shadowFrustum, shadowCasters );
+#endif
+		std::set_union( visible.begin(), visible.end(), shadowCasters.begin(), shadowCasters.end(), std::back_inserter( drawn ) );
+		const int numBodies = (int)drawn.size();
+#elif USE_PHYSICS_THREAD
+		const int numBodies = snapshot.GetNumBodies();
+#else
+		const int numBodies = (int)m_scene->m_bodies.size();
+#endif
+		for ( int n = 0; n < numBodies; n++ ) {
+#if USE_SCENE_QUERY
+			const int i = drawn[ n ];
+#else
+			const int i = n;
+#endif
+#if USE_PHYSICS_THREAD
+			// Bodies added since the models were last made wait for them
+			if ( i >= (int)m_models.size() || !snapshot.IsAlive( i ) ) {
+				continue;
+			}
+
+			Vec3 pos;
+			Quat orient;
+			snapshot.GetTransform( i, alpha, pos, orient );
+#else
+#if USE_BODY_POOL
+			if ( !m_scene->m_bodies.IsAlive( i ) ) {
+				continue;
+			}
+#endif
+
 			Body & body = m_scene->m_bodies[ i ];
 
-			Vec3 fwd = body.m_orientation.RotatePoint( Vec3( 1, 0, 0 ) );
-			Vec3 up = body.m_orientation.RotatePoint( Vec3( 0, 0, 1 ) );
+			Vec3 pos = body.m_position;
+			Quat orient = body.m_orientation;
+#if USE_FIXED_STEP
+			m_scene->GetInterpolatedTransform( i, pos, orient );
+#endif
+#endif
+
+			Vec3 fwd = orient.RotatePoint( Vec3( 1, 0, 0 ) );
+			Vec3 up = orient.RotatePoint( Vec3( 0, 0, 1 ) );
 
 			Mat4 matOrient;
-			matOrient.Orient( body.m_position, fwd, up );
+			matOrient.Orient( pos, fwd, up );
 			matOrient = matOrient.Transpose();
 
 			// Update the uniform buffer with the orientation of this body
@@ -639,8 +764,8 @@ void Application::UpdateUniforms() {
 			renderModel.model = m_models[ i ];
 			renderModel.uboByteOffset = uboByteOffset;
 			renderModel.uboByteSize = sizeof( matOrient );
-			renderModel.pos = body.m_position;
-			renderModel.orient = body.m_orientation;
+			renderModel.pos = pos;
+			renderModel.orient = orient;
 			m_renderModels.push_back( renderModel );
 
 			uboByteOffset += m_deviceContext.GetAligendUniformByteOffset( sizeof( matOrient ) );
@@ -26,7 +26,7 @@ Application
 */
 class Application {
 public:
-	Application() : m_isPaused( true ), m_stepFrame( false ) {}
+	Application() : m_physicsThread( NULL ), m_isPaused( true ), m_stepFrame( false ) {}
 	~Application();
 
 	void Initialize();
@@ -52,6 +52,7 @@ private:
 
 private:
 	class Scene * m_scene;
+	class PhysicsThread * m_physicsThread;	// only used when built with USE_PHYSICS_THREAD
 
 	GLFWwindow * m_glfwWindow;
 
@@ -484,6 +484,22 @@ bool Model::BuildFromShape( const Shape * shape ) {
 			m_indices.push_back( hullTris[ i ].b );
 			m_indices.push_back( hullTris[ i ].c );
 		}
+	} else {
+		// Shapes without a dedicated mesh are drawn as their model space bounds
+		const Bounds bounds = shape->GetBounds();
+
+		m_vertices.clear();
+		m_indices.clear();
+
+		FillCubeTessellated( *this, 0 );
+		Vec3 halfdim = ( bounds.maxs - bounds.mins ) * 0.5f;
+		Vec3 center = ( bounds.maxs + bounds.mins ) * 0.5f;
+		for ( int v = 0; v < m_vertices.size(); v++ ) {
+			for ( int i = 0; i < 3; i++ ) {
+				m_vertices[ v ].xyz[ i ] *= halfdim[ i ];
+				m_vertices[ v ].xyz[ i ] += center[ i ];
+			}
+		}
 	}
 
 	return true;
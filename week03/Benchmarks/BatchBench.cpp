@@ -0,0 +1,119 @@
+//
+//  BatchBench.cpp
+//
+//  Steps a batch of independent copies of a scene preset with a growing number
+//  of threads, and reports the throughput of each as JSON.  Every copy must
+//  end up exactly where a copy stepped on its own does.
+//
+//  usage: week03_batch_bench [--scene name] [--scenes N] [--frames N] [--threads N]
+//      --threads is the most threads to try, the default is every hardware thread
+//
+#include "SceneBatch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+/*
+====================================================
+HashScene
+
+Sums the body positions, enough to tell two runs apart
+====================================================
+*/
+static double HashScene( const Scene & scene ) {
+    double hash = 0.0;
+    for ( int i = 0; i < scene.m_bodies.size(); i++ ) {
+        if ( !scene.m_bodies.IsAlive( i ) ) {
+            continue;
+        }
+        const Vec3 & pos = scene.m_bodies[ i ].m_position;
+        hash += pos.x + pos.y * 3.0 + pos.z * 7.0;
+    }
+    return hash;
+}
+
+/*
+====================================================
+main
+====================================================
+*/
+int main( int argc, char ** argv ) {
+    const char * preset = "default";
+    int numScenes = 64;
+    int numFrames = 120;
+    int maxThreads = (int)std::thread::hardware_concurrency();
+    const float dt = 1.0f / 60.0f;
+
+    for ( int i = 1; i < argc; i++ ) {
+        const bool hasValue = ( i + 1 < argc );
+        if ( 0 == strcmp( argv[ i ], "--scene" ) && hasValue ) {
+            preset = argv[ ++i ];
+        } else if ( 0 == strcmp( argv[ i ], "--scenes" ) && hasValue ) {
+            numScenes = atoi( argv[ ++i ] );
+        } else if ( 0 == strcmp( argv[ i ], "--frames" ) && hasValue ) {
+            numFrames = atoi( argv[ ++i ] );
+        } else if ( 0 == strcmp( argv[ i ], "--threads" ) && hasValue ) {
+            maxThreads = atoi( argv[ ++i ] );
+        } else {
+            fprintf( stderr, "usage: %s [--scene name] [--scenes N] [--frames N] [--threads N]\n", argv[ 0 ] );
+            return 1;
+        }
+    }
+    if ( maxThreads < 1 ) {
+        maxThreads = 1;
+    }
+
+    FillDiamond();
+
+    // The reference every copy in the batches is checked against
+    Scene reference;
+    if ( !reference.SetPreset( preset ) ) {
+        fprintf( stderr, "unknown scene preset '%s'\n", preset );
+        return 1;
+    }
+    reference.Reset();
+    for ( int frame = 0; frame < numFrames; frame++ ) {
+        reference.Update( dt );
+    }
+    const double referenceHash = HashScene( reference );
+
+    printf( "{\n  \"scene\": \"%s\",\n  \"scenes\": %d,\n  \"frames\": %d,\n  \"runs\": [\n", preset, numScenes, numFrames );
+    bool isDeterministic = true;
+    double singleThreadMS = 0.0;
+    for ( int numThreads = 1; numThreads <= maxThreads; numThreads *= 2 ) {
+        SceneBatch batch( numThreads );
+        for ( int i = 0; i < numScenes; i++ ) {
+            batch.AddScene( preset );
+        }
+        batch.Reset();
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for ( int frame = 0; frame < numFrames; frame++ ) {
+            batch.Update( dt );
+        }
+        const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        const double wallMS = std::chrono::duration< double, std::milli >( end - start ).count();
+        if ( 1 == numThreads ) {
+            singleThreadMS = wallMS;
+        }
+
+        int numDiverged = 0;
+        for ( int i = 0; i < numScenes; i++ ) {
+            if ( HashScene( *batch.GetScene( i ) ) != referenceHash ) {
+                numDiverged++;
+            }
+        }
+        isDeterministic = isDeterministic && ( 0 == numDiverged );
+
+        const double sceneSteps = (double)numScenes * numFrames;
+        fprintf( stderr, "%d threads: %.1f ms\n", numThreads, wallMS );
+        printf( "    { \"threads\": %d, \"wall_ms\": %.3f, \"scene_steps_per_second\": %.1f, \"speedup\": %.3f, \"diverged_scenes\": %d }%s\n",
+            numThreads, wallMS, sceneSteps * 1000.0 / wallMS, singleThreadMS / wallMS, numDiverged, ( numThreads * 2 <= maxThreads ) ? "," : "" );
+    }
+    printf( "  ]\n}\n" );
+
+    return isDeterministic ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+//
+//  BroadPhaseBench.cpp
+//
+//  Compares the broadphase backends on sphere rain: a cloud of equally sized
+//  spheres falling onto a static ground box.
+//
+//  usage: week03_broadphase_bench [numSpheres] [numFrames]
+//
+#include "Physics/Broadphase.h"
+#include "Physics/Shapes.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+/*
+====================================================
+BuildSphereRain
+====================================================
+*/
+static void BuildSphereRain( BodyPool & bodies, const int numSpheres, Shape * sphere, Shape * ground ) {
+    bodies.clear();
+
+    Body body;
+    body.m_position = Vec3( 0, 0, -1 );
+    body.m_orientation = Quat( 0, 0, 0, 1 );
+    body.m_invMass = 0.0f;
+    body.m_shape = ground;
+    bodies.Add( body );
+
+    // A fixed seed, so every backend sees the same scene
+    srand( 1337 );
+    const int side = 1 + (int)cbrtf( (float)numSpheres );
+    for ( int i = 0; i < numSpheres; i++ ) {
+        const float jitterX = (float)rand() / RAND_MAX - 0.5f;
+        const float jitterY = (float)rand() / RAND_MAX - 0.5f;
+        const float x = (float)( i % side ) * 1.2f + jitterX * 0.2f;
+        const float y = (float)( ( i / side ) % side ) * 1.2f + jitterY * 0.2f;
+        const float z = (float)( i / ( side * side ) ) * 1.2f + 2.0f;
+
+        body.m_position = Vec3( x - side * 0.6f, y - side * 0.6f, z );
+        body.m_linearVelocity = Vec3( jitterX, jitterY, -5.0f * ( (float)rand() / RAND_MAX ) );
+        body.m_invMass = 1.0f;
+        body.m_shape = sphere;
+        bodies.Add( body );
+    }
+}
+
+/*
+====================================================
+RunBackend
+
+Moves the spheres ballistically, so both backends see identical frames,
+and returns the milliseconds spent in the broadphase
+====================================================
+*/
+static double RunBackend( const BroadPhaseState::broadPhaseType_t type, const int numSpheres, const int numFrames, Shape * sphere, Shape * ground, long long & numPairs ) {
+    BodyPool bodies;
+    BuildSphereRain( bodies, numSpheres, sphere, ground );
+
+    BroadPhaseState state;
+    state.m_type = type;
+
+    const float dt = 1.0f / 60.0f;
+    collisionPairs_t pairs;
+    numPairs = 0;
+    double ms = 0.0;
+    for ( int frame = 0; frame < numFrames; frame++ ) {
+        const std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        BroadPhase( state, bodies, pairs, dt );
+        const std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+        ms += std::chrono::duration< double, std::milli >( end - start ).count();
+        numPairs += (long long)pairs.size();
+
+        for ( int i = 1; i < bodies.size(); i++ ) {
+            Body & body = bodies[ i ];
+            body.m_linearVelocity.z -= 10.0f * dt;
+            body.m_position += body.m_linearVelocity * dt;
+            if ( body.m_position.z < 0.5f ) {
+                body.m_position.z = 0.5f;
+                body.m_linearVelocity.z *= -0.5f;
+            }
+        }
+    }
+    return ms;
+}
+
+/*
+====================================================
+main
+====================================================
+*/
+int main( int argc, char ** argv ) {
+    const int numFrames = ( argc > 2 ) ? atoi( argv[ 2 ] ) : 120;
+    std::vector< int > counts;
+    if ( argc > 1 ) {
+        counts.push_back( atoi( argv[ 1 ] ) );
+    } else {
+        counts.push_back( 1000 );
+        counts.push_back( 4000 );
+        counts.push_back( 16000 );
+    }
+
+    ShapeSphere sphere( 0.5f );
+    Vec3 groundPts[ 8 ];
+    for ( int i = 0; i < 8; i++ ) {
+        groundPts[ i ] = Vec3( ( i & 1 ) ? 500.0f : -500.0f, ( i & 2 ) ? 500.0f : -500.0f, ( i & 4 ) ? 0.5f : -0.5f );
+    }
+    ShapeBox ground( groundPts, 8 );
+
+    printf( "%10s %10s %16s %16s %12s\n", "spheres", "frames", "backend", "ms/frame", "pairs/frame" );
+    for ( int i = 0; i < counts.size(); i++ ) {
+        const int numSpheres = counts[ i ];
+
+        long long pairsSAP = 0;
+        const double msSAP = RunBackend( BroadPhaseState::BROADPHASE_SWEEP_AND_PRUNE, numSpheres, numFrames, &sphere, &ground, pairsSAP );
+        printf( "%10d %10d %16s %16.3f %12lld\n", numSpheres, numFrames, "sweep_and_prune", msSAP / numFrames, pairsSAP / numFrames );
+
+        long long pairsHash = 0;
+        const double msHash = RunBackend( BroadPhaseState::BROADPHASE_SPATIAL_HASH, numSpheres, numFrames, &sphere, &ground, pairsHash );
+        printf( "%10d %10d %16s %16.3f %12lld\n", numSpheres, numFrames, "spatial_hash", msHash / numFrames, pairsHash / numFrames );
+    }
+
+    return 0;
+}
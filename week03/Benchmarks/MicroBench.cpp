@@ -0,0 +1,819 @@
+//
+//  MicroBench.cpp
+//
+//  Times the narrow phase and solver kernels in isolation on seeded random
+//  shape pairs, and the scene ray casts on a settled pile, and reports
+//  nanoseconds and heap allocations per call.
+//  Results can be saved as a baseline, and later runs compared against it.
+//
+//  usage: week03_microbench [--filter text] [--time-ms N] [--seed N]
+//                           [--baseline file] [--write-baseline file] [--threshold fraction]
+//      --filter only runs the cases whose name contains the text
+//      --baseline flags every case that is slower than the baseline by more
+//          than the threshold (0.25 by default), or that allocates more,
+//          and exits with 1 when there was any regression
+//
+#include "Physics/GJK.h"
+#include "Physics/Intersections.h"
+#include "Physics/Constraints.h"
+#include "Math/LCP.h"
+#include "Scene.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/*
+================================================================================================
+
+Allocation Counting
+
+The global allocator is replaced for this executable only, so every heap
+allocation made by the engine while a case is timed gets counted.
+
+================================================================================================
+*/
+
+static std::atomic< long long > g_numAllocations( 0 );
+
+void * operator new( size_t size ) {
+    g_numAllocations.fetch_add( 1, std::memory_order_relaxed );
+    void * ptr = malloc( size > 0 ? size : 1 );
+    if ( NULL == ptr ) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void * operator new[]( size_t size ) {
+    return operator new( size );
+}
+
+void operator delete( void * ptr ) noexcept {
+    free( ptr );
+}
+
+void operator delete[]( void * ptr ) noexcept {
+    free( ptr );
+}
+
+void operator delete( void * ptr, size_t ) noexcept {
+    free( ptr );
+}
+
+void operator delete[]( void * ptr, size_t ) noexcept {
+    free( ptr );
+}
+
+/*
+================================================================================================
+
+Random Shapes
+
+A small xorshift generator instead of rand(), so the same seed builds the
+same shapes with every C library.
+
+================================================================================================
+*/
+
+struct random_t {
+    unsigned int state;
+
+    explicit random_t( const unsigned int seed ) : state( seed ? seed : 1 ) {}
+
+    unsigned int Next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // Uniform in [ lo, hi )
+    float Float( const float lo, const float hi ) {
+        return lo + ( hi - lo ) * (float)( Next() >> 8 ) / (float)( 1 << 24 );
+    }
+
+    Vec3 UnitVector() {
+        while ( true ) {
+            Vec3 v( Float( -1, 1 ), Float( -1, 1 ), Float( -1, 1 ) );
+            const float lenSqr = v.GetLengthSqr();
+            if ( lenSqr > 0.01f && lenSqr <= 1.0f ) {
+                return v / sqrtf( lenSqr );
+            }
+        }
+    }
+
+    Quat Orientation() {
+        Quat q( Float( -1, 1 ), Float( -1, 1 ), Float( -1, 1 ), Float( -1, 1 ) );
+        q.Normalize();
+        return q;
+    }
+};
+
+/*
+====================================================
+RandomCloud
+
+Points scattered between 0.5 and 1 units from the origin
+====================================================
+*/
+static void RandomCloud( random_t & rng, const int num, std::vector< Vec3 > & pts ) {
+    pts.resize( num );
+    for ( int i = 0; i < num; i++ ) {
+        pts[ i ] = rng.UnitVector() * rng.Float( 0.5f, 1.0f );
+    }
+}
+
+enum shapeKind_t {
+    KIND_BOX,
+    KIND_SPHERE,
+    KIND_HULL,
+};
+
+/*
+====================================================
+MakeShape
+====================================================
+*/
+static Shape * MakeShape( random_t & rng, const shapeKind_t kind, const int numVerts ) {
+    if ( KIND_BOX == kind ) {
+        const Vec3 halfExtents( rng.Float( 0.25f, 1.0f ), rng.Float( 0.25f, 1.0f ), rng.Float( 0.25f, 1.0f ) );
+        const Vec3 corners[ 2 ] = { halfExtents * -1.0f, halfExtents };
+        return new ShapeBox( corners, 2 );
+    }
+    if ( KIND_SPHERE == kind ) {
+        return new ShapeSphere( rng.Float( 0.25f, 1.0f ) );
+    }
+    std::vector< Vec3 > pts;
+    RandomCloud( rng, numVerts, pts );
+    return new ShapeConvex( pts.data(), numVerts );
+}
+
+/*
+================================================================================================
+
+Shape Pairs
+
+================================================================================================
+*/
+
+enum placement_t {
+    PLACE_SEPARATED,	// a clear gap between the shapes
+    PLACE_TOUCHING,		// resting contact, the shapes just overlap
+    PLACE_DEEP,			// a large fraction of the shapes overlap
+};
+
+static const char * g_placementNames[] = { "separated", "touching", "deep" };
+
+struct pairKind_t {
+    const char * name;
+    shapeKind_t kindA;
+    int vertsA;
+    shapeKind_t kindB;
+    int vertsB;
+};
+
+static const pairKind_t g_pairKinds[] = {
+    { "box_box",			KIND_BOX,		0,		KIND_BOX,	0 },
+    { "hull8_hull8",		KIND_HULL,		8,		KIND_HULL,	8 },
+    { "hull32_hull32",		KIND_HULL,		32,		KIND_HULL,	32 },
+    { "hull128_hull128",	KIND_HULL,		128,	KIND_HULL,	128 },
+    { "sphere_hull32",		KIND_SPHERE,	0,		KIND_HULL,	32 },
+};
+static const int g_numPairKinds = sizeof( g_pairKinds ) / sizeof( g_pairKinds[ 0 ] );
+
+static const int NUM_PAIRS = 64;
+
+// Building a convex hull shape samples its volume for the mass properties,
+// which is far too slow to do for every pair.  The pairs pick from a small
+// pool of shapes instead, with their own random orientations and placements.
+static const int NUM_POOL_SHAPES = 8;
+
+struct shapePool_t {
+    shapeKind_t kind;
+    int numVerts;
+    Shape * shapes[ NUM_POOL_SHAPES ];
+};
+
+static std::vector< shapePool_t > g_shapePools;
+
+/*
+====================================================
+GetShapePool
+====================================================
+*/
+static const shapePool_t & GetShapePool( const shapeKind_t kind, const int numVerts, const unsigned int seed ) {
+    for ( int i = 0; i < (int)g_shapePools.size(); i++ ) {
+        if ( g_shapePools[ i ].kind == kind && g_shapePools[ i ].numVerts == numVerts ) {
+            return g_shapePools[ i ];
+        }
+    }
+
+    random_t rng( seed + kind * 1000 + numVerts );
+    shapePool_t pool;
+    pool.kind = kind;
+    pool.numVerts = numVerts;
+    for ( int i = 0; i < NUM_POOL_SHAPES; i++ ) {
+        pool.shapes[ i ] = MakeShape( rng, kind, numVerts );
+    }
+    g_shapePools.push_back( pool );
+    return g_shapePools.back();
+}
+
+/*
+====================================================
+FreeShapePools
+====================================================
+*/
+static void FreeShapePools() {
+    for ( int i = 0; i < (int)g_shapePools.size(); i++ ) {
+        for ( int j = 0; j < NUM_POOL_SHAPES; j++ ) {
+            delete g_shapePools[ i ].shapes[ j ];
+        }
+    }
+    g_shapePools.clear();
+}
+
+/*
+====================================================
+shapePair_t
+
+B is placed along a random direction from A.  Separated pairs have a gap
+between their support planes, touching pairs are moved in until they just
+overlap, and deep pairs go on from there by a large part of their size.
+====================================================
+*/
+struct shapePair_t {
+    Body bodyA;
+    Body bodyB;
+};
+
+static void InitBody( Body & body, Shape * shape, const Vec3 & pos, const Quat & orient ) {
+    body.m_position = pos;
+    body.m_orientation = orient;
+    body.m_linearVelocity.Zero();
+    body.m_angularVelocity.Zero();
+    body.m_invMass = 1.0f;
+    body.m_elasticity = 0.5f;
+    body.m_friction = 0.5f;
+    body.m_shape = shape;
+}
+
+static void BuildPairs( const pairKind_t & kind, const placement_t placement, const unsigned int seed, std::vector< shapePair_t > & pairs ) {
+    // Copies, the second call may grow g_shapePools
+    const shapePool_t poolA = GetShapePool( kind.kindA, kind.vertsA, seed );
+    const shapePool_t poolB = GetShapePool( kind.kindB, kind.vertsB, seed );
+
+    random_t rng( seed + kind.vertsA * 7 + kind.vertsB * 13 + placement );
+    pairs.resize( NUM_PAIRS );
+    for ( int i = 0; i < NUM_PAIRS; i++ ) {
+        Shape * shapeA = poolA.shapes[ rng.Next() % NUM_POOL_SHAPES ];
+        Shape * shapeB = poolB.shapes[ rng.Next() % NUM_POOL_SHAPES ];
+
+        shapePair_t & pair = pairs[ i ];
+        InitBody( pair.bodyA, shapeA, Vec3( 0.0f ), rng.Orientation() );
+        InitBody( pair.bodyB, shapeB, Vec3( 0.0f ), rng.Orientation() );
+
+        const Vec3 dir = rng.UnitVector();
+        const float extentA = dir.Dot( shapeA->Support( dir, pair.bodyA.m_position, pair.bodyA.m_orientation, 0.0f ) );
+        const float extentB = dir.Dot( shapeB->Support( dir * -1.0f, Vec3( 0.0f ), pair.bodyB.m_orientation, 0.0f ) ) * -1.0f;
+
+        float dist = extentA + extentB;
+        if ( PLACE_SEPARATED == placement ) {
+            dist += 0.5f;
+        } else {
+            // The support points are not lined up, so the planes meeting does not mean
+            // the shapes do.  Step B inwards until GJK first sees them overlap.
+            pair.bodyB.m_position = dir * dist;
+            for ( int step = 0; step < 1000 && !GJK_DoesIntersect( &pair.bodyA, &pair.bodyB ); step++ ) {
+                dist -= 0.005f;
+                pair.bodyB.m_position = dir * dist;
+            }
+            if ( PLACE_DEEP == placement ) {
+                dist -= 0.4f * std::min( extentA, extentB );
+            }
+        }
+        pair.bodyB.m_position = dir * dist;
+
+        // Closing in on each other, fast enough for a separated pair to meet within the time step
+        pair.bodyA.m_linearVelocity = dir * 10.0f;
+        pair.bodyB.m_linearVelocity = dir * -10.0f;
+    }
+}
+
+/*
+================================================================================================
+
+Timing
+
+================================================================================================
+*/
+
+struct benchResult_t {
+    std::string name;
+    double nsPerOp;
+    double allocsPerOp;
+};
+
+/*
+====================================================
+RunCase
+
+Calls op( i ) on a cycling index until the time budget is spent, in five
+batches, and keeps the fastest batch.  The allocations come from the same batch.
+====================================================
+*/
+template< typename Op >
+static benchResult_t RunCase( const std::string & name, const double timeMS, Op && op ) {
+    typedef std::chrono::steady_clock clock_t;
+
+    // Warm up, and find how many calls fill a batch
+    long long batchSize = 1;
+    while ( true ) {
+        const clock_t::time_point start = clock_t::now();
+        for ( long long i = 0; i < batchSize; i++ ) {
+            op( (int)( i % NUM_PAIRS ) );
+        }
+        const double elapsedMS = std::chrono::duration< double, std::milli >( clock_t::now() - start ).count();
+        if ( elapsedMS >= timeMS * 0.2 || batchSize >= ( 1LL << 30 ) ) {
+            break;
+        }
+        batchSize *= 2;
+    }
+
+    benchResult_t result;
+    result.name = name;
+    result.nsPerOp = 1e30;
+    result.allocsPerOp = 0.0;
+    for ( int batch = 0; batch < 5; batch++ ) {
+        const long long allocsStart = g_numAllocations.load();
+        const clock_t::time_point start = clock_t::now();
+        for ( long long i = 0; i < batchSize; i++ ) {
+            op( (int)( i % NUM_PAIRS ) );
+        }
+        const double elapsedNS = std::chrono::duration< double, std::nano >( clock_t::now() - start ).count();
+        const long long allocs = g_numAllocations.load() - allocsStart;
+
+        const double nsPerOp = elapsedNS / (double)batchSize;
+        if ( nsPerOp < result.nsPerOp ) {
+            result.nsPerOp = nsPerOp;
+            result.allocsPerOp = (double)allocs / (double)batchSize;
+        }
+    }
+    return result;
+}
+
+// Keeps the optimizer from throwing away the results of the timed calls
+static volatile float g_sink;
+
+/*
+================================================================================================
+
+Cases
+
+================================================================================================
+*/
+
+struct benchContext_t {
+    const char * filter;
+    double timeMS;
+    unsigned int seed;
+    std::vector< benchResult_t > results;
+};
+
+static bool WantCase( const benchContext_t & ctx, const std::string & name ) {
+    return NULL == ctx.filter || NULL != strstr( name.c_str(), ctx.filter );
+}
+
+static void Report( benchContext_t & ctx, const benchResult_t & result ) {
+    printf( "%-48s %12.1f ns/op %10.2f allocs/op\n", result.name.c_str(), result.nsPerOp, result.allocsPerOp );
+    fflush( stdout );
+    ctx.results.push_back( result );
+}
+
+/*
+====================================================
+RunPairCases
+
+The narrow phase kernels on every pair kind and placement
+====================================================
+*/
+static void RunPairCases( benchContext_t & ctx ) {
+    for ( int k = 0; k < g_numPairKinds; k++ ) {
+        const pairKind_t & kind = g_pairKinds[ k ];
+        for ( int p = PLACE_SEPARATED; p <= PLACE_DEEP; p++ ) {
+            const placement_t placement = (placement_t)p;
+            const std::string suffix = std::string( "/" ) + kind.name + "/" + g_placementNames[ p ];
+            if ( !WantCase( ctx, "GJK_DoesIntersect" + suffix ) && !WantCase( ctx, "GJK_ClosestPoints" + suffix ) &&
+                !WantCase( ctx, "EPA_Expand" + suffix ) && !WantCase( ctx, "ConservativeAdvance" + suffix ) ) {
+                continue;
+            }
+
+            std::vector< shapePair_t > pairs;
+            BuildPairs( kind, placement, ctx.seed, pairs );
+
+            std::string name = "GJK_DoesIntersect" + suffix;
+            if ( WantCase( ctx, name ) ) {
+                Report( ctx, RunCase( name, ctx.timeMS, [ &pairs ]( const int i ) {
+                    g_sink = GJK_DoesIntersect( &pairs[ i ].bodyA, &pairs[ i ].bodyB ) ? 1.0f : 0.0f;
+                } ) );
+            }
+
+            // The closest points are only meaningful while the shapes are apart
+            name = "GJK_ClosestPoints" + suffix;
+            if ( PLACE_DEEP != placement && WantCase( ctx, name ) ) {
+                Report( ctx, RunCase( name, ctx.timeMS, [ &pairs ]( const int i ) {
+                    Vec3 ptOnA;
+                    Vec3 ptOnB;
+                    GJK_ClosestPoints( &pairs[ i ].bodyA, &pairs[ i ].bodyB, ptOnA, ptOnB );
+                    g_sink = ptOnA.x + ptOnB.x;
+                } ) );
+            }
+
+            // EPA needs the penetrating simplex, which is built once up front
+            name = "EPA_Expand" + suffix;
+            if ( PLACE_SEPARATED != placement && WantCase( ctx, name ) ) {
+                const float bias = 0.001f;
+                std::vector< point_t > simplices( NUM_PAIRS * 4 );
+                std::vector< char > isValid( NUM_PAIRS );
+                for ( int i = 0; i < NUM_PAIRS; i++ ) {
+                    isValid[ i ] = GJK_PenetrationSimplex( &pairs[ i ].bodyA, &pairs[ i ].bodyB, bias, &simplices[ i * 4 ] );
+                }
+                Report( ctx, RunCase( name, ctx.timeMS, [ &pairs, &simplices, &isValid, bias ]( const int i ) {
+                    if ( !isValid[ i ] ) {
+                        return;
+                    }
+                    Vec3 ptOnA;
+                    Vec3 ptOnB;
+                    g_sink = EPA_Expand( &pairs[ i ].bodyA, &pairs[ i ].bodyB, bias, &simplices[ i * 4 ], ptOnA, ptOnB );
+                } ) );
+            }
+
+            name = "ConservativeAdvance" + suffix;
+            if ( WantCase( ctx, name ) ) {
+                Report( ctx, RunCase( name, ctx.timeMS, [ &pairs ]( const int i ) {
+                    contact_t contact;
+                    g_sink = ConservativeAdvance( &pairs[ i ].bodyA, &pairs[ i ].bodyB, 1.0f / 60.0f, contact ) ? contact.timeOfImpact : -1.0f;
+                } ) );
+            }
+        }
+    }
+}
+
+/*
+====================================================
+RunHullCases
+====================================================
+*/
+static void RunHullCases( benchContext_t & ctx ) {
+    const int vertexCounts[] = { 8, 32, 128 };
+    for ( int v = 0; v < 3; v++ ) {
+        const int numVerts = vertexCounts[ v ];
+        const std::string name = "BuildConvexHull/cloud" + std::to_string( numVerts );
+        if ( !WantCase( ctx, name ) ) {
+            continue;
+        }
+
+        random_t rng( ctx.seed + numVerts );
+        std::vector< std::vector< Vec3 > > clouds( NUM_PAIRS );
+        for ( int i = 0; i < NUM_PAIRS; i++ ) {
+            RandomCloud( rng, numVerts, clouds[ i ] );
+        }
+
+        std::vector< Vec3 > hullPts;
+        std::vector< tri_t > hullTris;
+        Report( ctx, RunCase( name, ctx.timeMS, [ &clouds, &hullPts, &hullTris ]( const int i ) {
+            hullPts.clear();
+            hullTris.clear();
+            BuildConvexHull( clouds[ i ], hullPts, hullTris );
+            g_sink = (float)hullTris.size();
+        } ) );
+    }
+}
+
+/*
+====================================================
+RunSolverCases
+
+LCP_GaussSeidel on J * M^-1 * J^T systems the size of the constraints in
+the tree, and a sweep of the scalar rows of a contact on deep box pairs.
+====================================================
+*/
+static void RunSolverCases( benchContext_t & ctx ) {
+    const int rowCounts[] = { 3, 6, 12 };
+    for ( int r = 0; r < 3; r++ ) {
+        const int N = rowCounts[ r ];
+        const std::string name = "LCP_GaussSeidel/rows" + std::to_string( N );
+        if ( !WantCase( ctx, name ) ) {
+            continue;
+        }
+
+        random_t rng( ctx.seed + N );
+        std::vector< MatN > systems( NUM_PAIRS );
+        std::vector< VecN > rhs( NUM_PAIRS );
+        for ( int s = 0; s < NUM_PAIRS; s++ ) {
+            // A random jacobian with an inverse mass of one gives a symmetric positive definite J * J^T
+            MatMN J( N, 12 );
+            for ( int i = 0; i < N; i++ ) {
+                for ( int j = 0; j < 12; j++ ) {
+                    J.rows[ i ][ j ] = rng.Float( -1, 1 );
+                }
+            }
+            systems[ s ] = J * J.Transpose();
+            rhs[ s ] = VecN( N );
+            for ( int i = 0; i < N; i++ ) {
+                rhs[ s ][ i ] = rng.Float( -1, 1 );
+            }
+        }
+
+        Report( ctx, RunCase( name, ctx.timeMS, [ &systems, &rhs ]( const int i ) {
+            const VecN x = LCP_GaussSeidel( systems[ i ], rhs[ i ] );
+            g_sink = x[ 0 ];
+        } ) );
+    }
+
+    const std::string name = "SolveRows/box_box/deep";
+    if ( !WantCase( ctx, name ) ) {
+        return;
+    }
+
+    std::vector< shapePair_t > pairs;
+    BuildPairs( g_pairKinds[ 0 ], PLACE_DEEP, ctx.seed, pairs );
+
+    std::vector< ConstraintPenetration > constraints( NUM_PAIRS );
+    for ( int i = 0; i < NUM_PAIRS; i++ ) {
+        shapePair_t & pair = pairs[ i ];
+        Vec3 ptOnA;
+        Vec3 ptOnB;
+        GJK_DoesIntersect( &pair.bodyA, &pair.bodyB, 0.001f, ptOnA, ptOnB );
+        Vec3 normal = ptOnB - ptOnA;
+        if ( normal.GetLengthSqr() < 1e-8f ) {
+            normal = pair.bodyB.m_position - pair.bodyA.m_position;
+        }
+        normal.Normalize();
+
+        ConstraintPenetration & constraint = constraints[ i ];
+        constraint.m_bodyA = &pair.bodyA;
+        constraint.m_bodyB = &pair.bodyB;
+        constraint.m_anchorA = pair.bodyA.WorldSpaceToBodySpace( ptOnA );
+        constraint.m_anchorB = pair.bodyB.WorldSpaceToBodySpace( ptOnB );
+        constraint.m_normal = pair.bodyA.m_orientation.Inverse().RotatePoint( normal * -1.0f );
+        constraint.PreSolve( 1.0f / 60.0f );
+    }
+
+    const int rowsPerContact = 3;
+    std::vector< solverRow_t > rows( NUM_PAIRS * rowsPerContact );
+    std::vector< int > numRows( NUM_PAIRS );
+    for ( int i = 0; i < NUM_PAIRS; i++ ) {
+        numRows[ i ] = constraints[ i ].BuildRows( &rows[ i * rowsPerContact ] );
+    }
+
+    Report( ctx, RunCase( name, ctx.timeMS, [ &rows, &numRows, rowsPerContact ]( const int i ) {
+        SolveRows( &rows[ i * rowsPerContact ], numRows[ i ] );
+        g_sink = rows[ i * rowsPerContact ].lambda;
+    } ) );
+}
+
+/*
+====================================================
+RunRayCases
+
+Single rays against batches of RAY_BATCH_SIZE through RayCastMany, on the
+pile_1k preset after it has fallen for half a second.  The rays come down
+on the pile from above at random angles.
+====================================================
+*/
+static const int RAY_BATCH_SIZE = 1024;
+
+static void RunRayCases( benchContext_t & ctx ) {
+    static const char * modeNames[] = { "closest", "any", "all" };
+    bool wantAny = false;
+    for ( int m = RAYCAST_CLOSEST; m <= RAYCAST_ALL; m++ ) {
+        wantAny = wantAny || WantCase( ctx, std::string( "RayCast/pile_1k/" ) + modeNames[ m ] );
+        wantAny = wantAny || WantCase( ctx, std::string( "RayCastMany/pile_1k/" ) + modeNames[ m ] + "/x" + std::to_string( RAY_BATCH_SIZE ) );
+    }
+    if ( !wantAny ) {
+        return;
+    }
+
+    FillDiamond();
+    Scene scene;
+    scene.SetPreset( "pile_1k" );
+    scene.Reset();
+    for ( int frame = 0; frame < 30; frame++ ) {
+        scene.Update( 1.0f / 60.0f );
+    }
+
+    Bounds area;
+    for ( int i = 0; i < scene.m_bodies.size(); i++ ) {
+        const Body & body = scene.m_bodies[ i ];
+        if ( scene.m_bodies.IsAlive( i ) && !body.IsStatic() ) {
+            area.Expand( body.m_shape->GetBounds( body.m_position, body.m_orientation ) );
+        }
+    }
+
+    random_t rng( ctx.seed );
+    std::vector< ray_t > rays( RAY_BATCH_SIZE * NUM_PAIRS );
+    for ( int i = 0; i < rays.size(); i++ ) {
+        const Vec3 start( rng.Float( area.mins.x, area.maxs.x ), rng.Float( area.mins.y, area.maxs.y ), area.maxs.z + 1.0f );
+        Vec3 dir = rng.UnitVector();
+        dir.z = -fabsf( dir.z ) - 0.5f;
+        dir.Normalize();
+        rays[ i ] = ray_t( start, dir, 100.0f );
+    }
+
+    std::vector< rayHit_t > hits;
+    std::vector< rayResult_t > results( RAY_BATCH_SIZE );
+    for ( int m = RAYCAST_CLOSEST; m <= RAYCAST_ALL; m++ ) {
+        const rayCastMode_t mode = (rayCastMode_t)m;
+
+        std::string name = std::string( "RayCast/pile_1k/" ) + modeNames[ m ];
+        if ( WantCase( ctx, name ) ) {
+            int next = 0;
+            Report( ctx, RunCase( name, ctx.timeMS, [ &scene, &rays, &hits, &next, mode ]( const int i ) {
+                g_sink = scene.RayCast( rays[ next ], mode, hits ) ? 1.0f : 0.0f;
+                next = ( next + 1 ) % (int)rays.size();
+            } ) );
+        }
+
+        name = std::string( "RayCastMany/pile_1k/" ) + modeNames[ m ] + "/x" + std::to_string( RAY_BATCH_SIZE );
+        if ( WantCase( ctx, name ) ) {
+            Report( ctx, RunCase( name, ctx.timeMS, [ &scene, &rays, &hits, &results, mode ]( const int i ) {
+                scene.RayCastMany( &rays[ i * RAY_BATCH_SIZE ], RAY_BATCH_SIZE, mode, hits, results.data() );
+                g_sink = (float)hits.size();
+            } ) );
+        }
+    }
+}
+
+/*
+================================================================================================
+
+Baseline
+
+A plain text file, one case per line: name ns/op allocs/op.
+Lines starting with # are comments.
+
+================================================================================================
+*/
+
+/*
+====================================================
+LoadBaseline
+====================================================
+*/
+static bool LoadBaseline( const char * fileName, std::vector< benchResult_t > & baseline ) {
+    FILE * fp = fopen( fileName, "r" );
+    if ( NULL == fp ) {
+        return false;
+    }
+
+    char line[ 512 ];
+    while ( NULL != fgets( line, sizeof( line ), fp ) ) {
+        if ( '#' == line[ 0 ] ) {
+            continue;
+        }
+        char name[ 256 ];
+        benchResult_t result;
+        if ( 3 == sscanf( line, "%255s %lf %lf", name, &result.nsPerOp, &result.allocsPerOp ) ) {
+            result.name = name;
+            baseline.push_back( result );
+        }
+    }
+    fclose( fp );
+    return true;
+}
+
+/*
+====================================================
+WriteBaseline
+====================================================
+*/
+static bool WriteBaseline( const char * fileName, const std::vector< benchResult_t > & results ) {
+    FILE * fp = fopen( fileName, "w" );
+    if ( NULL == fp ) {
+        return false;
+    }
+
+    fprintf( fp, "# week03_microbench baseline: name ns/op allocs/op\n" );
+    for ( int i = 0; i < (int)results.size(); i++ ) {
+        const benchResult_t & result = results[ i ];
+        fprintf( fp, "%s %.1f %.2f\n", result.name.c_str(), result.nsPerOp, result.allocsPerOp );
+    }
+    fclose( fp );
+    return true;
+}
+
+/*
+====================================================
+CompareToBaseline
+
+Returns the number of regressions.  Allocation counts are deterministic, so
+any increase is a regression, while the timings get the threshold as slack.
+====================================================
+*/
+static int CompareToBaseline( const std::vector< benchResult_t > & results, const std::vector< benchResult_t > & baseline, const double threshold ) {
+    int numRegressions = 0;
+    printf( "\n%-48s %12s %12s %8s\n", "case", "baseline ns", "ns", "change" );
+    for ( int i = 0; i < (int)results.size(); i++ ) {
+        const benchResult_t & result = results[ i ];
+        const benchResult_t * base = NULL;
+        for ( int j = 0; j < (int)baseline.size(); j++ ) {
+            if ( baseline[ j ].name == result.name ) {
+                base = &baseline[ j ];
+                break;
+            }
+        }
+        if ( NULL == base ) {
+            printf( "%-48s %12s %12.1f %8s\n", result.name.c_str(), "-", result.nsPerOp, "new" );
+            continue;
+        }
+
+        const double change = ( result.nsPerOp - base->nsPerOp ) / base->nsPerOp;
+        const bool isSlower = change > threshold;
+        const bool allocatesMore = result.allocsPerOp > base->allocsPerOp + 0.01;
+        const char * flag = "";
+        if ( isSlower && allocatesMore ) {
+            flag = "  REGRESSION (time, allocs)";
+        } else if ( isSlower ) {
+            flag = "  REGRESSION (time)";
+        } else if ( allocatesMore ) {
+            flag = "  REGRESSION (allocs)";
+        }
+        if ( isSlower || allocatesMore ) {
+            numRegressions++;
+        }
+        printf( "%-48s %12.1f %12.1f %+7.1f%%%s\n", result.name.c_str(), base->nsPerOp, result.nsPerOp, change * 100.0, flag );
+    }
+    return numRegressions;
+}
+
+/*
+====================================================
+main
+====================================================
+*/
+int main( int argc, char * argv[] ) {
+    benchContext_t ctx;
+    ctx.filter = NULL;
+    ctx.timeMS = 50.0;
+    ctx.seed = 1337;
+
+    const char * baselineFile = NULL;
+    const char * writeBaselineFile = NULL;
+    double threshold = 0.25;
+
+    for ( int i = 1; i < argc; i++ ) {
+        const bool hasValue = ( i + 1 < argc );
+        if ( 0 == strcmp( argv[ i ], "--filter" ) && hasValue ) {
+            ctx.filter = argv[ ++i ];
+        } else if ( 0 == strcmp( argv[ i ], "--time-ms" ) && hasValue ) {
+            ctx.timeMS = atof( argv[ ++i ] );
+        } else if ( 0 == strcmp( argv[ i ], "--seed" ) && hasValue ) {
+            ctx.seed = (unsigned int)strtoul( argv[ ++i ], NULL, 10 );
+        } else if ( 0 == strcmp( argv[ i ], "--baseline" ) && hasValue ) {
+            baselineFile = argv[ ++i ];
+        } else if ( 0 == strcmp( argv[ i ], "--write-baseline" ) && hasValue ) {
+            writeBaselineFile = argv[ ++i ];
+        } else if ( 0 == strcmp( argv[ i ], "--threshold" ) && hasValue ) {
+            threshold = atof( argv[ ++i ] );
+        } else {
+            printf( "usage: %s [--filter text] [--time-ms N] [--seed N] [--baseline file] [--write-baseline file] [--threshold fraction]\n", argv[ 0 ] );
+            return 1;
+        }
+    }
+
+    RunPairCases( ctx );
+    RunHullCases( ctx );
+    RunSolverCases( ctx );
+    RunRayCases( ctx );
+    FreeShapePools();
+
+    if ( NULL != writeBaselineFile ) {
+        if ( !WriteBaseline( writeBaselineFile, ctx.results ) ) {
+            printf( "Failed to write %s\n", writeBaselineFile );
+            return 1;
+        }
+        printf( "Wrote %s\n", writeBaselineFile );
+    }
+
+    if ( NULL != baselineFile ) {
+        std::vector< benchResult_t > baseline;
+        if ( !LoadBaseline( baselineFile, baseline ) ) {
+            printf( "Failed to read %s\n", baselineFile );
+            return 1;
+        }
+        const int numRegressions = CompareToBaseline( ctx.results, baseline, threshold );
+        printf( "\n%d regression(s) against %s\n", numRegressions, baselineFile );
+        if ( numRegressions > 0 ) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,241 @@
+//
+//  PhysicsBench.cpp
+//
+//  Steps scene presets as fast as possible without any rendering, and
+//  reports the per stage timings and the throughput as JSON.
+//
+//  usage: week03_bench [--scene name]... [--frames N] [--dt seconds] [--out file.json] [--trace file.json] [--no-block-solver] [--speculative] [--list]
+//      --scene may be repeated, "all" runs every preset (the default)
+//      --trace writes a Chrome trace_event file of every frame that was run
+//      --no-block-solver solves contact manifolds one row at a time
+//      --speculative uses speculative contacts instead of times of impact
+//
+#include "Scene.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/*
+====================================================
+benchResult_t
+====================================================
+*/
+struct benchResult_t {
+    std::string scene;
+    int numBodies;
+    int numConstraints;
+    int numFrames;
+    float dt;
+    double wallMS;
+    double minFrameMS;
+    double maxFrameMS;
+    sceneTimings_t stageMS;	// summed over all frames
+    profileCounters_t counters;	// summed over all frames
+    size_t arenaHighWater;		// peak frame arena bytes of any frame
+    size_t arenaCapacity;		// frame arena bytes reserved at the end of the run
+    int maxIslandIterations;	// most sweeps any island took in any frame
+    float maxResidual;			// largest residual the solver stopped at in any frame
+};
+
+/*
+====================================================
+RunScene
+====================================================
+*/
+static benchResult_t RunScene( const char * name, const int numFrames, const float dt, const bool blockSolver, const bool speculative ) {
+    benchResult_t result;
+    memset( &result.stageMS, 0, sizeof( result.stageMS ) );
+    memset( &result.counters, 0, sizeof( result.counters ) );
+    result.scene = name;
+    result.numFrames = numFrames;
+    result.dt = dt;
+    result.minFrameMS = 1e20;
+    result.maxFrameMS = 0.0;
+    result.maxIslandIterations = 0;
+    result.maxResidual = 0.0f;
+
+    Scene * scene = new Scene;
+    scene->SetPreset( name );
+    scene->m_blockSolver = blockSolver;
+    scene->m_speculativeContacts = speculative;
+    scene->Reset();
+    result.numBodies = scene->m_bodies.GetNumAlive();
+    result.numConstraints = (int)scene->m_constraints.size();
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for ( int frame = 0; frame < numFrames; frame++ ) {
+        scene->Update( dt );
+
+        const sceneTimings_t & t = scene->m_timings;
+        result.stageMS.manifolds += t.manifolds;
+        result.stageMS.gravity += t.gravity;
+        result.stageMS.broadPhase += t.broadPhase;
+        result.stageMS.narrowPhase += t.narrowPhase;
+        result.stageMS.sortContacts += t.sortContacts;
+        result.stageMS.preSolve += t.preSolve;
+        result.stageMS.solve += t.solve;
+        result.stageMS.postSolve += t.postSolve;
+        result.stageMS.ballistic += t.ballistic;
+        result.stageMS.total += t.total;
+        for ( int c = 0; c < COUNTER_MAX; c++ ) {
+            result.counters.values[ c ] += scene->m_counters.values[ c ];
+        }
+        result.maxIslandIterations = std::max( result.maxIslandIterations, scene->m_solverStats.maxIterations );
+        result.maxResidual = std::max( result.maxResidual, scene->m_solverStats.maxResidual );
+        if ( t.total < result.minFrameMS ) {
+            result.minFrameMS = t.total;
+        }
+        if ( t.total > result.maxFrameMS ) {
+            result.maxFrameMS = t.total;
+        }
+    }
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    result.wallMS = std::chrono::duration< double, std::milli >( end - start ).count();
+
+    // The last frame's peak is only folded into the high water mark by the next reset
+    result.arenaHighWater = std::max( scene->m_frameArena.GetHighWater(), scene->m_frameArena.GetFrameHighWater() );
+    result.arenaCapacity = scene->m_frameArena.GetCapacity();
+
+    delete scene;
+    return result;
+}
+
+/*
+====================================================
+WriteJSON
+====================================================
+*/
+static void WriteJSON( FILE * file, const std::vector< benchResult_t > & results ) {
+    fprintf( file, "{\n  \"benchmarks\": [\n" );
+    for ( int i = 0; i < results.size(); i++ ) {
+        const benchResult_t & r = results[ i ];
+        const double seconds = r.wallMS / 1000.0;
+        const double n = (double)r.numFrames;
+
+        fprintf( file, "    {\n" );
+        fprintf( file, "      \"scene\": \"%s\",\n", r.scene.c_str() );
+        fprintf( file, "      \"bodies\": %d,\n", r.numBodies );
+        fprintf( file, "      \"constraints\": %d,\n", r.numConstraints );
+        fprintf( file, "      \"frames\": %d,\n", r.numFrames );
+        fprintf( file, "      \"dt\": %g,\n", r.dt );
+        fprintf( file, "      \"wall_ms\": %.3f,\n", r.wallMS );
+        fprintf( file, "      \"frames_per_second\": %.3f,\n", n / seconds );
+        fprintf( file, "      \"body_steps_per_second\": %.1f,\n", n * r.numBodies / seconds );
+        fprintf( file, "      \"frame_ms\": { \"mean\": %.4f, \"min\": %.4f, \"max\": %.4f },\n", r.stageMS.total / n, r.minFrameMS, r.maxFrameMS );
+        fprintf( file, "      \"stage_ms_mean\": {\n" );
+        fprintf( file, "        \"manifolds\": %.4f,\n", r.stageMS.manifolds / n );
+        fprintf( file, "        \"gravity\": %.4f,\n", r.stageMS.gravity / n );
+        fprintf( file, "        \"broadphase\": %.4f,\n", r.stageMS.broadPhase / n );
+        fprintf( file, "        \"narrowphase\": %.4f,\n", r.stageMS.narrowPhase / n );
+        fprintf( file, "        \"sort_contacts\": %.4f,\n", r.stageMS.sortContacts / n );
+        fprintf( file, "        \"presolve\": %.4f,\n", r.stageMS.preSolve / n );
+        fprintf( file, "        \"solve\": %.4f,\n", r.stageMS.solve / n );
+        fprintf( file, "        \"postsolve\": %.4f,\n", r.stageMS.postSolve / n );
+        fprintf( file, "        \"ballistic\": %.4f\n", r.stageMS.ballistic / n );
+        fprintf( file, "      },\n" );
+        fprintf( file, "      \"arena_bytes\": { \"high_water\": %zu, \"capacity\": %zu },\n", r.arenaHighWater, r.arenaCapacity );
+        const long long numPairs = r.counters.values[ COUNTER_PAIRS ];
+        fprintf( file, "      \"ccd_pair_fraction\": %.4f,\n", ( numPairs > 0 ) ? (double)r.counters.values[ COUNTER_CCD_PAIRS ] / numPairs : 0.0 );
+        fprintf( file, "      \"solver\": { \"max_island_iterations\": %d, \"max_residual\": %g },\n", r.maxIslandIterations, r.maxResidual );
+        fprintf( file, "      \"counters_mean\": {\n" );
+        for ( int c = 0; c < COUNTER_MAX; c++ ) {
+            fprintf( file, "        \"%s\": %.2f%s\n", Profiler::GetCounterName( c ), r.counters.values[ c ] / n, ( c + 1 < COUNTER_MAX ) ? "," : "" );
+        }
+        fprintf( file, "      }\n" );
+        fprintf( file, "    }%s\n", ( i + 1 < results.size() ) ? "," : "" );
+    }
+    fprintf( file, "  ]\n}\n" );
+}
+
+/*
+====================================================
+main
+====================================================
+*/
+int main( int argc, char ** argv ) {
+    std::vector< std::string > scenes;
+    int numFrames = 600;
+    float dt = 1.0f / 60.0f;
+    const char * outPath = NULL;
+    const char * tracePath = NULL;
+    bool blockSolver = true;
+    bool speculative = false;
+
+    for ( int i = 1; i < argc; i++ ) {
+        const bool hasValue = ( i + 1 < argc );
+        if ( 0 == strcmp( argv[ i ], "--scene" ) && hasValue ) {
+            scenes.push_back( argv[ ++i ] );
+        } else if ( 0 == strcmp( argv[ i ], "--frames" ) && hasValue ) {
+            numFrames = atoi( argv[ ++i ] );
+        } else if ( 0 == strcmp( argv[ i ], "--dt" ) && hasValue ) {
+            dt = (float)atof( argv[ ++i ] );
+        } else if ( 0 == strcmp( argv[ i ], "--out" ) && hasValue ) {
+            outPath = argv[ ++i ];
+        } else if ( 0 == strcmp( argv[ i ], "--trace" ) && hasValue ) {
+            tracePath = argv[ ++i ];
+        } else if ( 0 == strcmp( argv[ i ], "--no-block-solver" ) ) {
+            blockSolver = false;
+        } else if ( 0 == strcmp( argv[ i ], "--speculative" ) ) {
+            speculative = true;
+        } else if ( 0 == strcmp( argv[ i ], "--list" ) ) {
+            for ( int p = 0; p < Scene::GetNumPresets(); p++ ) {
+                printf( "%s\n", Scene::GetPresetName( p ) );
+            }
+            return 0;
+        } else {
+            fprintf( stderr, "usage: %s [--scene name]... [--frames N] [--dt seconds] [--out file.json] [--trace file.json] [--no-block-solver] [--speculative] [--list]\n", argv[ 0 ] );
+            return 1;
+        }
+    }
+
+    if ( scenes.empty() || ( 1 == scenes.size() && scenes[ 0 ] == "all" ) ) {
+        scenes.clear();
+        for ( int p = 0; p < Scene::GetNumPresets(); p++ ) {
+            scenes.push_back( Scene::GetPresetName( p ) );
+        }
+    }
+
+    FillDiamond();
+
+    if ( NULL != tracePath ) {
+        Profiler::BeginCapture();
+    }
+
+    std::vector< benchResult_t > results;
+    for ( int i = 0; i < scenes.size(); i++ ) {
+        Scene probe;
+        if ( !probe.SetPreset( scenes[ i ].c_str() ) ) {
+            fprintf( stderr, "unknown scene preset '%s', see --list\n", scenes[ i ].c_str() );
+            return 1;
+        }
+
+        fprintf( stderr, "running %s for %d frames\n", scenes[ i ].c_str(), numFrames );
+        results.push_back( RunScene( scenes[ i ].c_str(), numFrames, dt, blockSolver, speculative ) );
+    }
+
+    if ( NULL != tracePath ) {
+        Profiler::EndCapture();
+        if ( !Profiler::WriteChromeTrace( tracePath ) ) {
+            fprintf( stderr, "couldn't write the trace to %s\n", tracePath );
+        }
+    }
+
+    FILE * file = stdout;
+    if ( NULL != outPath ) {
+        file = fopen( outPath, "w" );
+        if ( NULL == file ) {
+            fprintf( stderr, "couldn't open %s for writing\n", outPath );
+            return 1;
+        }
+    }
+    WriteJSON( file, results );
+    if ( file != stdout ) {
+        fclose( file );
+    }
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+//
+//  BVH.cpp
+//
+#include "BVH.h"
+#include <algorithm>
+
+/*
+====================================================
+BVH::Clear
+====================================================
+*/
+void BVH::Clear() {
+    m_nodes.clear();
+    m_items.clear();
+}
+
+/*
+====================================================
+BVH::Build
+====================================================
+*/
+void BVH::Build( const Bounds * bounds, const int num ) {
+    Clear();
+    if ( num <= 0 ) {
+        return;
+    }
+
+    std::vector< Vec3 > centers( num );
+    m_items.resize( num );
+    for ( int i = 0; i < num; i++ ) {
+        centers[ i ] = ( bounds[ i ].mins + bounds[ i ].maxs ) * 0.5f;
+        m_items[ i ] = i;
+    }
+
+    // A binary tree with at most MAX_LEAF_ITEMS per leaf never needs more than 2N nodes
+    m_nodes.reserve( num * 2 );
+    BuildRecursive( bounds, centers.data(), 0, num );
+}
+
+/*
+====================================================
+BVH::BuildRecursive
+
+Splits the range of items at the median of the longest axis of their centers.
+Median splits keep the tree balanced, so the depth stays at log2( N ).
+====================================================
+*/
+int BVH::BuildRecursive( const Bounds * bounds, const Vec3 * centers, const int first, const int count ) {
+    const int nodeIdx = (int)m_nodes.size();
+    m_nodes.push_back( node_t() );
+
+    Bounds nodeBounds;
+    Bounds centerBounds;
+    for ( int i = first; i < first + count; i++ ) {
+        nodeBounds.Expand( bounds[ m_items[ i ] ] );
+        centerBounds.Expand( centers[ m_items[ i ] ] );
+    }
+
+    if ( count <= MAX_LEAF_ITEMS ) {
+        node_t & node = m_nodes[ nodeIdx ];
+        node.bounds = nodeBounds;
+        node.left = -1;
+        node.right = -1;
+        node.first = first;
+        node.count = count;
+        return nodeIdx;
+    }
+
+    const Vec3 widths( centerBounds.WidthX(), centerBounds.WidthY(), centerBounds.WidthZ() );
+    int axis = 0;
+    if ( widths[ 1 ] > widths[ axis ] ) {
+        axis = 1;
+    }
+    if ( widths[ 2 ] > widths[ axis ] ) {
+        axis = 2;
+    }
+
+    const int half = count / 2;
+    int * begin = m_items.data() + first;
+    std::nth_element( begin, begin + half, begin + count, [ centers, axis ]( const int a, const int b ) {
+        return centers[ a ][ axis ] < centers[ b ][ axis ];
+    } );
+
+    const int left = BuildRecursive( bounds, centers, first, half );
+    const int right = BuildRecursive( bounds, centers, first + half, count - half );
+
+    node_t & node = m_nodes[ nodeIdx ];
+    node.bounds = nodeBounds;
+    node.left = left;
+    node.right = right;
+    node.first = first;
+    node.count = count;
+    return nodeIdx;
+}
+
+/*
+====================================================
+BVH::Query
+====================================================
+*/
+void BVH::Query( const Bounds & bounds, std::vector< int > & items ) const {
+    Query( bounds, [ &items ]( const int item ) {
+        items.push_back( item );
+    } );
+}
@@ -0,0 +1,221 @@
+//
+//	BVH.h
+//
+#pragma once
+#include "Math/Vector.h"
+#include "Math/Bounds.h"
+#include <vector>
+
+// How a node's bounds lie against a query volume
+enum volumeTest_t {
+	VOLUME_OUTSIDE,
+	VOLUME_INTERSECTS,
+	VOLUME_INSIDE,
+};
+
+/*
+====================================================
+BVH
+
+A bounding volume hierarchy built once over a fixed set of bounds.
+The nodes live in a flat array, the leaves reference ranges of m_items,
+which hold the indices of the bounds that were passed to Build.
+====================================================
+*/
+class BVH {
+public:
+	struct node_t {
+		Bounds bounds;
+		int left;	// index of the left child, -1 for leaves
+		int right;	// index of the right child, -1 for leaves
+		int first;	// first entry in m_items of the items below the node
+		int count;	// number of entries in m_items below the node
+
+		bool IsLeaf() const { return left < 0; }
+	};
+
+	BVH() {}
+
+	void Build( const Bounds * bounds, const int num );
+	void Clear();
+
+	bool IsEmpty() const { return m_nodes.empty(); }
+	const Bounds & GetBounds() const { return m_nodes[ 0 ].bounds; }
+
+	void Query( const Bounds & bounds, std::vector< int > & items ) const;
+
+	template< typename Callback >
+	void Query( const Bounds & bounds, Callback && callback ) const;
+
+	template< typename Callback >
+	void QueryRay( const Vec3 & start, const Vec3 & dir, float & maxT, Callback && callback ) const;
+
+	template< typename Classify, typename Callback >
+	void QueryVolume( Classify && classify, Callback && callback ) const;
+
+private:
+	int BuildRecursive( const Bounds * bounds, const Vec3 * centers, const int first, const int count );
+
+public:
+	static const int MAX_LEAF_ITEMS = 2;
+	static const int MAX_DEPTH = 64;
+
+	std::vector< node_t > m_nodes;
+	std::vector< int > m_items;
+};
+
+/*
+====================================================
+BVH::Query
+
+Calls callback( itemIndex ) for every item whose bounds overlap the query bounds
+====================================================
+*/
+template< typename Callback >
+inline void BVH::Query( const Bounds & bounds, Callback && callback ) const {
+	if ( m_nodes.empty() ) {
+		return;
+	}
+
+	int stack[ MAX_DEPTH ];
+	int stackSize = 0;
+	stack[ stackSize++ ] = 0;
+
+	while ( stackSize > 0 ) {
+		const node_t & node = m_nodes[ stack[ --stackSize ] ];
+		if ( !node.bounds.DoesIntersect( bounds ) ) {
+			continue;
+		}
+
+		if ( node.IsLeaf() ) {
+			for ( int i = 0; i < node.count; i++ ) {
+				callback( m_items[ node.first + i ] );
+			}
+			continue;
+		}
+
+		stack[ stackSize++ ] = node.left;
+		stack[ stackSize++ ] = node.right;
+	}
+}
+
+/*
+====================================================
+RayBounds
+
+Slab test of the ray start + dir * t against the bounds for t in [ 0, maxT ].
+invDir is the component wise inverse of the direction.
+====================================================
+*/
+inline bool RayBounds( const Vec3 & start, const Vec3 & invDir, const Bounds & bounds, const float maxT, float & tEntry ) {
+	float tMin = 0.0f;
+	float tMax = maxT;
+	for ( int axis = 0; axis < 3; axis++ ) {
+		float t0 = ( bounds.mins[ axis ] - start[ axis ] ) * invDir[ axis ];
+		float t1 = ( bounds.maxs[ axis ] - start[ axis ] ) * invDir[ axis ];
+		if ( t0 > t1 ) {
+			const float tmp = t0;
+			t0 = t1;
+			t1 = tmp;
+		}
+		// Written so that the NaN of a zero direction on a slab boundary never rejects
+		tMin = ( t0 > tMin ) ? t0 : tMin;
+		tMax = ( t1 < tMax ) ? t1 : tMax;
+		if ( tMin > tMax ) {
+			return false;
+		}
+	}
+	tEntry = tMin;
+	return true;
+}
+
+/*
+====================================================
+BVH::QueryRay
+
+Calls callback( itemIndex ) for every item whose bounds the ray start + dir * t
+crosses with t in [ 0, maxT ], nearer nodes first.  The callback may shorten
+maxT to cull everything behind a hit, and returns false to stop the query.
+====================================================
+*/
+template< typename Callback >
+inline void BVH::QueryRay( const Vec3 & start, const Vec3 & dir, float & maxT, Callback && callback ) const {
+	if ( m_nodes.empty() ) {
+		return;
+	}
+
+	const Vec3 invDir( 1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z );
+
+	int stack[ MAX_DEPTH ];
+	int stackSize = 0;
+	stack[ stackSize++ ] = 0;
+
+	while ( stackSize > 0 ) {
+		const node_t & node = m_nodes[ stack[ --stackSize ] ];
+		float tEntry;
+		if ( !RayBounds( start, invDir, node.bounds, maxT, tEntry ) ) {
+			continue;
+		}
+
+		if ( node.IsLeaf() ) {
+			for ( int i = 0; i < node.count; i++ ) {
+				if ( !callback( m_items[ node.first + i ] ) ) {
+					return;
+				}
+			}
+			continue;
+		}
+
+		// Push the farther child first so the nearer one is visited first
+		const Bounds & left = m_nodes[ node.left ].bounds;
+		const Bounds & right = m_nodes[ node.right ].bounds;
+		const float leftDist = ( left.mins + left.maxs ).Dot( dir );
+		const float rightDist = ( right.mins + right.maxs ).Dot( dir );
+		if ( leftDist < rightDist ) {
+			stack[ stackSize++ ] = node.right;
+			stack[ stackSize++ ] = node.left;
+		} else {
+			stack[ stackSize++ ] = node.left;
+			stack[ stackSize++ ] = node.right;
+		}
+	}
+}
+
+/*
+====================================================
+BVH::QueryVolume
+
+Calls callback( itemIndex, isInside ) for every item below the nodes that
+classify( bounds ) doesn't find outside the volume.  The items of a node
+that lies inside it are passed on without visiting its children, with isInside set.
+====================================================
+*/
+template< typename Classify, typename Callback >
+inline void BVH::QueryVolume( Classify && classify, Callback && callback ) const {
+	if ( m_nodes.empty() ) {
+		return;
+	}
+
+	int stack[ MAX_DEPTH ];
+	int stackSize = 0;
+	stack[ stackSize++ ] = 0;
+
+	while ( stackSize > 0 ) {
+		const node_t & node = m_nodes[ stack[ --stackSize ] ];
+		const volumeTest_t test = classify( node.bounds );
+		if ( VOLUME_OUTSIDE == test ) {
+			continue;
+		}
+
+		if ( VOLUME_INSIDE == test || node.IsLeaf() ) {
+			const bool isInside = ( VOLUME_INSIDE == test );
+			for ( int i = 0; i < node.count; i++ ) {
+				callback( m_items[ node.first + i ], isInside );
+			}
+			continue;
+		}
+
+		stack[ stackSize++ ] = node.left;
+		stack[ stackSize++ ] = node.right;
+	}
+}
@@ -12,7 +12,11 @@ Body::Body() :
     m_position( 0.0f ),
     m_orientation( 0.0f, 0.0f, 0.0f, 1.0f ),
     m_shape( NULL ),
-    m_linearVelocity(0.0f)
+    m_linearVelocity(0.0f),
+    m_isKinematic( false ),
+    m_alwaysContinuous( false ),
+    m_collisionLayer( 1 ),
+    m_collisionMask( 0xffffffff )
 {
 }
 
@@ -94,7 +98,11 @@ void Body::ApplyImpulseAngular(const Vec3 &impulse)
     // dL = I dw = r x J
     // => dw = I^-1 * (r x J)
     m_angularVelocity += GetInverseInertiaTensorWorldSpace() * impulse;
+    ClampAngularVelocity();
+}
 
+void Body::ClampAngularVelocity()
+{
     const float maxAngularSpeed = 30.0f; // 30 rad / s
     if (m_angularVelocity.GetLengthSqr() > maxAngularSpeed * maxAngularSpeed)
     {
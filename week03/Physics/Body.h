@@ -8,9 +8,6 @@
 #include "Math/Bounds.h"
 #include "Shapes.h"
 
-#include "Renderer/model.h"
-#include "Renderer/shader.h"
-
 /*
 ====================================================
 Body
@@ -30,6 +27,21 @@ public:
     float       m_friction;
 	Shape *		m_shape;
 
+    // Infinite mass bodies that are moved by a constraint (like a mover platform).
+    // They stay out of the broadphase's static tree.
+    bool        m_isKinematic;
+
+    bool IsStatic() const { return 0.0f == m_invMass && !m_isKinematic; }
+
+    // Projectiles always search for a time of impact, other bodies only when they move fast enough to tunnel
+    bool        m_alwaysContinuous;
+
+    // Two bodies are only paired when each one's layer is in the other's mask
+    unsigned int m_collisionLayer;
+    unsigned int m_collisionMask;
+
+    bool CanCollideWith( const Body & rhs ) const { return ( m_collisionLayer & rhs.m_collisionMask ) && ( rhs.m_collisionLayer & m_collisionMask ); }
+
     Vec3 GetCenterOfMassWorldSpace() const;
     Vec3 GetCenterOfMassModelSpace() const;
 
@@ -42,6 +54,7 @@ public:
     void ApplyImpulse(const Vec3& impulsePoint, const Vec3& impulse);
     void ApplyImpulseLinear(const Vec3& impulse);
     void ApplyImpulseAngular(const Vec3& impulse);
+    void ClampAngularVelocity();	// the solver changes velocities directly and clamps once it's done
 
     void Update(float dt_sec);
 };
\ No newline at end of file
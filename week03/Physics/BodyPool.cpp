@@ -0,0 +1,196 @@
+//
+//  BodyPool.cpp
+//
+#include "BodyPool.h"
+#include <string.h>
+#include <algorithm>
+
+/*
+====================================================
+BodyPool::~BodyPool
+====================================================
+*/
+BodyPool::~BodyPool() {
+    for ( int i = 0; i < m_chunks.size(); i++ ) {
+        delete[] m_chunks[ i ];
+    }
+    m_chunks.clear();
+}
+
+/*
+====================================================
+BodyPool::reserve
+====================================================
+*/
+void BodyPool::reserve( const int num ) {
+    while ( (int)m_chunks.size() * CHUNK_SIZE < num ) {
+        m_chunks.push_back( new Body[ CHUNK_SIZE ] );
+    }
+    m_generations.reserve( num );
+    m_isAlive.reserve( num );
+}
+
+/*
+====================================================
+BodyPool::Add
+====================================================
+*/
+bodyHandle_t BodyPool::Add( const Body & body ) {
+    int idx;
+    if ( !m_freeSlots.empty() ) {
+        idx = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    } else {
+        idx = m_numSlots++;
+        if ( idx >= (int)m_chunks.size() * CHUNK_SIZE ) {
+            m_chunks.push_back( new Body[ CHUNK_SIZE ] );
+        }
+        // Slots left over from before a clear keep their generation, so old handles stay dead
+        if ( idx >= (int)m_generations.size() ) {
+            m_generations.push_back( 0 );
+        }
+        m_isAlive.push_back( 0 );
+    }
+
+    ( *this )[ idx ] = body;
+    m_isAlive[ idx ] = 1;
+    m_numAlive++;
+    return bodyHandle_t( idx, m_generations[ idx ] );
+}
+
+/*
+====================================================
+BodyPool::Remove
+
+The body stops being alive right away, its slot is only reused after FlushRemoved
+====================================================
+*/
+void BodyPool::Remove( const int idx ) {
+    if ( idx < 0 || idx >= m_numSlots || !m_isAlive[ idx ] ) {
+        return;
+    }
+    m_isAlive[ idx ] = 0;
+    m_generations[ idx ]++;
+    m_numAlive--;
+    m_removedSlots.push_back( idx );
+}
+
+/*
+====================================================
+BodyPool::FlushRemoved
+====================================================
+*/
+void BodyPool::FlushRemoved() {
+    for ( int i = 0; i < m_removedSlots.size(); i++ ) {
+        m_freeSlots.push_back( m_removedSlots[ i ] );
+    }
+    m_removedSlots.clear();
+}
+
+/*
+====================================================
+BodyPool::clear
+
+Keeps the chunks, so refilling the pool doesn't allocate them again
+====================================================
+*/
+void BodyPool::clear() {
+    for ( int i = 0; i < m_numSlots; i++ ) {
+        m_generations[ i ]++;
+    }
+    m_numSlots = 0;
+    m_numAlive = 0;
+    m_isAlive.clear();
+    m_freeSlots.clear();
+    m_removedSlots.clear();
+}
+
+/*
+====================================================
+BodyPool::IndexOf
+
+Returns -1 for pointers that are not into the pool
+====================================================
+*/
+int BodyPool::IndexOf( const Body * body ) const {
+    for ( int i = 0; i < m_chunks.size(); i++ ) {
+        const Body * chunk = m_chunks[ i ];
+        if ( body >= chunk && body < chunk + CHUNK_SIZE ) {
+            const int idx = ( i << CHUNK_SHIFT ) + (int)( body - chunk );
+            return ( idx < m_numSlots ) ? idx : -1;
+        }
+    }
+    return -1;
+}
+
+/*
+====================================================
+BodyPool::SaveState
+
+Dead slots, free or waiting on FlushRemoved, aren't saved.  Nothing
+steps them, so a restore can leave whatever they hold.  The vectors
+keep their capacity, so saving into the same state again doesn't allocate.
+====================================================
+*/
+void BodyPool::SaveState( bodyPoolState_t & state ) const {
+    state.bodies.resize( m_numAlive );
+    Body * saved = state.bodies.data();
+    for ( int i = 0; i < m_numSlots; i++ ) {
+        if ( m_isAlive[ i ] ) {
+            *saved++ = m_chunks[ i >> CHUNK_SHIFT ][ i & ( CHUNK_SIZE - 1 ) ];
+        }
+    }
+    state.generations = m_generations;
+    state.isAlive = m_isAlive;
+    state.freeSlots = m_freeSlots;
+    state.removedSlots = m_removedSlots;
+    state.numSlots = m_numSlots;
+    state.numAlive = m_numAlive;
+}
+
+/*
+====================================================
+BodyPool::RestoreState
+====================================================
+*/
+void BodyPool::RestoreState( const bodyPoolState_t & state ) {
+    const int numSlots = state.size();
+    reserve( numSlots );
+    const Body * saved = state.bodies.data();
+    for ( int i = 0; i < numSlots; i++ ) {
+        if ( state.isAlive[ i ] ) {
+            m_chunks[ i >> CHUNK_SHIFT ][ i & ( CHUNK_SIZE - 1 ) ] = *saved++;
+        }
+    }
+
+    // Slots past the restored ones are free, handles made to them since the save have to stay dead
+    const int oldNumSlots = m_numSlots;
+    if ( m_generations.size() < state.generations.size() ) {
+        m_generations.resize( state.generations.size(), 0 );
+    }
+    for ( int i = numSlots; i < (int)m_generations.size(); i++ ) {
+        const unsigned int generation = m_generations[ i ] + ( ( i < oldNumSlots ) ? 1 : 0 );
+        m_generations[ i ] = ( i < (int)state.generations.size() ) ? std::max( generation, state.generations[ i ] ) : generation;
+    }
+    std::copy( state.generations.begin(), state.generations.begin() + numSlots, m_generations.begin() );
+    m_numSlots = numSlots;
+    m_isAlive = state.isAlive;
+    m_freeSlots = state.freeSlots;
+    m_removedSlots = state.removedSlots;
+    m_numAlive = state.numAlive;
+}
+
+/*
+====================================================
+BodyPool::HasSameSlots
+====================================================
+*/
+bool BodyPool::HasSameSlots( const bodyPoolState_t & state ) const {
+    if ( state.size() != m_numSlots || state.numAlive != m_numAlive || state.removedSlots != m_removedSlots ) {
+        return false;
+    }
+    if ( 0 != memcmp( state.isAlive.data(), m_isAlive.data(), m_numSlots ) ) {
+        return false;
+    }
+    return 0 == memcmp( state.generations.data(), m_generations.data(), sizeof( unsigned int ) * m_numSlots );
+}
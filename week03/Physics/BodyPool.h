@@ -0,0 +1,127 @@
+//
+//	BodyPool.h
+//
+#pragma once
+#include "Body.h"
+#include <vector>
+
+/*
+====================================================
+bodyHandle_t
+
+Refers to a body for as long as it lives.  The generation is bumped every
+time a slot is freed, so handles to removed bodies stop resolving instead
+of silently pointing at whatever reused the slot.
+====================================================
+*/
+struct bodyHandle_t {
+	int index;
+	unsigned int generation;
+
+	bodyHandle_t() : index( -1 ), generation( 0 ) {}
+	bodyHandle_t( const int idx, const unsigned int gen ) : index( idx ), generation( gen ) {}
+
+	bool operator == ( const bodyHandle_t & rhs ) const { return index == rhs.index && generation == rhs.generation; }
+	bool operator != ( const bodyHandle_t & rhs ) const { return !( *this == rhs ); }
+};
+
+/*
+====================================================
+bodyPoolState_t
+
+The live bodies of a pool and its bookkeeping, see BodyPool::SaveState
+====================================================
+*/
+struct bodyPoolState_t {
+	std::vector< Body > bodies;		// live slots only, in slot order
+	std::vector< unsigned int > generations;
+	std::vector< unsigned char > isAlive;
+	std::vector< int > freeSlots;
+	std::vector< int > removedSlots;
+	int numSlots;
+	int numAlive;
+
+	bodyPoolState_t() : numSlots( 0 ), numAlive( 0 ) {}
+	int size() const { return numSlots; }
+	bool IsAlive( const int idx ) const { return idx < (int)isAlive.size() && 0 != isAlive[ idx ]; }
+};
+
+/*
+====================================================
+BodyPool
+
+Bodies live in fixed size chunks that never move, so Body pointers held
+by constraints, contacts and manifolds stay valid while bodies are added.
+Removed slots go on a free list and are reused by later adds, adding and
+removing are both O(1).
+
+Slots are addressed by index from 0 to size(), dead slots are skipped with IsAlive.
+A removed slot is only reused after FlushRemoved, which gives the owner
+a chance to drop its references to the body first.
+====================================================
+*/
+class BodyPool {
+public:
+	static constexpr int CHUNK_SHIFT = 8;
+	static constexpr int CHUNK_SIZE = 1 << CHUNK_SHIFT;
+
+	BodyPool() : m_numSlots( 0 ), m_numAlive( 0 ) {}
+	~BodyPool();
+	BodyPool( const BodyPool & rhs ) = delete;
+	BodyPool & operator = ( const BodyPool & rhs ) = delete;
+
+	bodyHandle_t Add( const Body & body );
+	void Remove( const int idx );
+	void FlushRemoved();
+	void clear();
+	void reserve( const int num );
+
+	Body * Get( const bodyHandle_t & handle );
+	const Body * Get( const bodyHandle_t & handle ) const;
+	bodyHandle_t GetHandle( const int idx ) const { return bodyHandle_t( idx, m_generations[ idx ] ); }
+	int IndexOf( const Body * body ) const;
+	const std::vector< int > & GetRemovedSlots() const { return m_removedSlots; }
+	unsigned int GetGeneration( const int idx ) const { return m_generations[ idx ]; }
+
+	// Copies the slots out a chunk at a time, and back in again.  Restoring
+	// puts the slots and free lists back as they were, the pool's owner takes
+	// care of the bodies that were added or removed in between.
+	void SaveState( bodyPoolState_t & state ) const;
+	void RestoreState( const bodyPoolState_t & state );
+	bool HasSameSlots( const bodyPoolState_t & state ) const;	// true when nothing was added or removed since the save
+
+	bool IsAlive( const int idx ) const { return 0 != m_isAlive[ idx ]; }
+	int size() const { return m_numSlots; }
+	int GetNumAlive() const { return m_numAlive; }
+
+	Body & operator[]( const int idx ) { return m_chunks[ idx >> CHUNK_SHIFT ][ idx & ( CHUNK_SIZE - 1 ) ]; }
+	const Body & operator[]( const int idx ) const { return m_chunks[ idx >> CHUNK_SHIFT ][ idx & ( CHUNK_SIZE - 1 ) ]; }
+
+private:
+	std::vector< Body * > m_chunks;
+	std::vector< unsigned int > m_generations;
+	std::vector< unsigned char > m_isAlive;
+	std::vector< int > m_freeSlots;		// ready to be reused
+	std::vector< int > m_removedSlots;	// waiting for FlushRemoved
+	int m_numSlots;
+	int m_numAlive;
+};
+
+/*
+====================================================
+BodyPool::Get
+====================================================
+*/
+inline Body * BodyPool::Get( const bodyHandle_t & handle ) {
+	if ( handle.index < 0 || handle.index >= m_numSlots || !m_isAlive[ handle.index ] || m_generations[ handle.index ] != handle.generation ) {
+		return NULL;
+	}
+	return &( *this )[ handle.index ];
+}
+
+inline const Body * BodyPool::Get( const bodyHandle_t & handle ) const {
+	if ( handle.index < 0 || handle.index >= m_numSlots || !m_isAlive[ handle.index ] || m_generations[ handle.index ] != handle.generation ) {
+		return NULL;
+	}
+	return &( *this )[ handle.index ];
+}
@@ -2,6 +2,8 @@
 //  Broadphase.cpp
 //
 #include "Broadphase.h"
+#include "Profiler.h"
+#include <algorithm>
 
 struct psuedoBody_t {
     int id;
@@ -12,16 +14,45 @@ struct psuedoBody_t {
 /*
 ====================================================
 CompareSAP
+
+A total order, so the pairs come out the same whatever qsort does with ties.
+Touching bounds overlap, a min sorts before a max at the same value.
 ====================================================
 */
 int CompareSAP( const void * a, const void * b ) {
     const psuedoBody_t * ea = (const psuedoBody_t *)a;
     const psuedoBody_t * eb = (const psuedoBody_t *)b;
 
-    if ( ea->value < eb->value ) {
-        return -1;
+    if ( ea->value != eb->value ) {
+        return ( ea->value < eb->value ) ? -1 : 1;
+    }
+    if ( ea->ismin != eb->ismin ) {
+        return ea->ismin ? -1 : 1;
+    }
+    if ( ea->id != eb->id ) {
+        return ( ea->id < eb->id ) ? -1 : 1;
     }
-    return 1;
+    return 0;
+}
+
+/*
+====================================================
+GetSweptBounds
+
+The bounds of the body expanded by its motion over the frame
+====================================================
+*/
+static Bounds GetSweptBounds( const Body & body, const float dt_sec ) {
+    Bounds bounds = body.m_shape->GetBounds( body.m_position, body.m_orientation );
+
+    // Expand the bounds by the linear velocity
+    bounds.Expand( bounds.mins + body.m_linearVelocity * dt_sec );
+    bounds.Expand( bounds.maxs + body.m_linearVelocity * dt_sec );
+
+    const float epsilon = 0.01f;
+    bounds.Expand( bounds.mins + Vec3(-1,-1,-1 ) * epsilon );
+    bounds.Expand( bounds.maxs + Vec3( 1, 1, 1 ) * epsilon );
+    return bounds;
 }
 
 /*
@@ -29,27 +60,19 @@ int CompareSAP( const void * a, const void * b ) {
 SortBodiesBounds
 ====================================================
 */
-void SortBodiesBounds( const Body * bodies, const int num, psuedoBody_t * sortedArray, const float dt_sec ) {
+void SortBodiesBounds( const BodyPool & bodies, const int * ids, const int num, psuedoBody_t * sortedArray, const float dt_sec ) {
     Vec3 axis = Vec3( 1, 1, 1 );
     axis.Normalize();
 
     for ( int i = 0; i < num; i++ ) {
-        const Body & body = bodies[ i ];
-        Bounds bounds = body.m_shape->GetBounds( body.m_position, body.m_orientation );
-
-        // Expand the bounds by the linear velocity
-        bounds.Expand( bounds.mins + body.m_linearVelocity * dt_sec );
-        bounds.Expand( bounds.maxs + body.m_linearVelocity * dt_sec );
+        const int id = ids[ i ];
+        const Bounds bounds = GetSweptBounds( bodies[ id ], dt_sec );
 
-        const float epsilon = 0.01f;
-        bounds.Expand( bounds.mins + Vec3(-1,-1,-1 ) * epsilon );
-        bounds.Expand( bounds.maxs + Vec3( 1, 1, 1 ) * epsilon );
-
-        sortedArray[ i * 2 + 0 ].id = i;
+        sortedArray[ i * 2 + 0 ].id = id;
         sortedArray[ i * 2 + 0 ].value = axis.Dot( bounds.mins );
         sortedArray[ i * 2 + 0 ].ismin = true;
 
-        sortedArray[ i * 2 + 1 ].id = i;
+        sortedArray[ i * 2 + 1 ].id = id;
         sortedArray[ i * 2 + 1 ].value = axis.Dot( bounds.maxs );
         sortedArray[ i * 2 + 1 ].ismin = false;
     }
@@ -62,9 +85,7 @@ void SortBodiesBounds( const Body * bodies, const int num, psuedoBody_t * sorted
 BuildPairs
 ====================================================
 */
-void BuildPairs( std::vector< collisionPair_t > & collisionPairs, const psuedoBody_t * sortedBodies, const int num ) {
-    collisionPairs.clear();
-
+void BuildPairs( const BroadPhaseState & state, const BodyPool & bodies, collisionPairs_t & collisionPairs, const psuedoBody_t * sortedBodies, const int num ) {
     // Now that the bodies are sorted, build the collision pairs
     for ( int i = 0; i < num * 2; i++ ) {
         const psuedoBody_t & a = sortedBodies[ i ];
@@ -86,6 +107,10 @@ void BuildPairs( std::vector< collisionPair_t > & collisionPairs, const psuedoBo
                 continue;
             }
 
+            if ( !state.ShouldCollide( bodies, a.id, b.id ) ) {
+                continue;
+            }
+
             pair.b = b.id;
             collisionPairs.push_back( pair );
         }
@@ -97,11 +122,346 @@ void BuildPairs( std::vector< collisionPair_t > & collisionPairs, const psuedoBo
 SweepAndPrune1D
 ====================================================
 */
-void SweepAndPrune1D( const Body * bodies, const int num, std::vector< collisionPair_t > & finalPairs, const float dt_sec ) {
-    psuedoBody_t * sortedBodies = (psuedoBody_t *)alloca( sizeof( psuedoBody_t ) * num * 2 );
+void SweepAndPrune1D( const BroadPhaseState & state, const BodyPool & bodies, const int * ids, const int num, collisionPairs_t & finalPairs, const float dt_sec ) {
+    // The sort buffer comes from wherever the pairs do
+    std::vector< psuedoBody_t, ArenaAllocator< psuedoBody_t > > sortedBodies( num * 2, ArenaAllocator< psuedoBody_t >( finalPairs.get_allocator() ) );
+
+    SortBodiesBounds( bodies, ids, num, sortedBodies.data(), dt_sec );
+    BuildPairs( state, bodies, finalPairs, sortedBodies.data(), num );
+}
+
+/*
+====================================================
+CellKey
+
+Packs 21 bits of each cell coordinate into a single key
+====================================================
+*/
+static unsigned long long CellKey( const int x, const int y, const int z ) {
+    const unsigned long long mask = ( 1ULL << 21 ) - 1;
+    return ( ( (unsigned long long)x & mask ) << 42 ) | ( ( (unsigned long long)y & mask ) << 21 ) | ( (unsigned long long)z & mask );
+}
+
+/*
+====================================================
+CompareHashEntries
+====================================================
+*/
+static bool CompareHashEntries( const BroadPhaseState::hashEntry_t & a, const BroadPhaseState::hashEntry_t & b ) {
+    if ( a.cell != b.cell ) {
+        return a.cell < b.cell;
+    }
+    return a.idx < b.idx;
+}
+
+/*
+====================================================
+SpatialHash
+
+Hashes the swept bounds of the bodies into a uniform grid whose cells are
+the size of the median body.  Bodies sharing a cell are paired, and each
+pair is only emitted from the first cell of the overlap of their cell ranges,
+so it comes out exactly once.  The few bodies that are too large for the
+grid are tested against everything.
+====================================================
+*/
+void SpatialHash( BroadPhaseState & state, const BodyPool & bodies, const int * ids, const int num, collisionPairs_t & finalPairs, const float dt_sec ) {
+    if ( num <= 1 ) {
+        return;
+    }
+
+    std::vector< Bounds > & sweptBounds = state.m_sweptBounds;
+    sweptBounds.resize( num );
+
+    // Size the cells from the median extent of the bodies
+    std::vector< float, ArenaAllocator< float > > extents( num, ArenaAllocator< float >( finalPairs.get_allocator() ) );
+    for ( int i = 0; i < num; i++ ) {
+        sweptBounds[ i ] = GetSweptBounds( bodies[ ids[ i ] ], dt_sec );
+        const Bounds & bounds = sweptBounds[ i ];
+        extents[ i ] = std::max( bounds.WidthX(), std::max( bounds.WidthY(), bounds.WidthZ() ) );
+    }
+    std::nth_element( extents.begin(), extents.begin() + num / 2, extents.end() );
+    const float cellSize = ( extents[ num / 2 ] > 0.0f ) ? extents[ num / 2 ] : 1.0f;
+    const float invCellSize = 1.0f / cellSize;
+
+    const int maxCellsPerBody = 64;
+
+    std::vector< BroadPhaseState::hashEntry_t > & entries = state.m_hashEntries;
+    std::vector< int > & minCells = state.m_minCells;
+    std::vector< int > & oversized = state.m_oversized;
+    entries.clear();
+    oversized.clear();
+    minCells.resize( num * 3 );
+    for ( int i = 0; i < num; i++ ) {
+        const Bounds & bounds = sweptBounds[ i ];
+        const int x0 = (int)floorf( bounds.mins.x * invCellSize );
+        const int y0 = (int)floorf( bounds.mins.y * invCellSize );
+        const int z0 = (int)floorf( bounds.mins.z * invCellSize );
+        const int x1 = (int)floorf( bounds.maxs.x * invCellSize );
+        const int y1 = (int)floorf( bounds.maxs.y * invCellSize );
+        const int z1 = (int)floorf( bounds.maxs.z * invCellSize );
+        minCells[ i * 3 + 0 ] = x0;
+        minCells[ i * 3 + 1 ] = y0;
+        minCells[ i * 3 + 2 ] = z0;
+
+        const long long numCells = (long long)( x1 - x0 + 1 ) * ( y1 - y0 + 1 ) * ( z1 - z0 + 1 );
+        if ( numCells > maxCellsPerBody ) {
+            oversized.push_back( i );
+            continue;
+        }
+
+        for ( int z = z0; z <= z1; z++ ) {
+            for ( int y = y0; y <= y1; y++ ) {
+                for ( int x = x0; x <= x1; x++ ) {
+                    BroadPhaseState::hashEntry_t entry;
+                    entry.cell = CellKey( x, y, z );
+                    entry.idx = i;
+                    entries.push_back( entry );
+                }
+            }
+        }
+    }
+
+    std::sort( entries.begin(), entries.end(), CompareHashEntries );
+
+    // Pair the bodies in each occupied cell
+    for ( int first = 0; first < entries.size(); ) {
+        int last = first + 1;
+        while ( last < entries.size() && entries[ last ].cell == entries[ first ].cell ) {
+            last++;
+        }
+
+        for ( int i = first; i < last; i++ ) {
+            const int a = entries[ i ].idx;
+            for ( int j = i + 1; j < last; j++ ) {
+                const int b = entries[ j ].idx;
+
+                // Only the first shared cell emits the pair
+                const int cx = std::max( minCells[ a * 3 + 0 ], minCells[ b * 3 + 0 ] );
+                const int cy = std::max( minCells[ a * 3 + 1 ], minCells[ b * 3 + 1 ] );
+                const int cz = std::max( minCells[ a * 3 + 2 ], minCells[ b * 3 + 2 ] );
+                if ( CellKey( cx, cy, cz ) != entries[ i ].cell ) {
+                    continue;
+                }
+
+                if ( !sweptBounds[ a ].DoesIntersect( sweptBounds[ b ] ) ) {
+                    continue;
+                }
+                if ( !state.ShouldCollide( bodies, ids[ a ], ids[ b ] ) ) {
+                    continue;
+                }
+
+                collisionPair_t pair;
+                pair.a = ids[ a ];
+                pair.b = ids[ b ];
+                finalPairs.push_back( pair );
+            }
+        }
+
+        first = last;
+    }
+
+    // Oversized bodies are tested against every other dynamic body
+    for ( int i = 0; i < oversized.size(); i++ ) {
+        const int a = oversized[ i ];
+        for ( int b = 0; b < num; b++ ) {
+            if ( b == a ) {
+                continue;
+            }
+
+            // Pairs of oversized bodies only come from the first of the two
+            const bool isOversizedB = std::binary_search( oversized.begin(), oversized.end(), b );
+            if ( isOversizedB && b < a ) {
+                continue;
+            }
+
+            if ( !sweptBounds[ a ].DoesIntersect( sweptBounds[ b ] ) ) {
+                continue;
+            }
+            if ( !state.ShouldCollide( bodies, ids[ a ], ids[ b ] ) ) {
+                continue;
+            }
 
-    SortBodiesBounds( bodies, num, sortedBodies, dt_sec );
-    BuildPairs( finalPairs, sortedBodies, num );
+            collisionPair_t pair;
+            pair.a = ids[ a ];
+            pair.b = ids[ b ];
+            finalPairs.push_back( pair );
+        }
+    }
+}
+
+/*
+====================================================
+BroadPhaseState::Build
+====================================================
+*/
+void BroadPhaseState::Build( const BodyPool & bodies ) {
+    const int num = bodies.size();
+    m_staticIds.clear();
+    m_dynamicIds.clear();
+    m_staticBounds.clear();
+    m_dynamicSlots.assign( num, -1 );
+    for ( int i = 0; i < num; i++ ) {
+        if ( !bodies.IsAlive( i ) ) {
+            continue;
+        }
+
+        const Body & body = bodies[ i ];
+        if ( body.IsStatic() ) {
+            m_staticIds.push_back( i );
+            m_staticBounds.push_back( GetSweptBounds( body, 0.0f ) );
+        } else {
+            m_dynamicSlots[ i ] = (int)m_dynamicIds.size();
+            m_dynamicIds.push_back( i );
+        }
+    }
+    m_staticTree.Build( m_staticBounds.data(), (int)m_staticBounds.size() );
+
+    m_numBodies = num;
+    m_numAlive = bodies.GetNumAlive();
+    m_isValid = true;
+}
+
+/*
+====================================================
+BroadPhaseState::AddBody
+
+Call after adding the body to the pool.  Dynamic bodies are appended
+to the swept bodies, static ones need the tree rebuilt.
+====================================================
+*/
+void BroadPhaseState::AddBody( const BodyPool & bodies, const int idx ) {
+    if ( !m_isValid ) {
+        return;
+    }
+    if ( bodies[ idx ].IsStatic() ) {
+        Invalidate();
+        return;
+    }
+
+    if ( idx >= (int)m_dynamicSlots.size() ) {
+        m_dynamicSlots.resize( idx + 1, -1 );
+    }
+    m_dynamicSlots[ idx ] = (int)m_dynamicIds.size();
+    m_dynamicIds.push_back( idx );
+
+    m_numBodies = bodies.size();
+    m_numAlive++;
+}
+
+/*
+====================================================
+BroadPhaseState::RemoveBody
+
+Call before removing the body from the pool
+====================================================
+*/
+void BroadPhaseState::RemoveBody( const BodyPool & bodies, const int idx ) {
+    if ( !m_isValid ) {
+        return;
+    }
+    if ( idx >= (int)m_dynamicSlots.size() || m_dynamicSlots[ idx ] < 0 ) {
+        Invalidate();
+        return;
+    }
+
+    // Swap the last dynamic body into the hole
+    const int slot = m_dynamicSlots[ idx ];
+    const int last = m_dynamicIds.back();
+    m_dynamicIds[ slot ] = last;
+    m_dynamicSlots[ last ] = slot;
+    m_dynamicIds.pop_back();
+    m_dynamicSlots[ idx ] = -1;
+
+    m_numAlive--;
+}
+
+/*
+====================================================
+PairKey
+
+Order independent key for a pair of body indices
+====================================================
+*/
+static unsigned long long PairKey( const int a, const int b ) {
+    const unsigned long long lo = (unsigned int)std::min( a, b );
+    const unsigned long long hi = (unsigned int)std::max( a, b );
+    return ( hi << 32 ) | lo;
+}
+
+/*
+====================================================
+BroadPhaseState::AddIgnoredPair
+====================================================
+*/
+void BroadPhaseState::AddIgnoredPair( const int a, const int b ) {
+    const unsigned long long key = PairKey( a, b );
+    std::vector< unsigned long long >::iterator it = std::lower_bound( m_ignoredPairs.begin(), m_ignoredPairs.end(), key );
+    if ( it == m_ignoredPairs.end() || *it != key ) {
+        m_ignoredPairs.insert( it, key );
+    }
+}
+
+/*
+====================================================
+BroadPhaseState::IsIgnoredPair
+====================================================
+*/
+bool BroadPhaseState::IsIgnoredPair( const int a, const int b ) const {
+    if ( m_ignoredPairs.empty() ) {
+        return false;
+    }
+    return std::binary_search( m_ignoredPairs.begin(), m_ignoredPairs.end(), PairKey( a, b ) );
+}
+
+/*
+====================================================
+BroadPhaseState::ShouldCollide
+====================================================
+*/
+bool BroadPhaseState::ShouldCollide( const BodyPool & bodies, const int a, const int b ) const {
+    const Body & bodyA = bodies[ a ];
+    const Body & bodyB = bodies[ b ];
+
+    // Skip body pairs with infinite mass
+    if ( 0.0f == bodyA.m_invMass && 0.0f == bodyB.m_invMass ) {
+        return false;
+    }
+
+    if ( !bodyA.CanCollideWith( bodyB ) ) {
+        return false;
+    }
+
+    return !IsIgnoredPair( a, b );
+}
+
+/*
+====================================================
+QueryStatic
+
+Pairs every dynamic body with the static bodies under its swept bounds
+====================================================
+*/
+void QueryStatic( const BroadPhaseState & state, const BodyPool & bodies, collisionPairs_t & finalPairs, const float dt_sec ) {
+    for ( int i = 0; i < state.m_dynamicIds.size(); i++ ) {
+        const int id = state.m_dynamicIds[ i ];
+        const Body & body = bodies[ id ];
+
+        // Infinite mass bodies never collide with each other
+        if ( 0.0f == body.m_invMass ) {
+            continue;
+        }
+
+        const Bounds bounds = GetSweptBounds( body, dt_sec );
+        state.m_staticTree.Query( bounds, [ & ]( const int staticIdx ) {
+            collisionPair_t pair;
+            pair.a = id;
+            pair.b = state.m_staticIds[ staticIdx ];
+            if ( state.ShouldCollide( bodies, pair.a, pair.b ) ) {
+                finalPairs.push_back( pair );
+            }
+        } );
+    }
 }
 
 /*
@@ -109,7 +469,31 @@ void SweepAndPrune1D( const Body * bodies, const int num, std::vector< collision
 BroadPhase
 ====================================================
 */
-void BroadPhase( const Body * bodies, const int num, std::vector< collisionPair_t > & finalPairs, const float dt_sec ) {
-	finalPairs.clear();
-    SweepAndPrune1D(bodies, num, finalPairs, dt_sec);
-}
\ No newline at end of file
+void BroadPhase( BroadPhaseState & state, const BodyPool & bodies, collisionPairs_t & finalPairs, const float dt_sec ) {
+    PROFILE_SCOPE( "BroadPhase" );
+    finalPairs.clear();
+
+    if ( state.NeedsBuild( bodies ) ) {
+        state.Build( bodies );
+    }
+
+    const int numDynamic = (int)state.m_dynamicIds.size();
+    if ( BroadPhaseState::BROADPHASE_SPATIAL_HASH == state.m_type ) {
+        SpatialHash( state, bodies, state.m_dynamicIds.data(), numDynamic, finalPairs, dt_sec );
+    } else {
+        SweepAndPrune1D( state, bodies, state.m_dynamicIds.data(), numDynamic, finalPairs, dt_sec );
+    }
+    QueryStatic( state, bodies, finalPairs, dt_sec );
+}
+
+/*
+====================================================
+BroadPhase
+
+Builds the static tree from scratch, prefer the version that keeps a BroadPhaseState
+====================================================
+*/
+void BroadPhase( const BodyPool & bodies, collisionPairs_t & finalPairs, const float dt_sec ) {
+    BroadPhaseState state;
+    BroadPhase( state, bodies, finalPairs, dt_sec );
+}
@@ -3,6 +3,9 @@
 //
 #pragma once
 #include "Body.h"
+#include "BodyPool.h"
+#include "BVH.h"
+#include "FrameArena.h"
 #include <vector>
 
 
@@ -18,4 +21,72 @@ struct collisionPair_t {
 	}
 };
 
-void BroadPhase( const Body * bodies, const int num, std::vector< collisionPair_t > & finalPairs, const float dt_sec );
\ No newline at end of file
+// Pairs live in the step's FrameArena when the container is given its allocator, on the heap otherwise
+typedef std::vector< collisionPair_t, ArenaAllocator< collisionPair_t > > collisionPairs_t;
+
+/*
+====================================================
+BroadPhaseState
+
+Persistent broadphase data owned by the scene.
+Static bodies are put in a tree once and never refit, the dynamic
+bodies are swept and pruned every frame and then queried against it.
+Dynamic bodies can be added and removed in O(1) with AddBody and RemoveBody,
+call Invalidate for anything else: static bodies coming and going, or
+bodies that change between static and dynamic.
+
+Pairs are filtered here, before the narrow phase: infinite mass pairs,
+bodies whose layers and masks exclude each other, and ignored pairs
+(bodies directly connected by a joint) are never emitted.
+====================================================
+*/
+class BroadPhaseState {
+public:
+	// How the dynamic bodies are paired with each other
+	enum broadPhaseType_t {
+		BROADPHASE_SWEEP_AND_PRUNE,	// general purpose
+		BROADPHASE_SPATIAL_HASH,	// many bodies of about the same size
+	};
+
+	BroadPhaseState() : m_type( BROADPHASE_SWEEP_AND_PRUNE ), m_isValid( false ), m_numBodies( 0 ), m_numAlive( 0 ) {}
+
+	void Invalidate() { m_isValid = false; }
+
+	void Build( const BodyPool & bodies );
+	bool NeedsBuild( const BodyPool & bodies ) const { return !m_isValid || bodies.size() != m_numBodies || bodies.GetNumAlive() != m_numAlive; }
+
+	void AddBody( const BodyPool & bodies, const int idx );
+	void RemoveBody( const BodyPool & bodies, const int idx );
+
+	void ClearIgnoredPairs() { m_ignoredPairs.clear(); }
+	void AddIgnoredPair( const int a, const int b );
+	bool IsIgnoredPair( const int a, const int b ) const;
+
+	bool ShouldCollide( const BodyPool & bodies, const int a, const int b ) const;
+
+public:
+	broadPhaseType_t m_type;
+
+	bool m_isValid;
+	int m_numBodies;	// slots in the pool at the last build
+	int m_numAlive;
+	std::vector< int > m_staticIds;		// body index of each entry in the static tree
+	std::vector< int > m_dynamicIds;
+	std::vector< int > m_dynamicSlots;	// position of each body in m_dynamicIds, -1 for bodies that are not in it
+	std::vector< Bounds > m_staticBounds;
+	BVH m_staticTree;
+	std::vector< unsigned long long > m_ignoredPairs;	// sorted keys of the pairs that never collide
+
+	// Spatial hash scratch, kept between frames to avoid reallocating
+	struct hashEntry_t {
+		unsigned long long cell;
+		int idx;	// index into m_dynamicIds
+	};
+	std::vector< hashEntry_t > m_hashEntries;
+	std::vector< Bounds > m_sweptBounds;
+	std::vector< int > m_minCells;		// three per dynamic body
+	std::vector< int > m_oversized;		// dynamic bodies that cover too many cells to hash
+};
+
+void BroadPhase( BroadPhaseState & state, const BodyPool & bodies, collisionPairs_t & finalPairs, const float dt_sec );
+void BroadPhase( const BodyPool & bodies, collisionPairs_t & finalPairs, const float dt_sec );
@@ -6,8 +6,9 @@
 #include "Math/Quat.h"
 #include "Math/Matrix.h"
 #include "Math/Bounds.h"
-#include "Math/LCP.h"
 #include "../Body.h"
+#include "../Solver.h"
+#include <string.h>
 #include <vector>
 
 /*
@@ -17,17 +18,28 @@ Constraint
 */
 class Constraint {
 public:
+	Constraint() : m_bodyA( NULL ), m_bodyB( NULL ), m_collideConnected( false ) {}
+	virtual ~Constraint() {}
+
+	// PreSolve builds the jacobian, BuildRows hands it to the scene's solver as scalar rows,
+	// and PostSolve runs once their impulses have been stored back for warm starting
 	virtual void PreSolve( const float dt_sec ) {}
-	virtual void Solve() {}
+	virtual int BuildRows( solverRow_t * rows ) { return 0; }
 	virtual void PostSolve() {}
 
+	// Number of rows in the constraint's Jacobian, BuildRows never writes more than this
+	virtual int GetNumRows() const { return 0; }
+
+	// Whatever carries from one update to the next, as GetStateSize floats, for Scene::SaveState
+	virtual int GetStateSize() const { return 0; }
+	virtual void SaveState( float * state ) const {}
+	virtual void RestoreState( const float * state ) {}
+
 	static Mat4 Left( const Quat & q );
 	static Mat4 Right( const Quat & q );
 
 protected:
-	MatMN GetInverseMassMatrix() const;
-	VecN GetVelocities() const;
-	void ApplyImpulses( const VecN & impulses );
+	int InitRows( solverRow_t * rows, const MatMN & jacobian, VecN * cachedLambda ) const;
 
 public:
 	Body * m_bodyA;
@@ -38,101 +50,32 @@ public:
 
 	Vec3 m_anchorB;		// The anchor location in bodyB's space
 	Vec3 m_axisB;		// The axis direction in bodyB's space
+
+	bool m_collideConnected;	// When false the broadphase never pairs bodyA with bodyB
 };
 
 /*
 ====================================================
-Constraint::GetInverseMassMatrix
-====================================================
-*/
-inline MatMN Constraint::GetInverseMassMatrix() const {
-	MatMN invMassMatrix( 12, 12 );
-    invMassMatrix.Zero();
-
-    invMassMatrix.rows[ 0 ][ 0 ] = m_bodyA->m_invMass;
-    invMassMatrix.rows[ 1 ][ 1 ] = m_bodyA->m_invMass;
-    invMassMatrix.rows[ 2 ][ 2 ] = m_bodyA->m_invMass;
-
-    Mat3 invInertiaA = m_bodyA->GetInverseInertiaTensorWorldSpace();
-    for ( int i = 0; i < 3; i++ ) {
-        invMassMatrix.rows[ 3 + i ][ 3 + 0 ] = invInertiaA.rows[ i ][ 0 ];
-        invMassMatrix.rows[ 3 + i ][ 3 + 1 ] = invInertiaA.rows[ i ][ 1 ];
-        invMassMatrix.rows[ 3 + i ][ 3 + 2 ] = invInertiaA.rows[ i ][ 2 ];
-    }
+Constraint::InitRows
 
-    invMassMatrix.rows[ 6 ][ 6 ] = m_bodyB->m_invMass;
-    invMassMatrix.rows[ 7 ][ 7 ] = m_bodyB->m_invMass;
-    invMassMatrix.rows[ 8 ][ 8 ] = m_bodyB->m_invMass;
-
-    Mat3 invInertiaB = m_bodyB->GetInverseInertiaTensorWorldSpace();
-    for ( int i = 0; i < 3; i++ ) {
-        invMassMatrix.rows[ 9 + i ][ 9 + 0 ] = invInertiaB.rows[ i ][ 0 ];
-        invMassMatrix.rows[ 9 + i ][ 9 + 1 ] = invInertiaB.rows[ i ][ 1 ];
-        invMassMatrix.rows[ 9 + i ][ 9 + 2 ] = invInertiaB.rows[ i ][ 2 ];
-    }
-
-	return invMassMatrix;
-}
-
-/*
-====================================================
-Constraint::GetVelocities
+One solver row per row of the 12 column jacobian, with no bias and unbounded lambda.
+Rows are warm started from cachedLambda and store their impulse back in it, when it's given.
 ====================================================
 */
-inline VecN Constraint::GetVelocities() const {
-	VecN q_dt( 12 );
-
-    q_dt[ 0 ] = m_bodyA->m_linearVelocity.x;
-    q_dt[ 1 ] = m_bodyA->m_linearVelocity.y;
-    q_dt[ 2 ] = m_bodyA->m_linearVelocity.z;
-
-    q_dt[ 3 ] = m_bodyA->m_angularVelocity.x;
-    q_dt[ 4 ] = m_bodyA->m_angularVelocity.y;
-    q_dt[ 5 ] = m_bodyA->m_angularVelocity.z;
-
-    q_dt[ 6 ] = m_bodyB->m_linearVelocity.x;
-    q_dt[ 7 ] = m_bodyB->m_linearVelocity.y;
-    q_dt[ 8 ] = m_bodyB->m_linearVelocity.z;
-
-    q_dt[ 9 ] = m_bodyB->m_angularVelocity.x;
-    q_dt[ 10] = m_bodyB->m_angularVelocity.y;
-    q_dt[ 11] = m_bodyB->m_angularVelocity.z;
-
-	return q_dt;
-}
-
-/*
-====================================================
-Constraint::ApplyImpulses
-====================================================
-*/
-inline void Constraint::ApplyImpulses( const VecN & impulses ) {
-    Vec3 forceInternalA( 0.0f );
-    Vec3 torqueInternalA( 0.0f );
-    Vec3 forceInternalB( 0.0f );
-    Vec3 torqueInternalB( 0.0f );
-
-    forceInternalA[ 0 ] = impulses[ 0 ];
-    forceInternalA[ 1 ] = impulses[ 1 ];
-    forceInternalA[ 2 ] = impulses[ 2 ];
-
-    torqueInternalA[ 0 ] = impulses[ 3 ];
-    torqueInternalA[ 1 ] = impulses[ 4 ];
-    torqueInternalA[ 2 ] = impulses[ 5 ];
-
-    forceInternalB[ 0 ] = impulses[ 6 ];
-    forceInternalB[ 1 ] = impulses[ 7 ];
-    forceInternalB[ 2 ] = impulses[ 8 ];
-
-    torqueInternalB[ 0 ] = impulses[ 9 ];
-    torqueInternalB[ 1 ] = impulses[ 10];
-    torqueInternalB[ 2 ] = impulses[ 11];
-
-    m_bodyA->ApplyImpulseLinear( forceInternalA );
-    m_bodyA->ApplyImpulseAngular( torqueInternalA );
-
-    m_bodyB->ApplyImpulseLinear( forceInternalB );
-    m_bodyB->ApplyImpulseAngular( torqueInternalB );
+inline int Constraint::InitRows( solverRow_t * rows, const MatMN & jacobian, VecN * cachedLambda ) const {
+	const Mat3 invInertiaA = GetSolverInverseInertia( m_bodyA );
+	const Mat3 invInertiaB = GetSolverInverseInertia( m_bodyB );
+
+	for ( int i = 0; i < jacobian.M; i++ ) {
+		const VecN & J = jacobian.rows[ i ];
+		InitRow( rows[ i ], m_bodyA, invInertiaA, m_bodyB, invInertiaB,
+			Vec3( J[ 0 ], J[ 1 ], J[ 2 ] ), Vec3( J[ 3 ], J[ 4 ], J[ 5 ] ),
+			Vec3( J[ 6 ], J[ 7 ], J[ 8 ] ), Vec3( J[ 9 ], J[ 10 ], J[ 11 ] ) );
+		if ( NULL != cachedLambda ) {
+			rows[ i ].cachedLambda = &( *cachedLambda )[ i ];
+		}
+	}
+	return jacobian.M;
 }
 
 /*
@@ -107,12 +107,6 @@ void ConstraintConstantVelocity::PreSolve( const float dt_sec ) {
         m_Jacobian.rows[ 1 ][ 11] = J4.z;
     }
 
-    //
-    // Apply warm starting from last frame
-    //
-    const VecN impulses = m_Jacobian.Transpose() * m_cachedLambda;
-    ApplyImpulses( impulses );
-
     //
     //	Calculate the baumgarte stabilization
     //
@@ -124,28 +118,13 @@ void ConstraintConstantVelocity::PreSolve( const float dt_sec ) {
 
 /*
 ================================
-ConstraintConstantVelocity::Solve
+ConstraintConstantVelocity::BuildRows
 ================================
 */
-void ConstraintConstantVelocity::Solve() {
-    const MatMN JacobianTranspose = m_Jacobian.Transpose();
-
-    // Build the system of equations
-    const VecN q_dt = GetVelocities();
-    const MatMN invMassMatrix = GetInverseMassMatrix();
-    const MatMN J_W_Jt = m_Jacobian * invMassMatrix * JacobianTranspose;
-    VecN rhs = m_Jacobian * q_dt * -1.0f;
-    rhs[ 0 ] -= m_baumgarte;
-
-    // Solve for the Lagrange multipliers
-    const VecN lambdaN = LCP_GaussSeidel( J_W_Jt, rhs );
-
-    // Apply the impulses
-    const VecN impulses = JacobianTranspose * lambdaN;
-    ApplyImpulses( impulses );
-
-    // Accumulate the impulses for warm starting
-    m_cachedLambda += lambdaN;
+int ConstraintConstantVelocity::BuildRows( solverRow_t * rows ) {
+    const int numRows = InitRows( rows, m_Jacobian, &m_cachedLambda );
+    rows[ 0 ].bias = m_baumgarte;
+    return numRows;
 }
 
 /*
@@ -350,12 +329,6 @@ void ConstraintConstantVelocityLimited::PreSolve( const float dt_sec ) {
         m_Jacobian.rows[ 3 ][ 11] = J4.z;
     }
 
-    //
-    // Apply warm starting from last frame
-    //
-    const VecN impulses = m_Jacobian.Transpose() * m_cachedLambda;
-    ApplyImpulses( impulses );
-
     //
     //	Calculate the baumgarte stabilization
     //
@@ -367,47 +340,31 @@ void ConstraintConstantVelocityLimited::PreSolve( const float dt_sec ) {
 
 /*
 ================================
-ConstraintConstantVelocityLimited::Solve
+ConstraintConstantVelocityLimited::BuildRows
 ================================
 */
-void ConstraintConstantVelocityLimited::Solve() {
-    const MatMN JacobianTranspose = m_Jacobian.Transpose();
-
-    // Build the system of equations
-    const VecN q_dt = GetVelocities();
-    const MatMN invMassMatrix = GetInverseMassMatrix();
-    const MatMN J_W_Jt = m_Jacobian * invMassMatrix * JacobianTranspose;
-    VecN rhs = m_Jacobian * q_dt * -1.0f;
-    rhs[ 0 ] -= m_baumgarte;
+int ConstraintConstantVelocityLimited::BuildRows( solverRow_t * rows ) {
+    const int numRows = InitRows( rows, m_Jacobian, &m_cachedLambda );
+    rows[ 0 ].bias = m_baumgarte;
 
-    // Solve for the Lagrange multipliers
-    VecN lambdaN = LCP_GaussSeidel( J_W_Jt, rhs );
-
-    // Clamp the torque from the angle constraint.
-    // We need to make sure it's a restorative torque.
+    // The torques from the angle limits may only be restorative
     if ( m_isAngleViolatedU ) {
         if ( m_angleU > 0.0f ) {
-            lambdaN[ 2 ] = std::min( 0.0f, lambdaN[ 2 ] );
+            rows[ 2 ].lambdaMax = 0.0f;
         }
         if ( m_angleU < 0.0f ) {
-            lambdaN[ 2 ] = std::max( 0.0f, lambdaN[ 2 ] );
+            rows[ 2 ].lambdaMin = 0.0f;
         }
     }
     if ( m_isAngleViolatedV ) {
         if ( m_angleV > 0.0f ) {
-            lambdaN[ 3 ] = std::min( 0.0f, lambdaN[ 3 ] );
+            rows[ 3 ].lambdaMax = 0.0f;
         }
         if ( m_angleV < 0.0f ) {
-            lambdaN[ 3 ] = std::max( 0.0f, lambdaN[ 3 ] );
+            rows[ 3 ].lambdaMin = 0.0f;
         }
     }
-
-    // Apply the impulses
-    const VecN impulses = JacobianTranspose * lambdaN;
-    ApplyImpulses( impulses );
-
-    // Accumulate the impulses for warm starting
-    m_cachedLambda += lambdaN;
+    return numRows;
 }
 
 /*
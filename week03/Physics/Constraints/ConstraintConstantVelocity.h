@@ -16,8 +16,12 @@ public:
 		m_baumgarte = 0.0f;
 	}
 	void PreSolve( const float dt_sec ) override;
-	void Solve() override;
+	int BuildRows( solverRow_t * rows ) override;
 	void PostSolve() override;
+	int GetNumRows() const override { return m_Jacobian.M; }
+	int GetStateSize() const override { return m_cachedLambda.N; }
+	void SaveState( float * state ) const override { memcpy( state, m_cachedLambda.data, sizeof( float ) * m_cachedLambda.N ); }
+	void RestoreState( const float * state ) override { memcpy( m_cachedLambda.data, state, sizeof( float ) * m_cachedLambda.N ); }
 
 	Quat m_q0;	// The initial relative quaternion q1 * q2^-1
 
@@ -43,8 +47,12 @@ public:
 		m_angleV = 0.0f;
 	}
 	void PreSolve( const float dt_sec ) override;
-	void Solve() override;
+	int BuildRows( solverRow_t * rows ) override;
 	void PostSolve() override;
+	int GetNumRows() const override { return m_Jacobian.M; }
+	int GetStateSize() const override { return m_cachedLambda.N; }
+	void SaveState( float * state ) const override { memcpy( state, m_cachedLambda.data, sizeof( float ) * m_cachedLambda.N ); }
+	void RestoreState( const float * state ) override { memcpy( m_cachedLambda.data, state, sizeof( float ) * m_cachedLambda.N ); }
 
 	Quat m_q0;	// The initial relative quaternion q1^-1 * q2
 
@@ -39,12 +39,6 @@ void ConstraintDistance::PreSolve( const float dt_sec )
     m_Jacobian.rows[ 0 ][ 10] = J4.y;
     m_Jacobian.rows[ 0 ][ 11] = J4.z;
 
-    //
-    // Apply warm starting from last frame
-    //
-    const VecN impulses = m_Jacobian.Transpose() * m_cachedLambda;
-    ApplyImpulses( impulses );
-
     //
     //	Calculate the baumgarte stabilization
     //
@@ -54,26 +48,11 @@ void ConstraintDistance::PreSolve( const float dt_sec )
     m_baumgarte = ( Beta / dt_sec ) * C;
 }
 
-void ConstraintDistance::Solve()
+int ConstraintDistance::BuildRows( solverRow_t * rows )
 {
-    const MatMN JacobianTranspose = m_Jacobian.Transpose();
-
-    // Build the system of equations
-    const VecN q_dt = GetVelocities();
-    const MatMN invMassMatrix = GetInverseMassMatrix();
-    const MatMN J_W_Jt = m_Jacobian * invMassMatrix * JacobianTranspose;
-    VecN rhs = m_Jacobian * q_dt * -1.0f;
-    rhs[ 0 ] -= m_baumgarte;
-
-    // Solve for the Lagrange multipliers
-    const VecN lambdaN = LCP_GaussSeidel( J_W_Jt, rhs );
-
-    // Apply the impulses
-    const VecN impulses = JacobianTranspose * lambdaN;
-    ApplyImpulses( impulses );
-
-    // Accumulate the impulses for warm starting
-    m_cachedLambda += lambdaN;
+    const int numRows = InitRows( rows, m_Jacobian, &m_cachedLambda );
+    rows[ 0 ].bias = m_baumgarte;
+    return numRows;
 }
 
 void ConstraintDistance::PostSolve()
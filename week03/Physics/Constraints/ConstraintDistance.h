@@ -19,8 +19,12 @@ public:
 	}
 
 	void PreSolve( const float dt_sec ) override;
-	void Solve() override;
+	int BuildRows( solverRow_t * rows ) override;
 	void PostSolve() override;
+	int GetNumRows() const override { return m_Jacobian.M; }
+	int GetStateSize() const override { return m_cachedLambda.N; }
+	void SaveState( float * state ) const override { memcpy( state, m_cachedLambda.data, sizeof( float ) * m_cachedLambda.N ); }
+	void RestoreState( const float * state ) override { memcpy( m_cachedLambda.data, state, sizeof( float ) * m_cachedLambda.N ); }
 
 private:
 	MatMN m_Jacobian;
@@ -51,8 +51,6 @@ void ConstraintHingeQuat::PreSolve( const float dt_sec ) {
     const Mat4 MatA = P * Left( q1_inv ) * Right( q2 * q0_inv ) * P_T * -0.5f;
     const Mat4 MatB = P * Left( q1_inv ) * Right( q2 * q0_inv ) * P_T * 0.5f;
 
-    const MatMN invMassMatrix = GetInverseMassMatrix();
-
     m_Jacobian.Zero();
 
     //
@@ -131,12 +129,6 @@ void ConstraintHingeQuat::PreSolve( const float dt_sec ) {
         m_Jacobian.rows[ 2 ][ 11] = J4.z;
     }
 
-    //
-    // Apply warm starting from last frame
-    //
-    const VecN impulses = m_Jacobian.Transpose() * m_cachedLambda;
-    ApplyImpulses( impulses );
-
     //
     //	Calculate the baumgarte stabilization
     //
@@ -148,28 +140,13 @@ void ConstraintHingeQuat::PreSolve( const float dt_sec ) {
 
 /*
 ================================
-ConstraintHingeQuat::Solve
+ConstraintHingeQuat::BuildRows
 ================================
 */
-void ConstraintHingeQuat::Solve() {
-    const MatMN JacobianTranspose = m_Jacobian.Transpose();
-
-    // Build the system of equations
-    const VecN q_dt = GetVelocities();
-    const MatMN invMassMatrix = GetInverseMassMatrix();
-    const MatMN J_W_Jt = m_Jacobian * invMassMatrix * JacobianTranspose;
-    VecN rhs = m_Jacobian * q_dt * -1.0f;
-    rhs[ 0 ] -= m_baumgarte;
-
-    // Solve for the Lagrange multipliers
-    const VecN lambdaN = LCP_GaussSeidel( J_W_Jt, rhs );
-
-    // Apply the impulses
-    const VecN impulses = JacobianTranspose * lambdaN;
-    ApplyImpulses( impulses );
-
-    // Accumulate the impulses for warm starting
-    m_cachedLambda += lambdaN;
+int ConstraintHingeQuat::BuildRows( solverRow_t * rows ) {
+    const int numRows = InitRows( rows, m_Jacobian, &m_cachedLambda );
+    rows[ 0 ].bias = m_baumgarte;
+    return numRows;
 }
 
 /*
@@ -355,12 +332,6 @@ void ConstraintHingeQuatLimited::PreSolve( const float dt_sec ) {
         m_Jacobian.rows[ 3 ][ 11] = J4.z;
     }
 
-    //
-    // Apply warm starting from last frame
-    //
-    const VecN impulses = m_Jacobian.Transpose() * m_cachedLambda;
-    ApplyImpulses( impulses );
-
     //
     //	Calculate the baumgarte stabilization
     //
@@ -372,39 +343,23 @@ void ConstraintHingeQuatLimited::PreSolve( const float dt_sec ) {
 
 /*
 ================================
-ConstraintHingeQuatLimited::Solve
+ConstraintHingeQuatLimited::BuildRows
 ================================
 */
-void ConstraintHingeQuatLimited::Solve() {
-    const MatMN JacobianTranspose = m_Jacobian.Transpose();
-
-    // Build the system of equations
-    const VecN q_dt = GetVelocities();
-    const MatMN invMassMatrix = GetInverseMassMatrix();
-    const MatMN J_W_Jt = m_Jacobian * invMassMatrix * JacobianTranspose;
-    VecN rhs = m_Jacobian * q_dt * -1.0f;
-    rhs[ 0 ] -= m_baumgarte;
+int ConstraintHingeQuatLimited::BuildRows( solverRow_t * rows ) {
+    const int numRows = InitRows( rows, m_Jacobian, &m_cachedLambda );
+    rows[ 0 ].bias = m_baumgarte;
 
-    // Solve for the Lagrange multipliers
-    VecN lambdaN = LCP_GaussSeidel( J_W_Jt, rhs );
-
-    // Clamp the torque from the angle constraint.
-    // We need to make sure it's a restorative torque.
+    // The torque from the angle limit may only be restorative
     if ( m_isAngleViolated ) {
         if ( m_relativeAngle > 0.0f ) {
-            lambdaN[ 3 ] = std::min( 0.0f, lambdaN[ 3 ] );
+            rows[ 3 ].lambdaMax = 0.0f;
         }
         if ( m_relativeAngle < 0.0f ) {
-            lambdaN[ 3 ] = std::max( 0.0f, lambdaN[ 3 ] );
+            rows[ 3 ].lambdaMin = 0.0f;
         }
     }
-
-    // Apply the impulses
-    const VecN impulses = JacobianTranspose * lambdaN;
-    ApplyImpulses( impulses );
-
-    // Accumulate the impulses for warm starting
-    m_cachedLambda += lambdaN;
+    return numRows;
 }
 
 /*
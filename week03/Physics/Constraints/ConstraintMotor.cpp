@@ -170,10 +170,10 @@ void ConstraintMotor::PreSolve( const float dt_sec ) {
 
 /*
 ================================
-ConstraintMotor::Solve
+ConstraintMotor::BuildRows
 ================================
 */
-void ConstraintMotor::Solve() {
+int ConstraintMotor::BuildRows( solverRow_t * rows ) {
     const Vec3 motorAxis = m_bodyA->m_orientation.RotatePoint( m_motorAxis );
 
     VecN w_dt( 12 );
@@ -185,21 +185,13 @@ void ConstraintMotor::Solve() {
     w_dt[ 10 ] = motorAxis[ 1 ] * m_motorSpeed;
     w_dt[ 11 ] = motorAxis[ 2 ] * m_motorSpeed;
 
-    const MatMN JacobianTranspose = m_Jacobian.Transpose();
-
-    // Build the system of equations
-    const VecN q_dt = GetVelocities() - w_dt;	// By subtracting by the desired velocity, the solver is tricked into applying the impulse to give us that velocity
-    const MatMN invMassMatrix = GetInverseMassMatrix();
-    const MatMN J_W_Jt = m_Jacobian * invMassMatrix * JacobianTranspose;
-    VecN rhs = m_Jacobian * q_dt * -1.0f;
-    for ( int i = 0; i < 3; i++ ) {
-        rhs[ i ] -= m_baumgarte[ i ];
+    // Biasing the rows by the desired velocity tricks the solver into applying the impulse to give us that velocity
+    const int numRows = InitRows( rows, m_Jacobian, NULL );
+    for ( int i = 0; i < numRows; i++ ) {
+        rows[ i ].bias = -m_Jacobian.rows[ i ].Dot( w_dt );
+        if ( i < 3 ) {
+            rows[ i ].bias += m_baumgarte[ i ];
+        }
     }
-
-    // Solve for the Lagrange multipliers
-    VecN lambdaN = LCP_GaussSeidel( J_W_Jt, rhs );
-
-    // Apply the impulses
-    const VecN impulses = JacobianTranspose * lambdaN;
-    ApplyImpulses( impulses );
+    return numRows;
 }
\ No newline at end of file
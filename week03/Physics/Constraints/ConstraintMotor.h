@@ -18,7 +18,8 @@ public:
 	}
 
 	void PreSolve( const float dt_sec ) override;
-	void Solve() override;
+	int BuildRows( solverRow_t * rows ) override;
+	int GetNumRows() const override { return m_Jacobian.M; }
 
 	float m_motorSpeed;
 	Vec3 m_motorAxis;	// Motor Axis in BodyA's local space
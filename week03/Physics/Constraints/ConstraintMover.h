@@ -15,5 +15,9 @@ public:
 
 	void PreSolve( const float dt_sec ) override;
 
+	int GetStateSize() const override { return 1; }
+	void SaveState( float * state ) const override { state[ 0 ] = m_time; }
+	void RestoreState( const float * state ) override { m_time = state[ 0 ]; }
+
 	float m_time;
 };
\ No newline at end of file
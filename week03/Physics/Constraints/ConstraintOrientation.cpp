@@ -154,23 +154,11 @@ void ConstraintOrientation::PreSolve( const float dt_sec ) {
 
 /*
 ================================
-ConstraintOrientation::Solve
+ConstraintOrientation::BuildRows
 ================================
 */
-void ConstraintOrientation::Solve() {
-    const MatMN JacobianTranspose = m_Jacobian.Transpose();
-
-    // Build the system of equations
-    const VecN q_dt = GetVelocities();
-    const MatMN invMassMatrix = GetInverseMassMatrix();
-    const MatMN J_W_Jt = m_Jacobian * invMassMatrix * JacobianTranspose;
-    VecN rhs = m_Jacobian * q_dt * -1.0f;
-    rhs[ 0 ] -= m_baumgarte;
-
-    // Solve for the Lagrange multipliers
-    VecN lambdaN = LCP_GaussSeidel( J_W_Jt, rhs );
-
-    // Apply the impulses
-    const VecN impulses = JacobianTranspose * lambdaN;
-    ApplyImpulses( impulses );
+int ConstraintOrientation::BuildRows( solverRow_t * rows ) {
+    const int numRows = InitRows( rows, m_Jacobian, NULL );
+    rows[ 0 ].bias = m_baumgarte;
+    return numRows;
 }
\ No newline at end of file
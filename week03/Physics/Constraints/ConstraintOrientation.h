@@ -16,7 +16,8 @@ public:
 	}
 
 	void PreSolve( const float dt_sec ) override;
-	void Solve() override;
+	int BuildRows( solverRow_t * rows ) override;
+	int GetNumRows() const override { return m_Jacobian.M; }
 
 	Quat m_q0;			// The initial relative quaternion q1^-1 * q2
 
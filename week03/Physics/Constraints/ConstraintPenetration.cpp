@@ -33,88 +33,21 @@ void ConstraintPenetration::PreSolve( const float dt_sec ) {
     u = m_bodyA->m_orientation.RotatePoint( u );
     v = m_bodyA->m_orientation.RotatePoint( v );
 
-    //
-    //	Penetration Constraint
-    //
-    m_Jacobian.Zero();
-
-    // First row is the primary distance constraint that holds the anchor points together
-    Vec3 J1 = normal * -1.0f;
-    m_Jacobian.rows[ 0 ][ 0 ] = J1.x;
-    m_Jacobian.rows[ 0 ][ 1 ] = J1.y;
-    m_Jacobian.rows[ 0 ][ 2 ] = J1.z;
-
-    Vec3 J2 = ra.Cross( normal * -1.0f );
-    m_Jacobian.rows[ 0 ][ 3 ] = J2.x;
-    m_Jacobian.rows[ 0 ][ 4 ] = J2.y;
-    m_Jacobian.rows[ 0 ][ 5 ] = J2.z;
-
-    Vec3 J3 = normal * 1.0f;
-    m_Jacobian.rows[ 0 ][ 6 ] = J3.x;
-    m_Jacobian.rows[ 0 ][ 7 ] = J3.y;
-    m_Jacobian.rows[ 0 ][ 8 ] = J3.z;
-
-    Vec3 J4 = rb.Cross( normal * 1.0f );
-    m_Jacobian.rows[ 0 ][ 9 ] = J4.x;
-    m_Jacobian.rows[ 0 ][ 10] = J4.y;
-    m_Jacobian.rows[ 0 ][ 11] = J4.z;
-
-    //
-    //	Friction Jacobians
-    //
-    if ( m_friction > 0.0f ) {
-        Vec3 J1 = u * -1.0f;
-        m_Jacobian.rows[ 1 ][ 0 ] = J1.x;
-        m_Jacobian.rows[ 1 ][ 1 ] = J1.y;
-        m_Jacobian.rows[ 1 ][ 2 ] = J1.z;
-
-        Vec3 J2 = ra.Cross( u * -1.0f );
-        m_Jacobian.rows[ 1 ][ 3 ] = J2.x;
-        m_Jacobian.rows[ 1 ][ 4 ] = J2.y;
-        m_Jacobian.rows[ 1 ][ 5 ] = J2.z;
-
-        Vec3 J3 = u * 1.0f;
-        m_Jacobian.rows[ 1 ][ 6 ] = J3.x;
-        m_Jacobian.rows[ 1 ][ 7 ] = J3.y;
-        m_Jacobian.rows[ 1 ][ 8 ] = J3.z;
-
-        Vec3 J4 = rb.Cross( u * 1.0f );
-        m_Jacobian.rows[ 1 ][ 9 ] = J4.x;
-        m_Jacobian.rows[ 1 ][ 10] = J4.y;
-        m_Jacobian.rows[ 1 ][ 11] = J4.z;
-    }
-    if ( m_friction > 0.0f ) {
-        Vec3 J1 = v * -1.0f;
-        m_Jacobian.rows[ 2 ][ 0 ] = J1.x;
-        m_Jacobian.rows[ 2 ][ 1 ] = J1.y;
-        m_Jacobian.rows[ 2 ][ 2 ] = J1.z;
-
-        Vec3 J2 = ra.Cross( v * -1.0f );
-        m_Jacobian.rows[ 2 ][ 3 ] = J2.x;
-        m_Jacobian.rows[ 2 ][ 4 ] = J2.y;
-        m_Jacobian.rows[ 2 ][ 5 ] = J2.z;
-
-        Vec3 J3 = v * 1.0f;
-        m_Jacobian.rows[ 2 ][ 6 ] = J3.x;
-        m_Jacobian.rows[ 2 ][ 7 ] = J3.y;
-        m_Jacobian.rows[ 2 ][ 8 ] = J3.z;
-
-        Vec3 J4 = rb.Cross( v * 1.0f );
-        m_Jacobian.rows[ 2 ][ 9 ] = J4.x;
-        m_Jacobian.rows[ 2 ][ 10] = J4.y;
-        m_Jacobian.rows[ 2 ][ 11] = J4.z;
-    }
-
-    //
-    // Apply warm starting from last frame
-    //
-    const VecN impulses = m_Jacobian.Transpose() * m_cachedLambda;
-    ApplyImpulses( impulses );
+    m_normalWorld = normal;
+    m_tangentU = u;
+    m_tangentV = v;
+    m_ra = ra;
+    m_rb = rb;
 
     //
     //	Calculate the baumgarte stabilization
     //
     float C = ( b - a ).Dot( normal );
+    if ( C > 0.0f ) {
+        // A speculative contact, the bodies may close the gap this step but no more
+        m_baumgarte = C / dt_sec;
+        return;
+    }
     C = std::min( 0.0f, C + 0.02f );	// Add slop
     float Beta = 0.25f;
     m_baumgarte = Beta * C / dt_sec;
@@ -122,51 +55,41 @@ void ConstraintPenetration::PreSolve( const float dt_sec ) {
 
 /*
 ================================
-ConstraintPenetration::Solve
+ConstraintPenetration::BuildRows
 ================================
 */
-void ConstraintPenetration::Solve() {
-    const MatMN JacobianTranspose = m_Jacobian.Transpose();
-
-    // Build the system of equations
-    const VecN q_dt = GetVelocities();
-    const MatMN invMassMatrix = GetInverseMassMatrix();
-    const MatMN J_W_Jt = m_Jacobian * invMassMatrix * JacobianTranspose;
-    VecN rhs = m_Jacobian * q_dt * -1.0f;
-    rhs[ 0 ] -= m_baumgarte;
-
-    // Solve for the Lagrange multipliers
-    VecN lambdaN = LCP_GaussSeidel( J_W_Jt, rhs );
-
-    // Accumulate the impulses and clamp to within the constraint limits
-    VecN oldLambda = m_cachedLambda;
-    m_cachedLambda += lambdaN;
-    const float lambdaLimit = 0.0f;
-    if ( m_cachedLambda[ 0 ] < lambdaLimit ) {
-        m_cachedLambda[ 0 ] = lambdaLimit;
-    }
-    if ( m_friction > 0.0f ) {
-        const float umg = m_friction * 10.0f * 1.0f / ( m_bodyA->m_invMass + m_bodyB->m_invMass );
-        const float normalForce = fabsf( lambdaN[ 0 ] * m_friction );
-        const float maxForce = ( umg > normalForce ) ? umg : normalForce;
+int ConstraintPenetration::BuildRows( solverRow_t * rows ) {
+    return BuildRows( rows, GetSolverInverseInertia( m_bodyA ), GetSolverInverseInertia( m_bodyB ) );
+}
 
-        if ( m_cachedLambda[ 1 ] > maxForce ) {
-            m_cachedLambda[ 1 ] = maxForce;
-        }
-        if ( m_cachedLambda[ 1 ] < -maxForce ) {
-            m_cachedLambda[ 1 ] = -maxForce;
-        }
+/*
+================================
+ConstraintPenetration::BuildRows
 
-        if ( m_cachedLambda[ 2 ] > maxForce ) {
-            m_cachedLambda[ 2 ] = maxForce;
-        }
-        if ( m_cachedLambda[ 2 ] < -maxForce ) {
-            m_cachedLambda[ 2 ] = -maxForce;
-        }
+The normal row pushes the bodies apart and never pulls.  The friction
+rows are bounded by the friction cone of the normal row's impulse.
+================================
+*/
+int ConstraintPenetration::BuildRows( solverRow_t * rows, const Mat3 & invInertiaA, const Mat3 & invInertiaB ) {
+    const Vec3 & n = m_normalWorld;
+    InitRow( rows[ 0 ], m_bodyA, invInertiaA, m_bodyB, invInertiaB, n * -1.0f, m_ra.Cross( n * -1.0f ), n, m_rb.Cross( n ) );
+    rows[ 0 ].bias = m_baumgarte;
+    rows[ 0 ].lambdaMin = 0.0f;
+    rows[ 0 ].cachedLambda = &m_cachedLambda[ 0 ];
+    if ( m_friction <= 0.0f ) {
+        return 1;
     }
-    lambdaN = m_cachedLambda - oldLambda;
 
-    // Apply the impulses
-    const VecN impulses = JacobianTranspose * lambdaN;
-    ApplyImpulses( impulses );
-}
\ No newline at end of file
+    const Vec3 & u = m_tangentU;
+    InitRow( rows[ 1 ], m_bodyA, invInertiaA, m_bodyB, invInertiaB, u * -1.0f, m_ra.Cross( u * -1.0f ), u, m_rb.Cross( u ) );
+    rows[ 1 ].normalRow = 1;
+    rows[ 1 ].friction = m_friction;
+    rows[ 1 ].cachedLambda = &m_cachedLambda[ 1 ];
+
+    const Vec3 & v = m_tangentV;
+    InitRow( rows[ 2 ], m_bodyA, invInertiaA, m_bodyB, invInertiaB, v * -1.0f, m_ra.Cross( v * -1.0f ), v, m_rb.Cross( v ) );
+    rows[ 2 ].normalRow = 2;
+    rows[ 2 ].friction = m_friction;
+    rows[ 2 ].cachedLambda = &m_cachedLambda[ 2 ];
+    return 3;
+}
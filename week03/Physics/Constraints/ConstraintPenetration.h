@@ -11,19 +11,28 @@ ConstraintPenetration
 */
 class ConstraintPenetration : public Constraint {
 public:
-	ConstraintPenetration() : Constraint(), m_cachedLambda( 3 ), m_Jacobian( 3, 12 ) {
-		m_cachedLambda.Zero();
+	ConstraintPenetration() : Constraint() {
+		ClearCachedLambda();
 		m_baumgarte = 0.0f;
 		m_friction = 0.0f;
 	}
 
 	void PreSolve( const float dt_sec ) override;
-	void Solve() override;
+	int BuildRows( solverRow_t * rows ) override;
+	int BuildRows( solverRow_t * rows, const Mat3 & invInertiaA, const Mat3 & invInertiaB );
+	int GetNumRows() const override { return 3; }
 
-	VecN m_cachedLambda;
+	void ClearCachedLambda() { m_cachedLambda[ 0 ] = m_cachedLambda[ 1 ] = m_cachedLambda[ 2 ] = 0.0f; }
+
+	float m_cachedLambda[ 3 ];	// inline rather than a VecN, manifolds are copied and snapshotted without touching the heap
 	Vec3 m_normal;		// in Body A's local space
 
-	MatMN m_Jacobian;
+	// World space contact frame and lever arms, from PreSolve
+	Vec3 m_normalWorld;
+	Vec3 m_tangentU;
+	Vec3 m_tangentV;
+	Vec3 m_ra;
+	Vec3 m_rb;
 
 	float m_baumgarte;
 	float m_friction;
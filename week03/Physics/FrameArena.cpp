@@ -0,0 +1,167 @@
+//
+//  FrameArena.cpp
+//
+#include "FrameArena.h"
+#include <stdint.h>
+
+static thread_local FrameArena * t_threadArena = NULL;
+
+/*
+====================================================
+AllocBlock
+====================================================
+*/
+static char * AllocBlock( const size_t size ) {
+    return (char *)::operator new( size );
+}
+
+/*
+====================================================
+FrameArena::FrameArena
+====================================================
+*/
+FrameArena::FrameArena( const size_t blockSize ) :
+    m_block( 0 ),
+    m_offset( 0 ),
+    m_used( 0 ),
+    m_blockSize( blockSize ),
+    m_frameHighWater( 0 ),
+    m_highWater( 0 ) {
+    block_t block;
+    block.data = AllocBlock( blockSize );
+    block.size = blockSize;
+    m_blocks.push_back( block );
+}
+
+/*
+====================================================
+FrameArena::~FrameArena
+====================================================
+*/
+FrameArena::~FrameArena() {
+    for ( int i = 0; i < m_blocks.size(); i++ ) {
+        ::operator delete( m_blocks[ i ].data );
+    }
+    m_blocks.clear();
+}
+
+/*
+====================================================
+FrameArena::Alloc
+====================================================
+*/
+void * FrameArena::Alloc( const size_t size, const size_t alignment ) {
+    while ( true ) {
+        const block_t & block = m_blocks[ m_block ];
+        const uintptr_t base = (uintptr_t)block.data;
+        const uintptr_t aligned = ( base + m_offset + alignment - 1 ) & ~( (uintptr_t)alignment - 1 );
+        const size_t start = aligned - base;
+        if ( start + size <= block.size ) {
+            m_used += start + size - m_offset;
+            m_offset = start + size;
+            if ( m_used > m_frameHighWater ) {
+                m_frameHighWater = m_used;
+            }
+            return block.data + start;
+        }
+
+        // The rest of this block is skipped
+        m_used += block.size - m_offset;
+
+        // Move on to the next block, chaining on a new one when the next one is too small
+        const size_t needed = size + alignment;
+        if ( m_block + 1 == (int)m_blocks.size() || m_blocks[ m_block + 1 ].size < needed ) {
+            block_t newBlock;
+            newBlock.size = ( needed > m_blockSize ) ? needed : m_blockSize;
+            newBlock.data = AllocBlock( newBlock.size );
+            m_blocks.insert( m_blocks.begin() + m_block + 1, newBlock );
+        }
+        m_block++;
+        m_offset = 0;
+    }
+}
+
+/*
+====================================================
+FrameArena::Reset
+====================================================
+*/
+void FrameArena::Reset() {
+    if ( m_frameHighWater > m_highWater ) {
+        m_highWater = m_frameHighWater;
+    }
+
+    // Merge the blocks, so the next step fits in one
+    if ( m_blocks.size() > 1 ) {
+        const size_t capacity = GetCapacity();
+        for ( int i = 0; i < m_blocks.size(); i++ ) {
+            ::operator delete( m_blocks[ i ].data );
+        }
+        m_blocks.clear();
+
+        block_t block;
+        block.data = AllocBlock( capacity );
+        block.size = capacity;
+        m_blocks.push_back( block );
+    }
+
+    m_block = 0;
+    m_offset = 0;
+    m_used = 0;
+    m_frameHighWater = 0;
+}
+
+/*
+====================================================
+FrameArena::GetMarker
+====================================================
+*/
+FrameArena::marker_t FrameArena::GetMarker() const {
+    marker_t marker;
+    marker.block = m_block;
+    marker.offset = m_offset;
+    marker.used = m_used;
+    return marker;
+}
+
+/*
+====================================================
+FrameArena::Rewind
+====================================================
+*/
+void FrameArena::Rewind( const marker_t & marker ) {
+    m_block = marker.block;
+    m_offset = marker.offset;
+    m_used = marker.used;
+}
+
+/*
+====================================================
+FrameArena::GetCapacity
+====================================================
+*/
+size_t FrameArena::GetCapacity() const {
+    size_t capacity = 0;
+    for ( int i = 0; i < m_blocks.size(); i++ ) {
+        capacity += m_blocks[ i ].size;
+    }
+    return capacity;
+}
+
+/*
+====================================================
+FrameArena::GetThreadArena
+====================================================
+*/
+FrameArena * FrameArena::GetThreadArena() {
+    return t_threadArena;
+}
+
+/*
+====================================================
+FrameArena::SetThreadArena
+====================================================
+*/
+void FrameArena::SetThreadArena( FrameArena * arena ) {
+    t_threadArena = arena;
+}
@@ -0,0 +1,170 @@
+//
+//	FrameArena.h
+//
+#pragma once
+#include <stddef.h>
+#include <new>
+#include <vector>
+
+/*
+====================================================
+FrameArena
+
+A linear allocator for the temporaries of one simulation step.  Allocating
+bumps a pointer, and nothing is freed until Reset, which the owner calls
+at the start of every step.  When a step needs more than the first block,
+more blocks are chained on, and Reset merges them into one block big
+enough for the whole step, so a steady scene settles into a single block.
+
+Markers allow scratch memory inside a step to be given back early, see
+FrameArenaScope.  Not thread safe, every thread needs its own arena.
+====================================================
+*/
+class FrameArena {
+public:
+	struct marker_t {
+		int block;
+		size_t offset;
+		size_t used;
+	};
+
+	explicit FrameArena( const size_t blockSize = 64 * 1024 );
+	~FrameArena();
+	FrameArena( const FrameArena & rhs ) = delete;
+	FrameArena & operator = ( const FrameArena & rhs ) = delete;
+
+	void * Alloc( const size_t size, const size_t alignment = 16 );
+
+	// Default constructs count Ts, their destructors are never run
+	template< typename T >
+	T * Alloc( const int count );
+
+	void Reset();
+
+	marker_t GetMarker() const;
+	void Rewind( const marker_t & marker );
+
+	size_t GetBytesUsed() const { return m_used; }
+	size_t GetFrameHighWater() const { return m_frameHighWater; }	// peak bytes since the last Reset
+	size_t GetHighWater() const { return m_highWater; }				// peak bytes of any step
+	size_t GetCapacity() const;
+
+	// The arena of the step running on this thread, NULL outside of a step
+	static FrameArena * GetThreadArena();
+	static void SetThreadArena( FrameArena * arena );
+
+private:
+	struct block_t {
+		char * data;
+		size_t size;
+	};
+
+	std::vector< block_t > m_blocks;
+	int m_block;		// block that is allocated from
+	size_t m_offset;	// offset of the next allocation in m_block
+	size_t m_used;		// bytes handed out, including the tails skipped at the end of blocks
+
+	size_t m_blockSize;
+	size_t m_frameHighWater;
+	size_t m_highWater;
+};
+
+/*
+====================================================
+FrameArena::Alloc
+====================================================
+*/
+template< typename T >
+inline T * FrameArena::Alloc( const int count ) {
+	T * data = (T *)Alloc( sizeof( T ) * count, alignof( T ) > 16 ? alignof( T ) : 16 );
+	for ( int i = 0; i < count; i++ ) {
+		new ( data + i ) T();
+	}
+	return data;
+}
+
+/*
+====================================================
+FrameArenaScope
+
+Gives back everything allocated from the arena during the scope.
+Does nothing for a NULL arena.
+====================================================
+*/
+class FrameArenaScope {
+public:
+	explicit FrameArenaScope( FrameArena * arena ) : m_arena( arena ) {
+		if ( NULL != m_arena ) {
+			m_marker = m_arena->GetMarker();
+		}
+	}
+	~FrameArenaScope() {
+		if ( NULL != m_arena ) {
+			m_arena->Rewind( m_marker );
+		}
+	}
+
+private:
+	FrameArena * m_arena;
+	FrameArena::marker_t m_marker;
+};
+
+/*
+====================================================
+ScopedThreadArena
+
+Makes an arena the thread's arena for the duration of the scope
+====================================================
+*/
+class ScopedThreadArena {
+public:
+	explicit ScopedThreadArena( FrameArena * arena ) : m_previous( FrameArena::GetThreadArena() ) {
+		FrameArena::SetThreadArena( arena );
+	}
+	~ScopedThreadArena() {
+		FrameArena::SetThreadArena( m_previous );
+	}
+
+private:
+	FrameArena * m_previous;
+};
+
+/*
+====================================================
+ArenaAllocator
+
+Lets standard containers live in a FrameArena.  Deallocation is a no-op,
+the memory comes back when the arena is reset or rewound.  Without an
+arena it falls back to the heap, so the same containers work outside of a step.
+====================================================
+*/
+template< typename T >
+class ArenaAllocator {
+public:
+	typedef T value_type;
+
+	ArenaAllocator() : m_arena( NULL ) {}
+	explicit ArenaAllocator( FrameArena * arena ) : m_arena( arena ) {}
+	template< typename U >
+	ArenaAllocator( const ArenaAllocator< U > & rhs ) : m_arena( rhs.m_arena ) {}
+
+	T * allocate( const size_t num ) {
+		if ( NULL == m_arena ) {
+			return (T *)::operator new( num * sizeof( T ) );
+		}
+		return (T *)m_arena->Alloc( num * sizeof( T ), alignof( T ) > 16 ? alignof( T ) : 16 );
+	}
+
+	void deallocate( T * ptr, const size_t num ) {
+		if ( NULL == m_arena ) {
+			::operator delete( ptr );
+		}
+	}
+
+	template< typename U >
+	bool operator == ( const ArenaAllocator< U > & rhs ) const { return m_arena == rhs.m_arena; }
+	template< typename U >
+	bool operator != ( const ArenaAllocator< U > & rhs ) const { return m_arena != rhs.m_arena; }
+
+	FrameArena * m_arena;
+};
@@ -2,9 +2,9 @@
 //  GJK.cpp
 //
 #include "GJK.h"
-
-struct point_t;
-float EPA_Expand( const Body * bodyA, const Body * bodyB, const float bias, const point_t simplexPoints[ 4 ], Vec3 & ptOnA, Vec3 & ptOnB );
+#include "Profiler.h"
+#include "FrameArena.h"
+#include <string.h>
 
 /*
 ================================================================================================
@@ -304,24 +304,6 @@ Gilbert Johnson Keerthi
 ================================================================================================
 */
 
-struct point_t {
-    Vec3 xyz;	// The point on the minkowski sum
-    Vec3 ptA;	// The point on bodyA
-    Vec3 ptB;	// The point on bodyB
-
-    point_t() : xyz( 0.0f ), ptA( 0.0f ), ptB( 0.0f ) {}
-
-    const point_t & operator = ( const point_t & rhs ) {
-        xyz = rhs.xyz;
-        ptA = rhs.ptA;
-        ptB = rhs.ptB;
-        return *this;
-    }
-
-    bool operator == ( const point_t & rhs ) const {
-        return ( ( ptA == rhs.ptA ) && ( ptB == rhs.ptB ) && ( xyz == rhs.xyz ) );
-    }
-};
 
 /*
 ================================
@@ -477,6 +459,7 @@ GJK_DoesIntersect
 ================================
 */
 bool GJK_DoesIntersect( const Body * bodyA, const Body * bodyB ) {
+    PROFILE_SCOPE( "GJK_DoesIntersect" );
     const Vec3 origin( 0.0f );
 
     int numPts = 1;
@@ -487,6 +470,8 @@ bool GJK_DoesIntersect( const Body * bodyA, const Body * bodyB ) {
     bool doesContainOrigin = false;
     Vec3 newDir = simplexPoints[ 0 ].xyz * -1.0f;
     do {
+        PROFILE_COUNTER_ADD( COUNTER_GJK_ITERATIONS, 1 );
+
         // Get the new point to check on
         point_t newPt = Support( bodyA, bodyB, newDir, 0.0f );
 
@@ -533,6 +518,7 @@ GJK_ClosestPoints
 ================================
 */
 void GJK_ClosestPoints( const Body * bodyA, const Body * bodyB, Vec3 & ptOnA, Vec3 & ptOnB ) {
+    PROFILE_SCOPE( "GJK_ClosestPoints" );
     const Vec3 origin( 0.0f );
 
     float closestDist = 1e10f;
@@ -545,6 +531,8 @@ void GJK_ClosestPoints( const Body * bodyA, const Body * bodyB, Vec3 & ptOnA, Ve
     Vec4 lambdas = Vec4( 1, 0, 0, 0 );
     Vec3 newDir = simplexPoints[ 0 ].xyz * -1.0f;
     do {
+        PROFILE_COUNTER_ADD( COUNTER_GJK_ITERATIONS, 1 );
+
         // Get the new point to check on
         point_t newPt = Support( bodyA, bodyB, newDir, bias );
 
@@ -579,20 +567,134 @@ void GJK_ClosestPoints( const Body * bodyA, const Body * bodyB, Vec3 & ptOnA, Ve
 
 /*
 ================================
-GJK_DoesIntersect
+GJK_ShapeCast
+
+Moves bodyA by up to sweep and finds the fraction of it where A first touches bodyB.
+This is a ray cast from the origin along sweep against the minkowski difference B - A:
+the simplex tracks the points of B - A nearest the ray's current point, which jumps
+ahead to the plane through each new support point that separates it from B - A.
+The normal is on B's surface, pointing towards A.  Bodies that overlap at the start
+hit at zero, with a normal against the sweep.
 ================================
 */
-bool GJK_DoesIntersect( const Body * bodyA, const Body * bodyB, const float bias, Vec3 & ptOnA, Vec3 & ptOnB ) {
+bool GJK_ShapeCast( const Body * bodyA, const Body * bodyB, const Vec3 & sweep, float & fraction, Vec3 & normal, Vec3 & ptOnB ) {
+    PROFILE_SCOPE( "GJK_ShapeCast" );
+    const float epsilon = 0.001f;
+    const int maxIterations = 64;
+
+    float lambda = 0.0f;
+    Vec3 x( 0.0f );		// the point on the ray
+    Vec3 hitNormal( 0.0f );
+
+    // The points of B - A, the simplex itself is x minus each of them
+    int numPts = 0;
+    point_t simplexPoints[ 4 ];
+    Vec4 lambdas( 0.0f );
+
+    Vec3 v = x - Support( bodyB, bodyA, sweep * -1.0f, 0.0f ).xyz;
+    float bestDistSqr = 1e20f;	// nearest the simplex has come since x last moved
+    int numStalled = 0;
+    for ( int iteration = 0; iteration < maxIterations && v.GetLengthSqr() > epsilon * epsilon; iteration++ ) {
+        PROFILE_COUNTER_ADD( COUNTER_GJK_ITERATIONS, 1 );
+
+        const point_t p = Support( bodyB, bodyA, v, 0.0f );
+        const Vec3 w = x - p.xyz;
+        float vw = v.Dot( w );
+        const float distSqr = v.GetLengthSqr();
+        if ( distSqr < 0.999f * bestDistSqr ) {
+            bestDistSqr = distSqr;
+            numStalled = 0;
+        } else {
+            numStalled++;
+        }
+        if ( vw <= 0.0f && numStalled >= 2 ) {
+            // The simplex stopped getting closer, so |v| is the distance to B - A.  Only
+            // rounding in v's direction (large shapes against small ones) can make the
+            // plane through p look like it doesn't separate, step ahead by the distance.
+            vw = distSqr;
+        }
+        if ( vw > 0.0f ) {
+            // The plane through p separates x from B - A, move x up to it along the ray
+            const float vr = v.Dot( sweep );
+            if ( vr >= 0.0f ) {
+                return false;
+            }
+            lambda -= vw / vr;
+            if ( lambda > 1.0f ) {
+                return false;
+            }
+            x = sweep * lambda;
+            hitNormal = v;
+            bestDistSqr = 1e20f;
+            numStalled = 0;
+        }
+
+        if ( !HasPoint( simplexPoints, p ) && numPts < 4 ) {
+            simplexPoints[ numPts ] = p;
+            numPts++;
+        }
+
+        // Nearest point of the simplex x - points to the origin
+        if ( 1 == numPts ) {
+            v = x - simplexPoints[ 0 ].xyz;
+            lambdas = Vec4( 1, 0, 0, 0 );
+            continue;
+        }
+        point_t relative[ 4 ];
+        for ( int i = 0; i < numPts; i++ ) {
+            relative[ i ] = simplexPoints[ i ];
+            relative[ i ].xyz = x - simplexPoints[ i ].xyz;
+        }
+        Vec3 newDir;
+        SimplexSignedVolumes( relative, numPts, newDir, lambdas );
+        v = newDir * -1.0f;
+
+        SortValids( simplexPoints, lambdas );
+        numPts = NumValids( lambdas );
+        if ( 4 == numPts ) {
+            // x is inside B - A
+            v.Zero();
+        }
+    }
+
+    if ( v.GetLengthSqr() > 100.0f * epsilon * epsilon ) {
+        return false;
+    }
+
+    fraction = lambda;
+    normal = ( hitNormal.GetLengthSqr() > 0.0f ) ? hitNormal : sweep * -1.0f;
+    if ( normal.GetLengthSqr() > 0.0f ) {
+        normal.Normalize();
+    }
+
+    // Support points of B - A keep the point on B in ptA
+    ptOnB.Zero();
+    for ( int i = 0; i < numPts; i++ ) {
+        ptOnB += simplexPoints[ i ].ptA * lambdas[ i ];
+    }
+    return true;
+}
+
+/*
+================================
+GJK_PenetrationSimplex
+
+Runs GJK and, when the bodies overlap, fills out a tetrahedron
+that contains the origin and is expanded by the bias, ready for EPA
+================================
+*/
+bool GJK_PenetrationSimplex( const Body * bodyA, const Body * bodyB, const float bias, point_t simplexPoints[ 4 ] ) {
     const Vec3 origin( 0.0f );
 
     int numPts = 1;
-    point_t simplexPoints[ 4 ];
     simplexPoints[ 0 ] = Support( bodyA, bodyB, Vec3( 1, 1, 1 ), 0.0f );
 
     float closestDist = 1e10f;
     bool doesContainOrigin = false;
     Vec3 newDir = simplexPoints[ 0 ].xyz * -1.0f;
     do {
+        PROFILE_COUNTER_ADD( COUNTER_GJK_ITERATIONS, 1 );
+
         // Get the new point to check on
         point_t newPt = Support( bodyA, bodyB, newDir, 0.0f );
 
@@ -686,6 +788,22 @@ bool GJK_DoesIntersect( const Body * bodyA, const Body * bodyB, const float bias
         pt.xyz = pt.ptA - pt.ptB;
     }
 
+    return true;
+}
+
+/*
+================================
+GJK_DoesIntersect
+================================
+*/
+bool GJK_DoesIntersect( const Body * bodyA, const Body * bodyB, const float bias, Vec3 & ptOnA, Vec3 & ptOnB ) {
+    PROFILE_SCOPE( "GJK_DoesIntersect" );
+
+    point_t simplexPoints[ 4 ];
+    if ( !GJK_PenetrationSimplex( bodyA, bodyB, bias, simplexPoints ) ) {
+        return false;
+    }
+
     //
     // Perform EPA expansion of the simplex to find the closest face on the CSO
     //
@@ -703,6 +821,11 @@ Expanding Polytope Algorithm
 ================================================================================================
 */
 
+// The polytope is scratch memory, taken from the step's arena when there is one
+typedef std::vector< point_t, ArenaAllocator< point_t > > epaPoints_t;
+typedef std::vector< tri_t, ArenaAllocator< tri_t > > epaTriangles_t;
+typedef std::vector< edge_t, ArenaAllocator< edge_t > > epaEdges_t;
+
 /*
 ================================
 BarycentricCoordinates
@@ -774,7 +897,7 @@ Vec3 BarycentricCoordinates( Vec3 s1, Vec3 s2, Vec3 s3, const Vec3 & pt ) {
 NormalDirection
 ================================
 */
-Vec3 NormalDirection( const tri_t & tri, const std::vector< point_t > & points ) {
+Vec3 NormalDirection( const tri_t & tri, const epaPoints_t & points ) {
     const Vec3 & a = points[ tri.a ].xyz;
     const Vec3 & b = points[ tri.b ].xyz;
     const Vec3 & c = points[ tri.c ].xyz;
@@ -791,7 +914,7 @@ Vec3 NormalDirection( const tri_t & tri, const std::vector< point_t > & points )
 SignedDistanceToTriangle
 ================================
 */
-float SignedDistanceToTriangle( const tri_t & tri, const Vec3 & pt, const std::vector< point_t > & points ) {
+float SignedDistanceToTriangle( const tri_t & tri, const Vec3 & pt, const epaPoints_t & points ) {
     const Vec3 normal = NormalDirection( tri, points );
     const Vec3 & a = points[ tri.a ].xyz;
     const Vec3 a2pt = pt - a;
@@ -804,7 +927,7 @@ float SignedDistanceToTriangle( const tri_t & tri, const Vec3 & pt, const std::v
 ClosestTriangle
 ================================
 */
-int ClosestTriangle( const std::vector< tri_t > & triangles, const std::vector< point_t > & points ) {
+int ClosestTriangle( const epaTriangles_t & triangles, const epaPoints_t & points ) {
     float minDistSqr = 1e10;
 
     int idx = -1;
@@ -827,7 +950,7 @@ int ClosestTriangle( const std::vector< tri_t > & triangles, const std::vector<
 HasPoint
 ================================
 */
-bool HasPoint( const Vec3 & w, const std::vector< tri_t > triangles, const std::vector< point_t > & points ) {
+bool HasPoint( const Vec3 & w, const epaTriangles_t & triangles, const epaPoints_t & points ) {
     const float epsilons = 0.001f * 0.001f;
     Vec3 delta;
 
@@ -855,7 +978,7 @@ bool HasPoint( const Vec3 & w, const std::vector< tri_t > triangles, const std::
 RemoveTrianglesFacingPoint
 ================================
 */
-int RemoveTrianglesFacingPoint( const Vec3 & pt, std::vector< tri_t > & triangles, const std::vector< point_t > & points ) {
+int RemoveTrianglesFacingPoint( const Vec3 & pt, epaTriangles_t & triangles, const epaPoints_t & points ) {
     int numRemoved = 0;
     for ( int i = 0; i < triangles.size(); i++ ) {
         const tri_t & tri = triangles[ i ];
@@ -876,7 +999,7 @@ int RemoveTrianglesFacingPoint( const Vec3 & pt, std::vector< tri_t > & triangle
 FindDanglingEdges
 ================================
 */
-void FindDanglingEdges( std::vector< edge_t > & danglingEdges, const std::vector< tri_t > & triangles ) {
+void FindDanglingEdges( epaEdges_t & danglingEdges, const epaTriangles_t & triangles ) {
     danglingEdges.clear();
 
     for ( int i = 0; i < triangles.size(); i++ ) {
@@ -943,9 +1066,15 @@ EPA_Expand
 ================================
 */
 float EPA_Expand( const Body * bodyA, const Body * bodyB, const float bias, const point_t simplexPoints[ 4 ], Vec3 & ptOnA, Vec3 & ptOnB ) {
-    std::vector< point_t > points;
-    std::vector< tri_t > triangles;
-    std::vector< edge_t > danglingEdges;
+    PROFILE_SCOPE( "EPA_Expand" );
+    FrameArena * arena = FrameArena::GetThreadArena();
+    FrameArenaScope scratch( arena );	// declared first, so it rewinds after the vectors are gone
+    epaPoints_t points( ( ArenaAllocator< point_t >( arena ) ) );
+    epaTriangles_t triangles( ( ArenaAllocator< tri_t >( arena ) ) );
+    epaEdges_t danglingEdges( ( ArenaAllocator< edge_t >( arena ) ) );
+    points.reserve( 32 );
+    triangles.reserve( 64 );
+    danglingEdges.reserve( 32 );
 
     Vec3 center( 0.0f );
     for ( int i = 0; i < 4; i++ ) {
@@ -979,6 +1108,8 @@ float EPA_Expand( const Body * bodyA, const Body * bodyB, const float bias, cons
     //  CSO: convex hull of the minkowski difference (also known as configuration space object)
     //
     while ( 1 ) {
+        PROFILE_COUNTER_ADD( COUNTER_EPA_ITERATIONS, 1 );
+
         const int idx = ClosestTriangle( triangles, points );
         Vec3 normal = NormalDirection( triangles[ idx ], points );
 
@@ -9,8 +9,39 @@
 #include "Body.h"
 #include "Shapes.h"
 
+/*
+====================================================
+point_t
+
+A point on the minkowski difference, with the points on each body that made it
+====================================================
+*/
+struct point_t {
+	Vec3 xyz;	// The point on the minkowski sum
+	Vec3 ptA;	// The point on bodyA
+	Vec3 ptB;	// The point on bodyB
+
+	point_t() : xyz( 0.0f ), ptA( 0.0f ), ptB( 0.0f ) {}
+
+	const point_t & operator = ( const point_t & rhs ) {
+		xyz = rhs.xyz;
+		ptA = rhs.ptA;
+		ptB = rhs.ptB;
+		return *this;
+	}
+
+	bool operator == ( const point_t & rhs ) const {
+		return ( ( ptA == rhs.ptA ) && ( ptB == rhs.ptB ) && ( xyz == rhs.xyz ) );
+	}
+};
+
 void TestSignedVolumeProjection();
 
 bool GJK_DoesIntersect( const Body * bodyA, const Body * bodyB );
 bool GJK_DoesIntersect( const Body * bodyA, const Body * bodyB, const float bias, Vec3 & ptOnA, Vec3 & ptOnB );
 void GJK_ClosestPoints( const Body * bodyA, const Body * bodyB, Vec3 & ptOnA, Vec3 & ptOnB );
+bool GJK_ShapeCast( const Body * bodyA, const Body * bodyB, const Vec3 & sweep, float & fraction, Vec3 & normal, Vec3 & ptOnB );
+
+// The two halves of the penetrating GJK_DoesIntersect, exposed so they can be measured separately
+bool GJK_PenetrationSimplex( const Body * bodyA, const Body * bodyB, const float bias, point_t simplexPoints[ 4 ] );
+float EPA_Expand( const Body * bodyA, const Body * bodyB, const float bias, const point_t simplexPoints[ 4 ], Vec3 & ptOnA, Vec3 & ptOnB );
@@ -3,6 +3,7 @@
 //
 #include "Intersections.h"
 #include "GJK.h"
+#include "Profiler.h"
 
 /*
 ====================================================
@@ -28,12 +29,40 @@ bool SphereSphereStatic( const ShapeSphere * sphereA, const ShapeSphere * sphere
 
 /*
 ====================================================
-Intersect
+BodyAtTime
+
+A copy of body moved along its velocity for t seconds, the motion of
+Body::Update without the change in angular velocity.  Time of impact
+queries run on copies like this, so they never move the real bodies
+and any number of them can run at once.
 ====================================================
 */
-bool Intersect( Body * bodyA, Body * bodyB, contact_t & contact ) {
-    contact.bodyA = bodyA;
-    contact.bodyB = bodyB;
+static Body BodyAtTime( const Body * body, const float t ) {
+    Body moved = *body;
+    if ( 0.0f == t ) {
+        return moved;
+    }
+
+    const Vec3 posCM = body->GetCenterOfMassWorldSpace();
+    const Vec3 cmToPos = body->m_position - posCM;
+
+    const Vec3 dAngle = body->m_angularVelocity * t;
+    const Quat dq = Quat( dAngle, dAngle.GetMagnitude() );
+    moved.m_orientation = dq * body->m_orientation;
+    moved.m_orientation.Normalize();
+    moved.m_position = posCM + body->m_linearVelocity * t + dq.RotatePoint( cmToPos );
+    return moved;
+}
+
+/*
+====================================================
+IntersectStatic
+
+The bodies as they are, without moving them.  Fills in everything but the contact's bodies.
+The closest points of bodies that are apart are only looked for with findClosest.
+====================================================
+*/
+static bool IntersectStatic( const Body * bodyA, const Body * bodyB, const bool findClosest, contact_t & contact ) {
     contact.timeOfImpact = 0.0f;
 
     if ( bodyA->m_shape->GetType() == Shape::SHAPE_SPHERE && bodyB->m_shape->GetType() == Shape::SHAPE_SPHERE ) {
@@ -81,6 +110,10 @@ bool Intersect( Body * bodyA, Body * bodyB, contact_t & contact ) {
             return true;
         }
 
+        if ( !findClosest ) {
+            return false;
+        }
+
         // There was no collision, but we still want the contact data, so get it
         GJK_ClosestPoints( bodyA, bodyB, ptOnA, ptOnB );
         contact.ptOnA_WorldSpace = ptOnA;
@@ -99,9 +132,13 @@ bool Intersect( Body * bodyA, Body * bodyB, contact_t & contact ) {
 /*
 ====================================================
 ConservativeAdvance
+
+Steps copies of the bodies towards each other until they touch.  The
+bodies themselves are left untouched.
 ====================================================
 */
 bool ConservativeAdvance( Body * bodyA, Body * bodyB, float dt, contact_t & contact ) {
+    PROFILE_SCOPE( "ConservativeAdvance" );
     contact.bodyA = bodyA;
     contact.bodyB = bodyB;
 
@@ -112,11 +149,11 @@ bool ConservativeAdvance( Body * bodyA, Body * bodyB, float dt, contact_t & cont
     // Advance the positions of the bodies until they touch or there's not time left
     while ( dt > 0.0f ) {
         // Check for intersection
-        bool didIntersect = Intersect( bodyA, bodyB, contact );
+        const Body movedA = BodyAtTime( bodyA, toi );
+        const Body movedB = BodyAtTime( bodyB, toi );
+        bool didIntersect = IntersectStatic( &movedA, &movedB, true, contact );
         if ( didIntersect ) {
             contact.timeOfImpact = toi;
-            bodyA->Update( -toi );
-            bodyB->Update( -toi );
             return true;
         }
 
@@ -148,13 +185,7 @@ bool ConservativeAdvance( Body * bodyA, Body * bodyB, float dt, contact_t & cont
 
         dt -= timeToGo;
         toi += timeToGo;
-        bodyA->Update( timeToGo );
-        bodyB->Update( timeToGo );
     }
-
-    // unwind the clock
-    bodyA->Update( -toi );
-    bodyB->Update( -toi );
     return false;
 }
 
@@ -237,15 +268,220 @@ bool SphereSphereDynamic( const ShapeSphere * shapeA, const ShapeSphere * shapeB
     return true;
 }
 
+/*
+====================================================
+MakeChildBody
+
+Builds a temporary body for a child of a compound.  It shares the parent's
+material and velocity, so it moves rigidly with the parent during the query.
+====================================================
+*/
+static Body MakeChildBody( const Body * body, const ShapeCompound * compound, const int childIdx ) {
+    Body child = *body;
+    child.m_shape = compound->m_children[ childIdx ].shape;
+    compound->GetChildTransform( childIdx, body->m_position, body->m_orientation, child.m_position, child.m_orientation );
+
+    const Vec3 r = child.GetCenterOfMassWorldSpace() - body->GetCenterOfMassWorldSpace();
+    child.m_linearVelocity = body->m_linearVelocity + body->m_angularVelocity.Cross( r );
+    return child;
+}
+
+/*
+====================================================
+SweptBoundsInBodySpace
+
+Gets the bounds of other, swept by its velocity relative to body, in body's model space
+====================================================
+*/
+static Bounds SweptBoundsInBodySpace( const Body * body, const Body * other, const float dt ) {
+    Bounds bounds = other->m_shape->GetBounds( other->m_position, other->m_orientation );
+
+    const Vec3 displacement = ( other->m_linearVelocity - body->m_linearVelocity ) * dt;
+    bounds.Expand( bounds.mins + displacement );
+    bounds.Expand( bounds.maxs + displacement );
+
+    // The rotation of the body sweeps its far points over the step
+    const Bounds localBounds = body->m_shape->GetBounds();
+    const float radius = ( localBounds.maxs - localBounds.mins ).GetMagnitude();
+    const float epsilon = 0.01f + body->m_angularVelocity.GetMagnitude() * dt * radius;
+    bounds.Expand( bounds.mins + Vec3(-1,-1,-1 ) * epsilon );
+    bounds.Expand( bounds.maxs + Vec3( 1, 1, 1 ) * epsilon );
+
+    // Move the world space bounds into the body's model space
+    const Quat invOrient = body->m_orientation.Inverse();
+    Bounds localSwept;
+    for ( int corner = 0; corner < 8; corner++ ) {
+        const Vec3 pt(
+            ( corner & 1 ) ? bounds.maxs.x : bounds.mins.x,
+            ( corner & 2 ) ? bounds.maxs.y : bounds.mins.y,
+            ( corner & 4 ) ? bounds.maxs.z : bounds.mins.z
+        );
+        localSwept.Expand( invOrient.RotatePoint( pt - body->m_position ) );
+    }
+    return localSwept;
+}
+
+/*
+====================================================
+IntersectChildren
+
+Tests the other body against the pieces of a compound, triangle mesh or heightfield.
+forEachChild( bounds, test ) calls test( child ) with a temporary body for each piece
+that overlaps the bounds, which are the other body's swept bounds in the parent's model space.
+The child's shape may only live as long as the call to test.
+The earliest (and then deepest) child contact is returned as the contact for the bodies.
+====================================================
+*/
+template< typename ForEachChild >
+static bool IntersectChildren( Body * bodyA, Body * bodyB, const bool isParentA, const float dt, const bool isContinuous, contact_t & contact, ForEachChild && forEachChild ) {
+    Body * parentBody = isParentA ? bodyA : bodyB;
+    Body * otherBody = isParentA ? bodyB : bodyA;
+
+    const Bounds queryBounds = SweptBoundsInBodySpace( parentBody, otherBody, dt );
+
+    bool didIntersect = false;
+    contact_t best;
+    Vec3 bestPtWorld;	// the child's contact point, the child's shape may not outlive test
+    forEachChild( queryBounds, [ & ]( Body & child ) {
+        contact_t childContact;
+        const bool hit = isParentA ? Intersect( &child, otherBody, dt, isContinuous, childContact ) : Intersect( otherBody, &child, dt, isContinuous, childContact );
+        if ( !hit ) {
+            return;
+        }
+
+        const bool isEarlier = ( childContact.timeOfImpact < best.timeOfImpact );
+        const bool isDeeper = ( childContact.timeOfImpact == best.timeOfImpact && childContact.separationDistance < best.separationDistance );
+        if ( !didIntersect || isEarlier || isDeeper ) {
+            best = childContact;
+            bestPtWorld = child.BodySpaceToWorldSpace( isParentA ? childContact.ptOnA_LocalSpace : childContact.ptOnB_LocalSpace );
+            didIntersect = true;
+        }
+    } );
+
+    if ( !didIntersect ) {
+        return false;
+    }
+
+    // Move the child's contact onto the parent body
+    contact = best;
+    if ( isParentA ) {
+        contact.bodyA = bodyA;
+        contact.ptOnA_LocalSpace = bodyA->WorldSpaceToBodySpace( bestPtWorld );
+    } else {
+        contact.bodyB = bodyB;
+        contact.ptOnB_LocalSpace = bodyB->WorldSpaceToBodySpace( bestPtWorld );
+    }
+    return true;
+}
+
+/*
+====================================================
+IntersectCompound
+====================================================
+*/
+static bool IntersectCompound( Body * bodyA, Body * bodyB, const bool isCompoundA, const float dt, const bool isContinuous, contact_t & contact ) {
+    const Body * compoundBody = isCompoundA ? bodyA : bodyB;
+    const ShapeCompound * compound = (const ShapeCompound *)compoundBody->m_shape;
+
+    return IntersectChildren( bodyA, bodyB, isCompoundA, dt, isContinuous, contact, [ & ]( const Bounds & bounds, auto && test ) {
+        compound->m_tree.Query( bounds, [ & ]( const int childIdx ) {
+            Body child = MakeChildBody( compoundBody, compound, childIdx );
+            test( child );
+        } );
+    } );
+}
+
+/*
+====================================================
+IntersectTriangles
+
+Static meshes and heightfields share the model space of their triangles,
+so the temporary triangle bodies keep the parent's transform.
+====================================================
+*/
+template< typename ShapeTriangles >
+static bool IntersectTriangles( Body * bodyA, Body * bodyB, const bool isMeshA, const float dt, const bool isContinuous, contact_t & contact ) {
+    const Body * meshBody = isMeshA ? bodyA : bodyB;
+    const ShapeTriangles * mesh = (const ShapeTriangles *)meshBody->m_shape;
+
+    return IntersectChildren( bodyA, bodyB, isMeshA, dt, isContinuous, contact, [ & ]( const Bounds & bounds, auto && test ) {
+        mesh->QueryTriangles( bounds, [ & ]( const Vec3 & a, const Vec3 & b, const Vec3 & c ) {
+            ShapeTriangle tri( a, b, c, mesh->m_thickness );
+            Body child = *meshBody;
+            child.m_shape = &tri;
+            test( child );
+        } );
+    } );
+}
+
+/*
+====================================================
+NeedsContinuous
+
+Whether a body moves far enough this step to pass through something,
+its linear travel plus how far its rotation sweeps its points, against
+half its smallest extent.  Slower bodies are caught by the discrete test
+while they overlap.
+====================================================
+*/
+bool NeedsContinuous( const Body * body, const float dt ) {
+    if ( body->m_alwaysContinuous ) {
+        return true;
+    }
+    if ( body->IsStatic() ) {
+        return false;
+    }
+
+    const Bounds bounds = body->m_shape->GetBounds();
+    const Vec3 extents = bounds.maxs - bounds.mins;
+    const float smallestExtent = std::min( extents.x, std::min( extents.y, extents.z ) );
+
+    // FastestLinearSpeed works in model space
+    const Quat invOrient = body->m_orientation.Inverse();
+    const Vec3 angularVelocity = invOrient.RotatePoint( body->m_angularVelocity );
+    float angularSpeed = 0.0f;
+    for ( int axis = 0; axis < 3; axis++ ) {
+        Vec3 dir( 0.0f );
+        dir[ axis ] = 1.0f;
+        angularSpeed = std::max( angularSpeed, body->m_shape->FastestLinearSpeed( angularVelocity, dir ) );
+        angularSpeed = std::max( angularSpeed, body->m_shape->FastestLinearSpeed( angularVelocity, dir * -1.0f ) );
+    }
+
+    const float travel = ( body->m_linearVelocity.GetMagnitude() + angularSpeed ) * dt;
+    return travel > 0.5f * smallestExtent;
+}
+
 /*
 ====================================================
 Intersect
+
+Finds the first contact of the bodies within the next dt seconds.  Only
+reads the bodies, so pairs can be tested concurrently.  Without
+isContinuous only bodies that already touch have a contact, pairs that
+are too slow to pass through each other in a step don't need the time
+of impact search.
 ====================================================
 */
-bool Intersect( Body * bodyA, Body * bodyB, const float dt, contact_t & contact ) {
+bool Intersect( Body * bodyA, Body * bodyB, const float dt, const bool isContinuous, contact_t & contact ) {
+    PROFILE_SCOPE( "Intersect" );
     contact.bodyA = bodyA;
     contact.bodyB = bodyB;
 
+    const Shape::shapeType_t typeA = bodyA->m_shape->GetType();
+    const Shape::shapeType_t typeB = bodyB->m_shape->GetType();
+    if ( typeA == Shape::SHAPE_TRIANGLE_MESH || typeB == Shape::SHAPE_TRIANGLE_MESH ) {
+        return IntersectTriangles< ShapeTriangleMesh >( bodyA, bodyB, typeA == Shape::SHAPE_TRIANGLE_MESH, dt, isContinuous, contact );
+    }
+    if ( typeA == Shape::SHAPE_HEIGHTFIELD || typeB == Shape::SHAPE_HEIGHTFIELD ) {
+        return IntersectTriangles< ShapeHeightfield >( bodyA, bodyB, typeA == Shape::SHAPE_HEIGHTFIELD, dt, isContinuous, contact );
+    }
+    if ( typeA == Shape::SHAPE_COMPOUND || typeB == Shape::SHAPE_COMPOUND ) {
+        return IntersectCompound( bodyA, bodyB, typeA == Shape::SHAPE_COMPOUND, dt, isContinuous, contact );
+    }
+    if ( !isContinuous ) {
+        return IntersectStatic( bodyA, bodyB, false, contact );
+    }
+
     if (bodyA->m_shape->GetType() == Shape::SHAPE_SPHERE && bodyB->m_shape->GetType() == Shape::SHAPE_SPHERE)
     {
         const ShapeSphere * sphereA = (const ShapeSphere *)bodyA->m_shape;
@@ -259,21 +495,17 @@ bool Intersect( Body * bodyA, Body * bodyB, const float dt, contact_t & contact
 
         if ( SphereSphereDynamic(sphereA, sphereB, posA, posB, velA, velB, dt, contact.ptOnA_WorldSpace, contact.ptOnB_WorldSpace, contact.timeOfImpact) )
         {
-            // Step bodies forward to get local space collision points
-            bodyA->Update(contact.timeOfImpact);
-            bodyB->Update(contact.timeOfImpact);
+            // Where the bodies will be at the time of impact, to get local space collision points
+            const Body movedA = BodyAtTime( bodyA, contact.timeOfImpact );
+            const Body movedB = BodyAtTime( bodyB, contact.timeOfImpact );
 
             // Convert world space contacts to local space
-            contact.ptOnA_LocalSpace = bodyA->WorldSpaceToBodySpace(contact.ptOnA_WorldSpace);
-            contact.ptOnB_LocalSpace = bodyB->WorldSpaceToBodySpace(contact.ptOnB_WorldSpace);
+            contact.ptOnA_LocalSpace = movedA.WorldSpaceToBodySpace(contact.ptOnA_WorldSpace);
+            contact.ptOnB_LocalSpace = movedB.WorldSpaceToBodySpace(contact.ptOnB_WorldSpace);
 
-            contact.normal = bodyA->m_position - bodyB->m_position;
+            contact.normal = movedA.m_position - movedB.m_position;
             contact.normal.Normalize();
 
-            // Unwind time step
-            bodyA->Update(-contact.timeOfImpact);
-            bodyB->Update(-contact.timeOfImpact);
-
             // Calculate the separation distance
             Vec3 ab = bodyB->m_position - bodyA->m_position;
             float r = ab.GetMagnitude() - ( sphereA->m_radius + sphereB->m_radius );
@@ -289,24 +521,54 @@ bool Intersect( Body * bodyA, Body * bodyB, const float dt, contact_t & contact
 	return false;
 }
 
+/*
+====================================================
+IntersectSpeculative
 
+Contacts without a time of impact.  Bodies that are apart still get a
+contact when they could close the gap within dt, with a positive
+separation.  The solver only pushes on it once the bodies would close
+more than the gap this step, so they meet instead of tunneling.
 
+Compounds, meshes and heightfields take the time of impact path of Intersect.
+====================================================
+*/
+bool IntersectSpeculative( Body * bodyA, Body * bodyB, const float dt, contact_t & contact ) {
+    PROFILE_SCOPE( "IntersectSpeculative" );
+    const Shape::shapeType_t typeA = bodyA->m_shape->GetType();
+    const Shape::shapeType_t typeB = bodyB->m_shape->GetType();
+    if ( typeA == Shape::SHAPE_TRIANGLE_MESH || typeB == Shape::SHAPE_TRIANGLE_MESH ||
+        typeA == Shape::SHAPE_HEIGHTFIELD || typeB == Shape::SHAPE_HEIGHTFIELD ||
+        typeA == Shape::SHAPE_COMPOUND || typeB == Shape::SHAPE_COMPOUND ) {
+        return Intersect( bodyA, bodyB, dt, true, contact );
+    }
 
+    contact.bodyA = bodyA;
+    contact.bodyB = bodyB;
+    if ( IntersectStatic( bodyA, bodyB, true, contact ) ) {
+        return true;
+    }
 
+    // The direction from A to B, spheres don't fill in the normal while they're apart
+    Vec3 ab = contact.ptOnB_WorldSpace - contact.ptOnA_WorldSpace;
+    if ( typeA == Shape::SHAPE_SPHERE && typeB == Shape::SHAPE_SPHERE ) {
+        ab = bodyB->m_position - bodyA->m_position;
+    }
+    ab.Normalize();
+    const float separation = ( contact.ptOnB_WorldSpace - contact.ptOnA_WorldSpace ).Dot( ab );
 
+    // The fastest the gap can close, the same bound conservative advance steps with
+    float closingSpeed = ( bodyA->m_linearVelocity - bodyB->m_linearVelocity ).Dot( ab );
+    closingSpeed += bodyA->m_shape->FastestLinearSpeed( bodyA->m_angularVelocity, ab );
+    closingSpeed += bodyB->m_shape->FastestLinearSpeed( bodyB->m_angularVelocity, ab * -1.0f );
+    if ( separation > closingSpeed * dt ) {
+        return false;
+    }
 
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
+    contact.normal = ab * -1.0f;
+    contact.separationDistance = separation;
+    contact.timeOfImpact = 0.0f;
+    contact.ptOnA_LocalSpace = bodyA->WorldSpaceToBodySpace( contact.ptOnA_WorldSpace );
+    contact.ptOnB_LocalSpace = bodyB->WorldSpaceToBodySpace( contact.ptOnB_WorldSpace );
+    return true;
+}
@@ -4,4 +4,8 @@
 #pragma once
 #include "Contact.h"
 
-bool Intersect( Body * bodyA, Body * bodyB, const float dt, contact_t & contact );
\ No newline at end of file
+bool Intersect( Body * bodyA, Body * bodyB, const float dt, const bool isContinuous, contact_t & contact );
+bool NeedsContinuous( const Body * body, const float dt );
+bool IntersectSpeculative( Body * bodyA, Body * bodyB, const float dt, contact_t & contact );
+bool ConservativeAdvance( Body * bodyA, Body * bodyB, float dt, contact_t & contact );
+bool RaySphere( const Vec3 & rayStart, const Vec3 & rayDir, const Vec3 & sphereCenter, const float sphereRadius, float & t1, float & t2 );
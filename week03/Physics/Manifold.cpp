@@ -2,6 +2,7 @@
 //  Manifold.cpp
 //
 #include "Manifold.h"
+#include <algorithm>
 
 
 /*
@@ -34,6 +35,7 @@ void ManifoldCollector::AddContact( const contact_t & contact ) {
     if ( foundIdx >= 0 ) {
         m_manifolds[ foundIdx ].AddContact( contact );
     } else {
+        // New manifolds go on the end, they stay in the order their pairs were first touched
         Manifold manifold;
         manifold.m_bodyA = contact.bodyA;
         manifold.m_bodyB = contact.bodyB;
@@ -60,6 +62,30 @@ void ManifoldCollector::RemoveExpired() {
     }
 }
 
+/*
+================================
+ManifoldCollector::RemoveBodies
+
+Drops the manifolds of bodies that are going away, sortedBodies is sorted by address
+================================
+*/
+void ManifoldCollector::RemoveBodies( const Body * const * sortedBodies, const int num ) {
+    const Body * const * end = sortedBodies + num;
+
+    int numManifolds = 0;
+    for ( int i = 0; i < m_manifolds.size(); i++ ) {
+        const Manifold & manifold = m_manifolds[ i ];
+        if ( std::binary_search( sortedBodies, end, manifold.m_bodyA ) || std::binary_search( sortedBodies, end, manifold.m_bodyB ) ) {
+            continue;
+        }
+        if ( numManifolds != i ) {
+            m_manifolds[ numManifolds ] = manifold;
+        }
+        numManifolds++;
+    }
+    m_manifolds.resize( numManifolds );
+}
+
 /*
 ================================
 ManifoldCollector::PreSolve
@@ -73,13 +99,17 @@ void ManifoldCollector::PreSolve( const float dt_sec ) {
 
 /*
 ================================
-ManifoldCollector::Solve
+ManifoldCollector::BuildRows
+
+Writes at most GetNumRows() rows, returns how many were written
 ================================
 */
-void ManifoldCollector::Solve() {
+int ManifoldCollector::BuildRows( solverRow_t * rows, const bool blockSolve ) {
+    int numRows = 0;
     for ( int i = 0; i < m_manifolds.size(); i++ ) {
-        m_manifolds[ i ].Solve();
+        numRows += m_manifolds[ i ].BuildRows( rows + numRows, blockSolve );
     }
+    return numRows;
 }
 
 /*
@@ -93,6 +123,98 @@ void ManifoldCollector::PostSolve() {
     }
 }
 
+/*
+================================
+ManifoldCollector::GetNumRows
+================================
+*/
+int ManifoldCollector::GetNumRows() const {
+    int numRows = 0;
+    for ( int i = 0; i < m_manifolds.size(); i++ ) {
+        const Manifold & manifold = m_manifolds[ i ];
+        for ( int j = 0; j < manifold.m_numContacts; j++ ) {
+            numRows += manifold.m_constraints[ j ].GetNumRows();
+        }
+    }
+    return numRows;
+}
+
+/*
+================================
+ManifoldCollector::SaveState
+================================
+*/
+void ManifoldCollector::SaveState( const BodyPool & bodies, manifoldCollectorState_t & state ) const {
+    state.manifolds.resize( m_manifolds.size() );
+    int numContacts = 0;
+    for ( int i = 0; i < m_manifolds.size(); i++ ) {
+        numContacts += m_manifolds[ i ].m_numContacts;
+    }
+    state.contacts.resize( numContacts );
+
+    manifoldContactState_t * contactState = state.contacts.data();
+    for ( int i = 0; i < m_manifolds.size(); i++ ) {
+        const Manifold & manifold = m_manifolds[ i ];
+        manifoldState_t & manifoldState = state.manifolds[ i ];
+        manifoldState.bodyA = bodies.IndexOf( manifold.m_bodyA );
+        manifoldState.bodyB = bodies.IndexOf( manifold.m_bodyB );
+        manifoldState.numContacts = manifold.m_numContacts;
+
+        for ( int j = 0; j < manifold.m_numContacts; j++ ) {
+            const contact_t & contact = manifold.m_contacts[ j ];
+            const ConstraintPenetration & constraint = manifold.m_constraints[ j ];
+            contactState->ptOnA_LocalSpace = contact.ptOnA_LocalSpace;
+            contactState->ptOnB_LocalSpace = contact.ptOnB_LocalSpace;
+            contactState->normal = constraint.m_normal;
+            contactState->separationDistance = contact.separationDistance;
+            for ( int k = 0; k < 3; k++ ) {
+                contactState->cachedLambda[ k ] = constraint.m_cachedLambda[ k ];
+            }
+            contactState++;
+        }
+    }
+}
+
+/*
+================================
+ManifoldCollector::RestoreState
+================================
+*/
+void ManifoldCollector::RestoreState( BodyPool & bodies, const manifoldCollectorState_t & state ) {
+    m_manifolds.resize( state.manifolds.size() );
+
+    const manifoldContactState_t * contactState = state.contacts.data();
+    for ( int i = 0; i < m_manifolds.size(); i++ ) {
+        Manifold & manifold = m_manifolds[ i ];
+        const manifoldState_t & manifoldState = state.manifolds[ i ];
+        Body * bodyA = &bodies[ manifoldState.bodyA ];
+        Body * bodyB = &bodies[ manifoldState.bodyB ];
+        manifold.m_bodyA = bodyA;
+        manifold.m_bodyB = bodyB;
+        manifold.m_numContacts = manifoldState.numContacts;
+
+        for ( int j = 0; j < manifold.m_numContacts; j++ ) {
+            contact_t & contact = manifold.m_contacts[ j ];
+            contact.ptOnA_LocalSpace = contactState->ptOnA_LocalSpace;
+            contact.ptOnB_LocalSpace = contactState->ptOnB_LocalSpace;
+            contact.separationDistance = contactState->separationDistance;
+            contact.bodyA = bodyA;
+            contact.bodyB = bodyB;
+
+            ConstraintPenetration & constraint = manifold.m_constraints[ j ];
+            constraint.m_bodyA = bodyA;
+            constraint.m_bodyB = bodyB;
+            constraint.m_anchorA = contact.ptOnA_LocalSpace;
+            constraint.m_anchorB = contact.ptOnB_LocalSpace;
+            constraint.m_normal = contactState->normal;
+            for ( int k = 0; k < 3; k++ ) {
+                constraint.m_cachedLambda[ k ] = contactState->cachedLambda[ k ];
+            }
+            contactState++;
+        }
+    }
+}
+
 /*
 ================================================================================================
 
@@ -138,7 +260,7 @@ void Manifold::RemoveExpiredContacts() {
             m_constraints[ j ] = m_constraints[ j + 1 ];
             m_contacts[ j ] = m_contacts[ j + 1 ];
             if ( j >= m_numContacts ) {
-                m_constraints[ j ].m_cachedLambda.Zero();
+                m_constraints[ j ].ClearCachedLambda();
             }
         }
         m_numContacts--;
@@ -228,7 +350,7 @@ void Manifold::AddContact( const contact_t & contact_old ) {
     m_constraints[ newSlot ].m_normal = normal;
     m_constraints[ newSlot ].m_normal.Normalize();
 
-    m_constraints[ newSlot ].m_cachedLambda.Zero();
+    m_constraints[ newSlot ].ClearCachedLambda();
 
     if ( newSlot == m_numContacts ) {
         m_numContacts++;
@@ -248,13 +370,42 @@ void Manifold::PreSolve( const float dt_sec ) {
 
 /*
 ================================
-Manifold::Solve
+Manifold::BuildRows
+
+All the contacts are between the same two bodies, so their inertia is only looked up once.
+With blockSolve the normal rows come first and are solved together as one block,
+the friction rows follow them.
 ================================
 */
-void Manifold::Solve() {
+int Manifold::BuildRows( solverRow_t * rows, const bool blockSolve ) {
+    if ( 0 == m_numContacts ) {
+        return 0;
+    }
+
+    const Mat3 invInertiaA = GetSolverInverseInertia( m_bodyA );
+    const Mat3 invInertiaB = GetSolverInverseInertia( m_bodyB );
+
+    if ( !blockSolve || m_numContacts < 2 ) {
+        int numRows = 0;
+        for ( int i = 0; i < m_numContacts; i++ ) {
+            numRows += m_constraints[ i ].BuildRows( rows + numRows, invInertiaA, invInertiaB );
+        }
+        return numRows;
+    }
+
+    int numRows = m_numContacts;
     for ( int i = 0; i < m_numContacts; i++ ) {
-        m_constraints[ i ].Solve();
+        solverRow_t contactRows[ 3 ];
+        const int num = m_constraints[ i ].BuildRows( contactRows, invInertiaA, invInertiaB );
+        rows[ i ] = contactRows[ 0 ];
+        for ( int j = 1; j < num; j++ ) {
+            rows[ numRows ] = contactRows[ j ];
+            rows[ numRows ].normalRow = numRows - i;
+            numRows++;
+        }
     }
+    InitBlock( rows, m_numContacts );
+    return numRows;
 }
 
 /*
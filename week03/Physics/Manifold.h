@@ -5,6 +5,7 @@
 #include "Body.h"
 #include "Constraints.h"
 #include "Contact.h"
+#include "BodyPool.h"
 
 /*
 ================================
@@ -19,7 +20,7 @@ public:
 	void RemoveExpiredContacts();
 
 	void PreSolve( const float dt_sec );
-	void Solve();
+	int BuildRows( solverRow_t * rows, const bool blockSolve );
 	void PostSolve();
 
 	contact_t GetContact( const int idx ) const { return m_contacts[ idx ]; }
@@ -39,6 +40,32 @@ private:
 	friend class ManifoldCollector;
 };
 
+/*
+================================
+manifoldState_t
+
+Only what the next update reads, bodies by their index in the pool
+================================
+*/
+struct manifoldContactState_t {
+	Vec3 ptOnA_LocalSpace;
+	Vec3 ptOnB_LocalSpace;
+	Vec3 normal;		// in Body A's local space
+	float separationDistance;
+	float cachedLambda[ 3 ];
+};
+
+struct manifoldState_t {
+	int bodyA;
+	int bodyB;
+	int numContacts;
+};
+
+struct manifoldCollectorState_t {
+	std::vector< manifoldState_t > manifolds;
+	std::vector< manifoldContactState_t > contacts;	// numContacts per manifold, in order
+};
+
 /*
 ================================
 ManifoldCollector
@@ -51,12 +78,19 @@ public:
 	void AddContact( const contact_t & contact );
 
 	void PreSolve( const float dt_sec );
-	void Solve();
+	int BuildRows( solverRow_t * rows, const bool blockSolve );
 	void PostSolve();
 
 	void RemoveExpired();
+	void RemoveBodies( const Body * const * sortedBodies, const int num );
 	void Clear() { m_manifolds.clear(); }	// For resetting the demo
 
+	int GetNumRows() const;
+
+	// Restored contacts keep their old world space points, the next update works them out again
+	void SaveState( const BodyPool & bodies, manifoldCollectorState_t & state ) const;
+	void RestoreState( BodyPool & bodies, const manifoldCollectorState_t & state );
+
 public:
 	std::vector< Manifold > m_manifolds;
 };
\ No newline at end of file
@@ -0,0 +1,264 @@
+//
+//  Profiler.cpp
+//
+#include "Profiler.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+struct profileEvent_t {
+    const char * name;
+    double start;
+    double duration;
+};
+
+struct counterSample_t {
+    double time;
+    profileCounters_t counters;
+};
+
+/*
+====================================================
+threadProfile_t
+
+Owned by a single thread while recording
+====================================================
+*/
+struct threadProfile_t {
+    int threadId;
+    std::vector< profileEvent_t > events;
+    long long counters[ COUNTER_MAX ];
+};
+
+/*
+====================================================
+threadProfileOwner_t
+
+Unregisters the thread's profile when the thread exits.  Profiles that
+still hold events are kept for the trace until ClearEvents.
+====================================================
+*/
+struct threadProfileOwner_t {
+    threadProfile_t * profile;
+
+    threadProfileOwner_t() : profile( NULL ) {}
+    ~threadProfileOwner_t();
+};
+
+static std::atomic< bool > s_isCapturing( false );
+static std::mutex s_registryMutex;
+static std::vector< threadProfile_t * > s_threads;
+static std::vector< threadProfile_t * > s_exitedThreads;
+static int s_nextThreadId = 0;
+static std::vector< counterSample_t > s_counterSamples;
+static const std::chrono::steady_clock::time_point s_epoch = std::chrono::steady_clock::now();
+
+static thread_local threadProfileOwner_t t_profile;
+
+static const char * s_counterNames[ COUNTER_MAX ] = {
+    "pairs",
+    "contacts",
+    "ccd_bodies",
+    "ccd_pairs",
+    "gjk_iterations",
+    "epa_iterations",
+    "manifolds",
+    "solver_rows",
+    "solver_islands",
+    "solver_iterations",
+};
+
+/*
+====================================================
+GetThreadProfile
+
+Registers the calling thread the first time it records anything
+====================================================
+*/
+static threadProfile_t * GetThreadProfile() {
+    if ( NULL == t_profile.profile ) {
+        threadProfile_t * profile = new threadProfile_t;
+        memset( profile->counters, 0, sizeof( profile->counters ) );
+
+        std::lock_guard< std::mutex > lock( s_registryMutex );
+        profile->threadId = s_nextThreadId++;
+        s_threads.push_back( profile );
+        t_profile.profile = profile;
+    }
+    return t_profile.profile;
+}
+
+/*
+====================================================
+threadProfileOwner_t::~threadProfileOwner_t
+====================================================
+*/
+threadProfileOwner_t::~threadProfileOwner_t() {
+    if ( NULL == profile ) {
+        return;
+    }
+
+    std::lock_guard< std::mutex > lock( s_registryMutex );
+    s_threads.erase( std::find( s_threads.begin(), s_threads.end(), profile ) );
+    if ( profile->events.empty() ) {
+        delete profile;
+    } else {
+        s_exitedThreads.push_back( profile );
+    }
+    profile = NULL;
+}
+
+/*
+====================================================
+Profiler::BeginCapture
+====================================================
+*/
+void Profiler::BeginCapture() {
+    s_isCapturing = true;
+}
+
+/*
+====================================================
+Profiler::EndCapture
+====================================================
+*/
+void Profiler::EndCapture() {
+    s_isCapturing = false;
+}
+
+/*
+====================================================
+Profiler::IsCapturing
+====================================================
+*/
+bool Profiler::IsCapturing() {
+    return s_isCapturing.load( std::memory_order_relaxed );
+}
+
+/*
+====================================================
+Profiler::GetTimeMicroseconds
+====================================================
+*/
+double Profiler::GetTimeMicroseconds() {
+    return std::chrono::duration< double, std::micro >( std::chrono::steady_clock::now() - s_epoch ).count();
+}
+
+/*
+====================================================
+Profiler::AddEvent
+====================================================
+*/
+void Profiler::AddEvent( const char * name, const double start, const double duration ) {
+    profileEvent_t event;
+    event.name = name;
+    event.start = start;
+    event.duration = duration;
+    GetThreadProfile()->events.push_back( event );
+}
+
+/*
+====================================================
+Profiler::AddCounter
+====================================================
+*/
+void Profiler::AddCounter( const profileCounter_t counter, const long long value ) {
+    GetThreadProfile()->counters[ counter ] += value;
+}
+
+/*
+====================================================
+Profiler::EndThreadFrame
+
+Moves the calling thread's counters out and resets them
+====================================================
+*/
+void Profiler::EndThreadFrame( profileCounters_t & counters ) {
+    threadProfile_t * profile = GetThreadProfile();
+    for ( int c = 0; c < COUNTER_MAX; c++ ) {
+        counters.values[ c ] = profile->counters[ c ];
+        profile->counters[ c ] = 0;
+    }
+
+    if ( IsCapturing() ) {
+        counterSample_t sample;
+        sample.time = GetTimeMicroseconds();
+        sample.counters = counters;
+
+        std::lock_guard< std::mutex > lock( s_registryMutex );
+        s_counterSamples.push_back( sample );
+    }
+}
+
+/*
+====================================================
+Profiler::GetCounterName
+====================================================
+*/
+const char * Profiler::GetCounterName( const int counter ) {
+    return s_counterNames[ counter ];
+}
+
+/*
+====================================================
+Profiler::ClearEvents
+====================================================
+*/
+void Profiler::ClearEvents() {
+    std::lock_guard< std::mutex > lock( s_registryMutex );
+    for ( int i = 0; i < s_threads.size(); i++ ) {
+        s_threads[ i ]->events.clear();
+    }
+    for ( int i = 0; i < s_exitedThreads.size(); i++ ) {
+        delete s_exitedThreads[ i ];
+    }
+    s_exitedThreads.clear();
+    s_counterSamples.clear();
+}
+
+/*
+====================================================
+Profiler::WriteChromeTrace
+====================================================
+*/
+bool Profiler::WriteChromeTrace( const char * path ) {
+    FILE * file = fopen( path, "w" );
+    if ( NULL == file ) {
+        return false;
+    }
+
+    std::lock_guard< std::mutex > lock( s_registryMutex );
+
+    fprintf( file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+    bool isFirst = true;
+    const std::vector< threadProfile_t * > * lists[ 2 ] = { &s_threads, &s_exitedThreads };
+    for ( int list = 0; list < 2; list++ ) {
+        const std::vector< threadProfile_t * > & threads = *lists[ list ];
+        for ( int i = 0; i < threads.size(); i++ ) {
+            const threadProfile_t * profile = threads[ i ];
+            for ( int e = 0; e < profile->events.size(); e++ ) {
+                const profileEvent_t & event = profile->events[ e ];
+                fprintf( file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    isFirst ? "" : ",\n", event.name, profile->threadId, event.start, event.duration );
+                isFirst = false;
+            }
+        }
+    }
+
+    for ( int i = 0; i < s_counterSamples.size(); i++ ) {
+        const counterSample_t & sample = s_counterSamples[ i ];
+        fprintf( file, "%s{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{", isFirst ? "" : ",\n", sample.time );
+        for ( int c = 0; c < COUNTER_MAX; c++ ) {
+            fprintf( file, "%s\"%s\":%lld", ( c > 0 ) ? "," : "", s_counterNames[ c ], sample.counters.values[ c ] );
+        }
+        fprintf( file, "}}" );
+        isFirst = false;
+    }
+    fprintf( file, "\n]}\n" );
+
+    fclose( file );
+    return true;
+}
@@ -0,0 +1,99 @@
+//
+//	Profiler.h
+//
+#pragma once
+#include <vector>
+
+// Set to 0 to compile every PROFILE_ marker out of the hot paths
+#ifndef ENABLE_PROFILER
+#define ENABLE_PROFILER 1
+#endif
+
+/*
+====================================================
+profileCounter_t
+====================================================
+*/
+enum profileCounter_t {
+	COUNTER_PAIRS,			// broadphase pairs
+	COUNTER_CONTACTS,		// narrow phase contacts
+	COUNTER_CCD_BODIES,		// bodies fast enough to need continuous collision
+	COUNTER_CCD_PAIRS,		// broadphase pairs that searched for a time of impact
+	COUNTER_GJK_ITERATIONS,
+	COUNTER_EPA_ITERATIONS,
+	COUNTER_MANIFOLDS,
+	COUNTER_SOLVER_ROWS,	// constraint rows set up by PreSolve
+	COUNTER_SOLVER_ISLANDS,
+	COUNTER_SOLVER_ITERATIONS,	// sweeps summed over every island
+	COUNTER_MAX,
+};
+
+struct profileCounters_t {
+	long long values[ COUNTER_MAX ];
+};
+
+/*
+====================================================
+Profiler
+
+Every thread records into its own buffer, so recording takes no locks.
+Events are only kept between BeginCapture and EndCapture, counters are
+always accumulated and each thread collects its own with EndThreadFrame.
+Event buffers are only read while no thread is recording, between frames.
+A thread's buffer is freed when it exits, or by ClearEvents when it still
+holds events for the trace.
+====================================================
+*/
+class Profiler {
+public:
+	static void BeginCapture();
+	static void EndCapture();
+	static bool IsCapturing();
+
+	// Writes the captured events in the Chrome trace_event format (chrome://tracing, Perfetto)
+	static bool WriteChromeTrace( const char * path );
+	static void ClearEvents();
+
+	static double GetTimeMicroseconds();
+	static void AddEvent( const char * name, const double start, const double duration );
+
+	static void AddCounter( const profileCounter_t counter, const long long value );
+
+	// Takes only the calling thread's counters, so frames that run side by side on different threads stay apart
+	static void EndThreadFrame( profileCounters_t & counters );
+	static const char * GetCounterName( const int counter );
+};
+
+/*
+====================================================
+ScopedProfileMarker
+====================================================
+*/
+class ScopedProfileMarker {
+public:
+	explicit ScopedProfileMarker( const char * name ) : m_name( name ), m_start( -1.0 ) {
+		if ( Profiler::IsCapturing() ) {
+			m_start = Profiler::GetTimeMicroseconds();
+		}
+	}
+	~ScopedProfileMarker() {
+		if ( m_start >= 0.0 ) {
+			Profiler::AddEvent( m_name, m_start, Profiler::GetTimeMicroseconds() - m_start );
+		}
+	}
+
+private:
+	const char * m_name;
+	double m_start;
+};
+
+#define PROFILE_CONCAT_INNER( a, b ) a##b
+#define PROFILE_CONCAT( a, b ) PROFILE_CONCAT_INNER( a, b )
+
+#if ENABLE_PROFILER
+#define PROFILE_SCOPE( name ) ScopedProfileMarker PROFILE_CONCAT( profileMarker, __LINE__ )( name )
+#define PROFILE_COUNTER_ADD( counter, value ) Profiler::AddCounter( counter, value )
+#else
+#define PROFILE_SCOPE( name )
+#define PROFILE_COUNTER_ADD( counter, value )
+#endif
@@ -0,0 +1,1081 @@
+//
+//  SceneQuery.cpp
+//
+#include "SceneQuery.h"
+#include "Intersections.h"
+#include "GJK.h"
+#include "parallel-util.hpp"
+#include <algorithm>
+
+#if defined( __SSE__ ) || defined( _M_X64 )
+#include <xmmintrin.h>
+#define USE_SSE_RAY_PACKETS 1
+#endif
+
+/*
+================================================================================================
+
+Exact Ray Tests
+
+Every test works in the model space of the shape, where dir is still unit
+length, and finds the nearest t in [ 0, maxT ] with the surface normal there.
+A ray that starts inside a solid hits it at t = 0.
+
+================================================================================================
+*/
+
+/*
+====================================================
+RaySphereShape
+====================================================
+*/
+static bool RaySphereShape( const ShapeSphere * sphere, const Vec3 & start, const Vec3 & dir, const float maxT, float & t, Vec3 & normal ) {
+    float t1;
+    float t2;
+    if ( !RaySphere( start, dir, Vec3( 0.0f ), sphere->m_radius, t1, t2 ) ) {
+        return false;
+    }
+    if ( t2 < 0.0f || t1 > maxT ) {
+        return false;
+    }
+
+    if ( t1 < 0.0f ) {
+        t = 0.0f;
+        normal = dir * -1.0f;
+        return true;
+    }
+    t = t1;
+    normal = ( start + dir * t1 ) / sphere->m_radius;
+    return true;
+}
+
+/*
+====================================================
+RayBoxShape
+
+The box is the intersection of the slabs between its opposite face planes
+====================================================
+*/
+static bool RayBoxShape( const Bounds & box, const Vec3 & start, const Vec3 & dir, const float maxT, float & t, Vec3 & normal ) {
+    float tMin = 0.0f;
+    float tMax = maxT;
+    Vec3 hitNormal = dir * -1.0f;
+    for ( int axis = 0; axis < 3; axis++ ) {
+        if ( fabsf( dir[ axis ] ) < 1e-12f ) {
+            // Parallel to the slab, it's missed unless the ray is between the planes
+            if ( start[ axis ] < box.mins[ axis ] || start[ axis ] > box.maxs[ axis ] ) {
+                return false;
+            }
+            continue;
+        }
+
+        const float invDir = 1.0f / dir[ axis ];
+        float t0 = ( box.mins[ axis ] - start[ axis ] ) * invDir;
+        float t1 = ( box.maxs[ axis ] - start[ axis ] ) * invDir;
+        float side = -1.0f;
+        if ( t0 > t1 ) {
+            std::swap( t0, t1 );
+            side = 1.0f;
+        }
+
+        if ( t0 > tMin ) {
+            tMin = t0;
+            hitNormal.Zero();
+            hitNormal[ axis ] = side;
+        }
+        tMax = std::min( tMax, t1 );
+        if ( tMin > tMax ) {
+            return false;
+        }
+    }
+
+    t = tMin;
+    normal = hitNormal;
+    return true;
+}
+
+/*
+====================================================
+RayConvexShape
+
+Clips the ray by every face plane of the hull.  It enters through the
+last plane it crosses going in, and leaves through the first going out.
+====================================================
+*/
+static bool RayConvexShape( const ShapeConvex * convex, const Vec3 & start, const Vec3 & dir, const float maxT, float & t, Vec3 & normal ) {
+    float tMin = 0.0f;
+    float tMax = maxT;
+    Vec3 hitNormal = dir * -1.0f;
+    for ( int i = 0; i < convex->m_planes.size(); i++ ) {
+        const Vec4 & plane = convex->m_planes[ i ];
+        const Vec3 planeNormal( plane.x, plane.y, plane.z );
+        const float dist = planeNormal.Dot( start ) - plane.w;
+        const float denom = planeNormal.Dot( dir );
+        if ( fabsf( denom ) < 1e-12f ) {
+            if ( dist > 0.0f ) {
+                return false;
+            }
+            continue;
+        }
+
+        const float tPlane = -dist / denom;
+        if ( denom < 0.0f ) {
+            if ( tPlane > tMin ) {
+                tMin = tPlane;
+                hitNormal = planeNormal;
+            }
+        } else {
+            tMax = std::min( tMax, tPlane );
+        }
+        if ( tMin > tMax ) {
+            return false;
+        }
+    }
+
+    t = tMin;
+    normal = hitNormal;
+    return true;
+}
+
+/*
+====================================================
+RayTriangle
+
+Two sided, the normal faces the start of the ray
+====================================================
+*/
+static bool RayTriangle( const Vec3 & a, const Vec3 & b, const Vec3 & c, const Vec3 & start, const Vec3 & dir, const float maxT, float & t, Vec3 & normal ) {
+    const Vec3 ab = b - a;
+    const Vec3 ac = c - a;
+    const Vec3 p = dir.Cross( ac );
+    const float det = ab.Dot( p );
+    if ( fabsf( det ) < 1e-12f ) {
+        return false;
+    }
+
+    const float invDet = 1.0f / det;
+    const Vec3 s = start - a;
+    const float u = s.Dot( p ) * invDet;
+    if ( u < 0.0f || u > 1.0f ) {
+        return false;
+    }
+    const Vec3 q = s.Cross( ab );
+    const float v = dir.Dot( q ) * invDet;
+    if ( v < 0.0f || u + v > 1.0f ) {
+        return false;
+    }
+    const float tHit = ac.Dot( q ) * invDet;
+    if ( tHit < 0.0f || tHit > maxT ) {
+        return false;
+    }
+
+    t = tHit;
+    normal = ab.Cross( ac );
+    normal.Normalize();
+    if ( normal.Dot( dir ) > 0.0f ) {
+        normal *= -1.0f;
+    }
+    return true;
+}
+
+/*
+====================================================
+RayHeightfieldShape
+
+Walks along the ray in steps of a few cells, only the cells under each step
+are tested.  A hit inside a step's bounds can't be beaten by a later step.
+====================================================
+*/
+static bool RayHeightfieldShape( const ShapeHeightfield * field, const Vec3 & start, const Vec3 & dir, const float maxT, float & t, Vec3 & normal ) {
+    const Vec3 invDir( 1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z );
+    float tEntry;
+    if ( !RayBounds( start, invDir, field->m_bounds, maxT, tEntry ) ) {
+        return false;
+    }
+
+    const float stepLength = field->m_spacing * 4.0f;
+    const Vec3 margin( 1e-3f );
+    float best = maxT;
+    bool hasHit = false;
+    for ( float t0 = tEntry; t0 <= maxT; t0 += stepLength ) {
+        const float t1 = std::min( t0 + stepLength, maxT );
+
+        Bounds step;
+        step.Expand( start + dir * t0 - margin );
+        step.Expand( start + dir * t1 + margin );
+        if ( !step.DoesIntersect( field->m_bounds ) ) {
+            break;
+        }
+        field->QueryTriangles( step, [ & ]( const Vec3 & a, const Vec3 & b, const Vec3 & c ) {
+            float tTri;
+            Vec3 triNormal;
+            if ( RayTriangle( a, b, c, start, dir, best, tTri, triNormal ) ) {
+                best = tTri;
+                normal = triNormal;
+                hasHit = true;
+            }
+        } );
+        if ( hasHit && best <= t1 ) {
+            break;
+        }
+    }
+
+    t = best;
+    return hasHit;
+}
+
+/*
+====================================================
+RayCastShape
+====================================================
+*/
+bool RayCastShape( const Shape * shape, const Vec3 & start, const Vec3 & dir, const float maxT, float & t, Vec3 & normal ) {
+    switch ( shape->GetType() ) {
+        case Shape::SHAPE_SPHERE: {
+            return RaySphereShape( (const ShapeSphere *)shape, start, dir, maxT, t, normal );
+        }
+        case Shape::SHAPE_BOX: {
+            return RayBoxShape( ( (const ShapeBox *)shape )->m_bounds, start, dir, maxT, t, normal );
+        }
+        case Shape::SHAPE_CONVEX: {
+            return RayConvexShape( (const ShapeConvex *)shape, start, dir, maxT, t, normal );
+        }
+        case Shape::SHAPE_COMPOUND: {
+            const ShapeCompound * compound = (const ShapeCompound *)shape;
+            float best = maxT;
+            bool hasHit = false;
+            compound->m_tree.QueryRay( start, dir, best, [ & ]( const int childIdx ) {
+                const ShapeCompound::child_t & child = compound->m_children[ childIdx ];
+                const Quat invOrient = child.orientation.Inverse();
+                const Vec3 childStart = invOrient.RotatePoint( start - child.position );
+                const Vec3 childDir = invOrient.RotatePoint( dir );
+                float tChild;
+                Vec3 childNormal;
+                if ( RayCastShape( child.shape, childStart, childDir, best, tChild, childNormal ) ) {
+                    best = tChild;
+                    normal = child.orientation.RotatePoint( childNormal );
+                    hasHit = true;
+                }
+                return true;
+            } );
+            t = best;
+            return hasHit;
+        }
+        case Shape::SHAPE_TRIANGLE_MESH: {
+            const ShapeTriangleMesh * mesh = (const ShapeTriangleMesh *)shape;
+            float best = maxT;
+            bool hasHit = false;
+            mesh->m_tree.QueryRay( start, dir, best, [ & ]( const int triIdx ) {
+                Vec3 a;
+                Vec3 b;
+                Vec3 c;
+                mesh->GetTriangle( triIdx, a, b, c );
+                float tTri;
+                Vec3 triNormal;
+                if ( RayTriangle( a, b, c, start, dir, best, tTri, triNormal ) ) {
+                    best = tTri;
+                    normal = triNormal;
+                    hasHit = true;
+                }
+                return true;
+            } );
+            t = best;
+            return hasHit;
+        }
+        case Shape::SHAPE_HEIGHTFIELD: {
+            return RayHeightfieldShape( (const ShapeHeightfield *)shape, start, dir, maxT, t, normal );
+        }
+        default: {
+            // Triangles only exist inside the narrow phase
+            return false;
+        }
+    }
+}
+
+/*
+====================================================
+RayCastBody
+
+The world space ray against the body, the normal is returned in world space
+====================================================
+*/
+bool RayCastBody( const Body & body, const Vec3 & start, const Vec3 & dir, const float maxT, float & t, Vec3 & normal ) {
+    const Quat invOrient = body.m_orientation.Inverse();
+    const Vec3 localStart = invOrient.RotatePoint( start - body.m_position );
+    const Vec3 localDir = invOrient.RotatePoint( dir );
+
+    Vec3 localNormal;
+    if ( !RayCastShape( body.m_shape, localStart, localDir, maxT, t, localNormal ) ) {
+        return false;
+    }
+    normal = body.m_orientation.RotatePoint( localNormal );
+    return true;
+}
+
+/*
+================================================================================================
+
+Ray Packets
+
+Four rays traverse the trees together, each node's bounds is slab tested
+against all of them at once.  A lane whose ray is finished has a negative
+maxT, which fails every slab test.
+
+================================================================================================
+*/
+
+struct rayPacket_t {
+    alignas( 16 ) float startX[ 4 ];
+    alignas( 16 ) float startY[ 4 ];
+    alignas( 16 ) float startZ[ 4 ];
+    alignas( 16 ) float invDirX[ 4 ];
+    alignas( 16 ) float invDirY[ 4 ];
+    alignas( 16 ) float invDirZ[ 4 ];
+    alignas( 16 ) float maxT[ 4 ];
+    Vec3 dirSum;	// orders the children of the nodes
+};
+
+/*
+====================================================
+PacketBounds
+
+Returns a bit for each lane whose ray crosses the bounds
+====================================================
+*/
+static int PacketBounds( const rayPacket_t & packet, const Bounds & bounds ) {
+#if USE_SSE_RAY_PACKETS
+    const __m128 t0x = _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( bounds.mins.x ), _mm_load_ps( packet.startX ) ), _mm_load_ps( packet.invDirX ) );
+    const __m128 t1x = _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( bounds.maxs.x ), _mm_load_ps( packet.startX ) ), _mm_load_ps( packet.invDirX ) );
+    const __m128 t0y = _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( bounds.mins.y ), _mm_load_ps( packet.startY ) ), _mm_load_ps( packet.invDirY ) );
+    const __m128 t1y = _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( bounds.maxs.y ), _mm_load_ps( packet.startY ) ), _mm_load_ps( packet.invDirY ) );
+    const __m128 t0z = _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( bounds.mins.z ), _mm_load_ps( packet.startZ ) ), _mm_load_ps( packet.invDirZ ) );
+    const __m128 t1z = _mm_mul_ps( _mm_sub_ps( _mm_set1_ps( bounds.maxs.z ), _mm_load_ps( packet.startZ ) ), _mm_load_ps( packet.invDirZ ) );
+
+    // min/max return their second operand for NaNs.  The operands are in the
+    // order RayBounds compares them, so a zero direction component on a slab
+    // boundary leaves the running interval alone there too: the NaN end of the
+    // slab falls through to tMin/tMax, and the infinite end can't narrow them.
+    __m128 tMin = _mm_setzero_ps();
+    __m128 tMax = _mm_load_ps( packet.maxT );
+    tMin = _mm_max_ps( _mm_min_ps( t1x, t0x ), tMin );
+    tMax = _mm_min_ps( _mm_max_ps( t0x, t1x ), tMax );
+    tMin = _mm_max_ps( _mm_min_ps( t1y, t0y ), tMin );
+    tMax = _mm_min_ps( _mm_max_ps( t0y, t1y ), tMax );
+    tMin = _mm_max_ps( _mm_min_ps( t1z, t0z ), tMin );
+    tMax = _mm_min_ps( _mm_max_ps( t0z, t1z ), tMax );
+    return _mm_movemask_ps( _mm_cmple_ps( tMin, tMax ) );
+#else
+    int mask = 0;
+    for ( int lane = 0; lane < 4; lane++ ) {
+        const Vec3 start( packet.startX[ lane ], packet.startY[ lane ], packet.startZ[ lane ] );
+        const Vec3 invDir( packet.invDirX[ lane ], packet.invDirY[ lane ], packet.invDirZ[ lane ] );
+        float tEntry;
+        if ( packet.maxT[ lane ] >= 0.0f && RayBounds( start, invDir, bounds, packet.maxT[ lane ], tEntry ) ) {
+            mask |= 1 << lane;
+        }
+    }
+    return mask;
+#endif
+}
+
+/*
+====================================================
+TraversePacket
+
+Calls visit( itemIndex, laneMask ) for every item whose bounds any of the packet's rays cross
+====================================================
+*/
+template< typename Visit >
+static void TraversePacket( const BVH & tree, const rayPacket_t & packet, Visit && visit ) {
+    if ( tree.IsEmpty() ) {
+        return;
+    }
+
+    int stack[ BVH::MAX_DEPTH ];
+    int stackSize = 0;
+    stack[ stackSize++ ] = 0;
+
+    while ( stackSize > 0 ) {
+        const BVH::node_t & node = tree.m_nodes[ stack[ --stackSize ] ];
+        const int mask = PacketBounds( packet, node.bounds );
+        if ( 0 == mask ) {
+            continue;
+        }
+
+        if ( node.IsLeaf() ) {
+            for ( int i = 0; i < node.count; i++ ) {
+                visit( tree.m_items[ node.first + i ], mask );
+            }
+            continue;
+        }
+
+        const Bounds & left = tree.m_nodes[ node.left ].bounds;
+        const Bounds & right = tree.m_nodes[ node.right ].bounds;
+        if ( ( left.mins + left.maxs ).Dot( packet.dirSum ) < ( right.mins + right.maxs ).Dot( packet.dirSum ) ) {
+            stack[ stackSize++ ] = node.right;
+            stack[ stackSize++ ] = node.left;
+        } else {
+            stack[ stackSize++ ] = node.left;
+            stack[ stackSize++ ] = node.right;
+        }
+    }
+}
+
+/*
+================================================================================================
+
+SceneQuery
+
+================================================================================================
+*/
+
+/*
+====================================================
+MakeHit
+====================================================
+*/
+static rayHit_t MakeHit( const ray_t & ray, const int bodyIdx, const float t, const Vec3 & normal ) {
+    rayHit_t hit;
+    hit.body = bodyIdx;
+    hit.t = t;
+    hit.point = ray.start + ray.dir * t;
+    hit.normal = normal;
+    return hit;
+}
+
+static bool CompareHits( const rayHit_t & a, const rayHit_t & b ) {
+    return a.t < b.t;
+}
+
+/*
+====================================================
+SceneQuery::Prepare
+
+Brings the trees up to date with the bodies.  Only the first of several
+threads that query at the same time does the work, the others wait for it.
+====================================================
+*/
+void SceneQuery::Prepare() {
+    if ( !m_isDirty.load( std::memory_order_acquire ) ) {
+        return;
+    }
+
+    std::lock_guard< std::mutex > lock( m_prepareMutex );
+    if ( !m_isDirty.load( std::memory_order_relaxed ) ) {
+        return;
+    }
+
+    if ( m_broadPhase.NeedsBuild( m_bodies ) ) {
+        m_broadPhase.Build( m_bodies );
+    }
+
+    m_dynamicIds.clear();
+    m_dynamicBounds.clear();
+    for ( int i = 0; i < m_bodies.size(); i++ ) {
+        if ( !m_bodies.IsAlive( i ) || m_bodies[ i ].IsStatic() ) {
+            continue;
+        }
+        const Body & body = m_bodies[ i ];
+        m_dynamicIds.push_back( i );
+        m_dynamicBounds.push_back( body.m_shape->GetBounds( body.m_position, body.m_orientation ) );
+    }
+    m_dynamicTree.Build( m_dynamicBounds.data(), (int)m_dynamicBounds.size() );
+
+    m_isDirty.store( false, std::memory_order_release );
+}
+
+/*
+====================================================
+SceneQuery::CastRay
+
+Appends the ray's hits
+====================================================
+*/
+void SceneQuery::CastRay( const ray_t & ray, const rayCastMode_t mode, std::vector< rayHit_t > & hits ) const {
+    const int firstHit = (int)hits.size();
+    rayHit_t closest;
+    closest.body = -1;
+    float maxT = ray.maxT;
+    bool isDone = false;
+
+    auto visit = [ & ]( const int bodyIdx ) {
+        const Body & body = m_bodies[ bodyIdx ];
+        if ( 0 == ( body.m_collisionLayer & ray.mask ) ) {
+            return true;
+        }
+        float t;
+        Vec3 normal;
+        if ( !RayCastBody( body, ray.start, ray.dir, maxT, t, normal ) ) {
+            return true;
+        }
+
+        if ( RAYCAST_CLOSEST == mode ) {
+            closest = MakeHit( ray, bodyIdx, t, normal );
+            maxT = t;
+            return true;
+        }
+        hits.push_back( MakeHit( ray, bodyIdx, t, normal ) );
+        isDone = ( RAYCAST_ANY == mode );
+        return !isDone;
+    };
+
+    m_broadPhase.m_staticTree.QueryRay( ray.start, ray.dir, maxT, [ & ]( const int item ) {
+        return visit( m_broadPhase.m_staticIds[ item ] );
+    } );
+    if ( !isDone ) {
+        m_dynamicTree.QueryRay( ray.start, ray.dir, maxT, [ & ]( const int item ) {
+            return visit( m_dynamicIds[ item ] );
+        } );
+    }
+
+    if ( closest.body >= 0 ) {
+        hits.push_back( closest );
+    }
+    if ( RAYCAST_ALL == mode ) {
+        std::sort( hits.begin() + firstHit, hits.end(), CompareHits );
+    }
+}
+
+/*
+====================================================
+SceneQuery::CastPacket
+
+Casts up to four rays together, appending their hits.  laneHits is scratch
+space for the hits of each lane in RAYCAST_ALL mode.
+====================================================
+*/
+void SceneQuery::CastPacket( const ray_t * rays, const int num, const rayCastMode_t mode, std::vector< rayHit_t > & hits, rayResult_t * results, std::vector< rayHit_t > * laneHits ) const {
+    rayPacket_t packet;
+    packet.dirSum.Zero();
+    rayHit_t closest[ 4 ];
+    for ( int lane = 0; lane < 4; lane++ ) {
+        const ray_t & ray = rays[ std::min( lane, num - 1 ) ];
+        packet.startX[ lane ] = ray.start.x;
+        packet.startY[ lane ] = ray.start.y;
+        packet.startZ[ lane ] = ray.start.z;
+        packet.invDirX[ lane ] = 1.0f / ray.dir.x;
+        packet.invDirY[ lane ] = 1.0f / ray.dir.y;
+        packet.invDirZ[ lane ] = 1.0f / ray.dir.z;
+        packet.maxT[ lane ] = ( lane < num ) ? ray.maxT : -1.0f;
+        packet.dirSum += ray.dir;
+        closest[ lane ].body = -1;
+        laneHits[ lane ].clear();
+    }
+
+    bool isDone = false;
+    auto visit = [ & ]( const int bodyIdx, const int mask ) {
+        const Body & body = m_bodies[ bodyIdx ];
+        for ( int lane = 0; lane < num; lane++ ) {
+            const ray_t & ray = rays[ lane ];
+            if ( 0 == ( mask & ( 1 << lane ) ) || packet.maxT[ lane ] < 0.0f || 0 == ( body.m_collisionLayer & ray.mask ) ) {
+                continue;
+            }
+            float t;
+            Vec3 normal;
+            if ( !RayCastBody( body, ray.start, ray.dir, packet.maxT[ lane ], t, normal ) ) {
+                continue;
+            }
+
+            if ( RAYCAST_ALL == mode ) {
+                laneHits[ lane ].push_back( MakeHit( ray, bodyIdx, t, normal ) );
+                continue;
+            }
+            closest[ lane ] = MakeHit( ray, bodyIdx, t, normal );
+            packet.maxT[ lane ] = ( RAYCAST_ANY == mode ) ? -1.0f : t;
+        }
+        if ( RAYCAST_ANY == mode ) {
+            isDone = ( packet.maxT[ 0 ] < 0.0f && packet.maxT[ 1 ] < 0.0f && packet.maxT[ 2 ] < 0.0f && packet.maxT[ 3 ] < 0.0f );
+        }
+    };
+
+    TraversePacket( m_broadPhase.m_staticTree, packet, [ & ]( const int item, const int mask ) {
+        visit( m_broadPhase.m_staticIds[ item ], mask );
+    } );
+    if ( !isDone ) {
+        TraversePacket( m_dynamicTree, packet, [ & ]( const int item, const int mask ) {
+            visit( m_dynamicIds[ item ], mask );
+        } );
+    }
+
+    for ( int lane = 0; lane < num; lane++ ) {
+        results[ lane ].first = (int)hits.size();
+        if ( RAYCAST_ALL == mode ) {
+            std::sort( laneHits[ lane ].begin(), laneHits[ lane ].end(), CompareHits );
+            hits.insert( hits.end(), laneHits[ lane ].begin(), laneHits[ lane ].end() );
+        } else if ( closest[ lane ].body >= 0 ) {
+            hits.push_back( closest[ lane ] );
+        }
+        results[ lane ].count = (int)hits.size() - results[ lane ].first;
+    }
+}
+
+/*
+====================================================
+SceneQuery::RayCast
+
+Returns true when anything was hit
+====================================================
+*/
+bool SceneQuery::RayCast( const ray_t & ray, const rayCastMode_t mode, std::vector< rayHit_t > & hits ) {
+    Prepare();
+    hits.clear();
+    CastRay( ray, mode, hits );
+    return !hits.empty();
+}
+
+/*
+====================================================
+RunBatch
+
+Splits the queries into tasks of queriesPerTask that run on worker threads.
+run( first, end, out ) writes results[ first ] to results[ end - 1 ] with
+offsets into its own out, the outputs are joined in order at the end.
+====================================================
+*/
+template< typename T, typename Run >
+static void RunBatch( const int num, const int queriesPerTask, std::vector< T > & out, rayResult_t * results, Run && run ) {
+    out.clear();
+    if ( num <= 0 ) {
+        return;
+    }
+
+    const int numTasks = ( num + queriesPerTask - 1 ) / queriesPerTask;
+    std::vector< std::vector< T > > taskOut( numTasks );
+    auto runTask = [ & ]( const int task ) {
+        const int first = task * queriesPerTask;
+        run( first, std::min( num, first + queriesPerTask ), taskOut[ task ] );
+    };
+    if ( 1 == numTasks ) {
+        runTask( 0 );
+    } else {
+        parallelutil::parallel_for( numTasks, runTask );
+    }
+
+    for ( int task = 0; task < numTasks; task++ ) {
+        const int offset = (int)out.size();
+        const int first = task * queriesPerTask;
+        const int end = std::min( num, first + queriesPerTask );
+        for ( int i = first; i < end; i++ ) {
+            results[ i ].first += offset;
+        }
+        out.insert( out.end(), taskOut[ task ].begin(), taskOut[ task ].end() );
+    }
+}
+
+/*
+====================================================
+SceneQuery::RayCastMany
+====================================================
+*/
+void SceneQuery::RayCastMany( const ray_t * rays, const int num, const rayCastMode_t mode, std::vector< rayHit_t > & hits, rayResult_t * results ) {
+    Prepare();
+    RunBatch( num, 256, hits, results, [ & ]( const int first, const int end, std::vector< rayHit_t > & taskHits ) {
+        std::vector< rayHit_t > laneHits[ 4 ];
+        for ( int i = first; i < end; i += 4 ) {
+            CastPacket( rays + i, std::min( 4, end - i ), mode, taskHits, results + i, laneHits );
+        }
+    } );
+}
+
+/*
+================================================================================================
+
+Shape Casts and Overlaps
+
+The bodies a query could touch come from the trees, the narrow phase is GJK
+against each of their convex pieces.
+
+================================================================================================
+*/
+
+/*
+====================================================
+WorldBoundsInModelSpace
+====================================================
+*/
+static Bounds WorldBoundsInModelSpace( const Body & body, const Bounds & bounds ) {
+    const Quat invOrient = body.m_orientation.Inverse();
+    Bounds local;
+    for ( int corner = 0; corner < 8; corner++ ) {
+        const Vec3 pt(
+            ( corner & 1 ) ? bounds.maxs.x : bounds.mins.x,
+            ( corner & 2 ) ? bounds.maxs.y : bounds.mins.y,
+            ( corner & 4 ) ? bounds.maxs.z : bounds.mins.z
+        );
+        local.Expand( invOrient.RotatePoint( pt - body.m_position ) );
+    }
+    return local;
+}
+
+/*
+====================================================
+ForEachConvexPiece
+
+Calls test( piece ) with the body itself when it's convex, otherwise with a
+temporary body for each child or triangle that overlaps the world space bounds.
+test returns false to stop.
+====================================================
+*/
+template< typename Test >
+static void ForEachConvexPiece( const Body & body, const Bounds & bounds, Test && test ) {
+    bool isDone = false;
+    switch ( body.m_shape->GetType() ) {
+        case Shape::SHAPE_COMPOUND: {
+            const ShapeCompound * compound = (const ShapeCompound *)body.m_shape;
+            compound->m_tree.Query( WorldBoundsInModelSpace( body, bounds ), [ & ]( const int childIdx ) {
+                if ( isDone ) {
+                    return;
+                }
+                Body child = body;
+                child.m_shape = compound->m_children[ childIdx ].shape;
+                compound->GetChildTransform( childIdx, body.m_position, body.m_orientation, child.m_position, child.m_orientation );
+                isDone = !test( child );
+            } );
+        } break;
+        case Shape::SHAPE_TRIANGLE_MESH:
+        case Shape::SHAPE_HEIGHTFIELD: {
+            auto testTriangle = [ & ]( const Vec3 & a, const Vec3 & b, const Vec3 & c, const float thickness ) {
+                if ( isDone ) {
+                    return;
+                }
+                ShapeTriangle tri( a, b, c, thickness );
+                Body piece = body;
+                piece.m_shape = &tri;
+                isDone = !test( piece );
+            };
+            const Bounds local = WorldBoundsInModelSpace( body, bounds );
+            if ( Shape::SHAPE_TRIANGLE_MESH == body.m_shape->GetType() ) {
+                const ShapeTriangleMesh * mesh = (const ShapeTriangleMesh *)body.m_shape;
+                mesh->QueryTriangles( local, [ & ]( const Vec3 & a, const Vec3 & b, const Vec3 & c ) {
+                    testTriangle( a, b, c, mesh->m_thickness );
+                } );
+            } else {
+                const ShapeHeightfield * field = (const ShapeHeightfield *)body.m_shape;
+                field->QueryTriangles( local, [ & ]( const Vec3 & a, const Vec3 & b, const Vec3 & c ) {
+                    testTriangle( a, b, c, field->m_thickness );
+                } );
+            }
+        } break;
+        default: {
+            test( body );
+        } break;
+    }
+}
+
+/*
+====================================================
+SceneQuery::QueryBounds
+
+Calls callback( bodyIdx ) for every body whose tree bounds overlap the bounds
+====================================================
+*/
+template< typename Callback >
+void SceneQuery::QueryBounds( const Bounds & bounds, Callback && callback ) const {
+    m_broadPhase.m_staticTree.Query( bounds, [ & ]( const int item ) {
+        callback( m_broadPhase.m_staticIds[ item ] );
+    } );
+    m_dynamicTree.Query( bounds, [ & ]( const int item ) {
+        callback( m_dynamicIds[ item ] );
+    } );
+}
+
+/*
+====================================================
+SceneQuery::CastShape
+
+Appends the cast's hits
+====================================================
+*/
+void SceneQuery::CastShape( const shapeCast_t & cast, const rayCastMode_t mode, std::vector< rayHit_t > & hits ) const {
+    Body caster;
+    caster.m_shape = const_cast< Shape * >( cast.shape );
+    caster.m_position = cast.position;
+    caster.m_orientation = cast.orientation;
+
+    Bounds swept = cast.shape->GetBounds( cast.position, cast.orientation );
+    swept.Expand( swept.mins + cast.dir * cast.maxT );
+    swept.Expand( swept.maxs + cast.dir * cast.maxT );
+
+    const int firstHit = (int)hits.size();
+    rayHit_t closest;
+    closest.body = -1;
+    float maxT = cast.maxT;
+    bool isDone = false;
+
+    QueryBounds( swept, [ & ]( const int bodyIdx ) {
+        const Body & body = m_bodies[ bodyIdx ];
+        if ( isDone || 0 == ( body.m_collisionLayer & cast.mask ) ) {
+            return;
+        }
+
+        // The body is hit where its first piece is
+        rayHit_t hit;
+        hit.body = -1;
+        float bodyMaxT = maxT;
+        ForEachConvexPiece( body, swept, [ & ]( const Body & piece ) {
+            float fraction;
+            Vec3 normal;
+            Vec3 point;
+            if ( !GJK_ShapeCast( &caster, &piece, cast.dir * bodyMaxT, fraction, normal, point ) ) {
+                return true;
+            }
+            bodyMaxT *= fraction;
+            hit.body = bodyIdx;
+            hit.t = bodyMaxT;
+            hit.point = point;
+            hit.normal = normal;
+            return RAYCAST_ANY != mode;
+        } );
+        if ( hit.body < 0 ) {
+            return;
+        }
+
+        if ( RAYCAST_CLOSEST == mode ) {
+            closest = hit;
+            maxT = hit.t;
+            return;
+        }
+        hits.push_back( hit );
+        isDone = ( RAYCAST_ANY == mode );
+    } );
+
+    if ( closest.body >= 0 ) {
+        hits.push_back( closest );
+    }
+    if ( RAYCAST_ALL == mode ) {
+        std::sort( hits.begin() + firstHit, hits.end(), CompareHits );
+    }
+}
+
+/*
+====================================================
+SceneQuery::FindOverlaps
+
+Appends the overlapping bodies
+====================================================
+*/
+void SceneQuery::FindOverlaps( const overlap_t & query, std::vector< int > & bodies ) const {
+    Body queryBody;
+    queryBody.m_shape = const_cast< Shape * >( query.shape );
+    queryBody.m_position = query.position;
+    queryBody.m_orientation = query.orientation;
+
+    const Bounds bounds = query.shape->GetBounds( query.position, query.orientation );
+    const int first = (int)bodies.size();
+    QueryBounds( bounds, [ & ]( const int bodyIdx ) {
+        const Body & body = m_bodies[ bodyIdx ];
+        if ( 0 == ( body.m_collisionLayer & query.mask ) ) {
+            return;
+        }
+
+        bool doesOverlap = false;
+        ForEachConvexPiece( body, bounds, [ & ]( const Body & piece ) {
+            doesOverlap = GJK_DoesIntersect( &queryBody, &piece );
+            return !doesOverlap;
+        } );
+        if ( doesOverlap ) {
+            bodies.push_back( bodyIdx );
+        }
+    } );
+    std::sort( bodies.begin() + first, bodies.end() );
+}
+
+/*
+====================================================
+SceneQuery::ShapeCast
+
+Returns true when anything was hit
+====================================================
+*/
+bool SceneQuery::ShapeCast( const shapeCast_t & cast, const rayCastMode_t mode, std::vector< rayHit_t > & hits ) {
+    Prepare();
+    hits.clear();
+    CastShape( cast, mode, hits );
+    return !hits.empty();
+}
+
+/*
+====================================================
+SceneQuery::ShapeCastMany
+====================================================
+*/
+void SceneQuery::ShapeCastMany( const shapeCast_t * casts, const int num, const rayCastMode_t mode, std::vector< rayHit_t > & hits, rayResult_t * results ) {
+    Prepare();
+    RunBatch( num, 16, hits, results, [ & ]( const int first, const int end, std::vector< rayHit_t > & taskHits ) {
+        for ( int i = first; i < end; i++ ) {
+            results[ i ].first = (int)taskHits.size();
+            CastShape( casts[ i ], mode, taskHits );
+            results[ i ].count = (int)taskHits.size() - results[ i ].first;
+        }
+    } );
+}
+
+/*
+====================================================
+SceneQuery::Overlap
+
+Returns true when the shape touches any body
+====================================================
+*/
+bool SceneQuery::Overlap( const overlap_t & query, std::vector< int > & bodies ) {
+    Prepare();
+    bodies.clear();
+    FindOverlaps( query, bodies );
+    return !bodies.empty();
+}
+
+/*
+====================================================
+SceneQuery::OverlapMany
+====================================================
+*/
+void SceneQuery::OverlapMany( const overlap_t * queries, const int num, std::vector< int > & bodies, rayResult_t * results ) {
+    Prepare();
+    RunBatch( num, 32, bodies, results, [ & ]( const int first, const int end, std::vector< int > & taskBodies ) {
+        for ( int i = first; i < end; i++ ) {
+            results[ i ].first = (int)taskBodies.size();
+            FindOverlaps( queries[ i ], taskBodies );
+            results[ i ].count = (int)taskBodies.size() - results[ i ].first;
+        }
+    } );
+}
+
+/*
+================================================================================================
+
+Volume Queries
+
+The trees are walked with the volume, and whole subtrees that lie inside it
+are taken without testing their bodies one by one.
+
+================================================================================================
+*/
+
+/*
+====================================================
+frustum_t::frustum_t
+
+The planes are sums and differences of the rows of the clip matrix
+====================================================
+*/
+frustum_t::frustum_t( const Mat4 & matProj, const Mat4 & matView, const float margin ) {
+    const Mat4 clip = matProj * matView;
+    planes[ 0 ] = clip.rows[ 3 ] + clip.rows[ 0 ];	// left
+    planes[ 1 ] = clip.rows[ 3 ] - clip.rows[ 0 ];	// right
+    planes[ 2 ] = clip.rows[ 3 ] + clip.rows[ 1 ];	// top, Vulkan's y points down
+    planes[ 3 ] = clip.rows[ 3 ] - clip.rows[ 1 ];	// bottom
+    planes[ 4 ] = clip.rows[ 2 ];					// near
+    planes[ 5 ] = clip.rows[ 3 ] - clip.rows[ 2 ];	// far
+
+    for ( int i = 0; i < 6; i++ ) {
+        Vec4 & plane = planes[ i ];
+        const float length = Vec3( plane.x, plane.y, plane.z ).GetMagnitude();
+        plane = plane * ( 1.0f / length );
+        plane.w += margin;
+    }
+}
+
+/*
+====================================================
+frustum_t::Classify
+
+Tests the corners of the bounds furthest along and against each normal.
+Bounds near the edges of the frustum may pass as intersecting when they're
+outside, but never the other way around.
+====================================================
+*/
+volumeTest_t frustum_t::Classify( const Bounds & bounds ) const {
+    volumeTest_t test = VOLUME_INSIDE;
+    for ( int i = 0; i < 6; i++ ) {
+        const Vec4 & plane = planes[ i ];
+        const Vec3 normal( plane.x, plane.y, plane.z );
+
+        Vec3 nearest;
+        Vec3 furthest;
+        for ( int axis = 0; axis < 3; axis++ ) {
+            const bool isPositive = ( normal[ axis ] >= 0.0f );
+            furthest[ axis ] = isPositive ? bounds.maxs[ axis ] : bounds.mins[ axis ];
+            nearest[ axis ] = isPositive ? bounds.mins[ axis ] : bounds.maxs[ axis ];
+        }
+
+        if ( normal.Dot( furthest ) + plane.w < 0.0f ) {
+            return VOLUME_OUTSIDE;
+        }
+        if ( normal.Dot( nearest ) + plane.w < 0.0f ) {
+            test = VOLUME_INTERSECTS;
+        }
+    }
+    return test;
+}
+
+/*
+====================================================
+SceneQuery::QueryVolume
+
+Appends the bodies that classify( bounds ) finds in the volume, in increasing order.
+The tree bounds are only a guess at the body's, so bodies that aren't
+inside a node of their own are checked against their world bounds.
+====================================================
+*/
+template< typename Classify >
+void SceneQuery::QueryVolume( Classify && classify, const unsigned int mask, std::vector< int > & bodies ) const {
+    const int first = (int)bodies.size();
+    auto visit = [ & ]( const int bodyIdx, const bool isInside ) {
+        const Body & body = m_bodies[ bodyIdx ];
+        if ( 0 == ( body.m_collisionLayer & mask ) ) {
+            return;
+        }
+        if ( !isInside && VOLUME_OUTSIDE == classify( body.m_shape->GetBounds( body.m_position, body.m_orientation ) ) ) {
+            return;
+        }
+        bodies.push_back( bodyIdx );
+    };
+
+    m_broadPhase.m_staticTree.QueryVolume( classify, [ & ]( const int item, const bool isInside ) {
+        visit( m_broadPhase.m_staticIds[ item ], isInside );
+    } );
+    m_dynamicTree.QueryVolume( classify, [ & ]( const int item, const bool isInside ) {
+        visit( m_dynamicIds[ item ], isInside );
+    } );
+    std::sort( bodies.begin() + first, bodies.end() );
+}
+
+/*
+====================================================
+SceneQuery::QueryAABB
+
+Returns true when any body touches the bounds
+====================================================
+*/
+bool SceneQuery::QueryAABB( const Bounds & bounds, std::vector< int > & bodies, const unsigned int mask ) {
+    Prepare();
+    bodies.clear();
+    QueryVolume( [ &bounds ]( const Bounds & node ) {
+        if ( !node.DoesIntersect( bounds ) ) {
+            return VOLUME_OUTSIDE;
+        }
+        for ( int axis = 0; axis < 3; axis++ ) {
+            if ( node.mins[ axis ] < bounds.mins[ axis ] || node.maxs[ axis ] > bounds.maxs[ axis ] ) {
+                return VOLUME_INTERSECTS;
+            }
+        }
+        return VOLUME_INSIDE;
+    }, mask, bodies );
+    return !bodies.empty();
+}
+
+/*
+====================================================
+SceneQuery::QueryFrustum
+
+Returns true when any body touches the frustum
+====================================================
+*/
+bool SceneQuery::QueryFrustum( const frustum_t & frustum, std::vector< int > & bodies, const unsigned int mask ) {
+    Prepare();
+    bodies.clear();
+    QueryVolume( [ &frustum ]( const Bounds & node ) {
+        return frustum.Classify( node );
+    }, mask, bodies );
+    return !bodies.empty();
+}
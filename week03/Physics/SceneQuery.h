@@ -0,0 +1,178 @@
+//
+//	SceneQuery.h
+//
+#pragma once
+#include "Body.h"
+#include "BodyPool.h"
+#include "Broadphase.h"
+#include "BVH.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+/*
+====================================================
+ray_t
+
+The segment start + dir * t for t in [ 0, maxT ], dir is unit length.
+Only bodies whose collision layer is in the mask are hit.
+====================================================
+*/
+struct ray_t {
+	Vec3 start;
+	Vec3 dir;
+	float maxT;
+	unsigned int mask;
+
+	ray_t() : maxT( 0.0f ), mask( ~0u ) {}
+	ray_t( const Vec3 & s, const Vec3 & d, const float length ) : start( s ), dir( d ), maxT( length ), mask( ~0u ) {}
+};
+
+/*
+====================================================
+shapeCast_t
+
+The shape swept from its transform along dir for up to maxT, dir is unit length.
+Only convex shapes can be cast: spheres, boxes and convex hulls.
+====================================================
+*/
+struct shapeCast_t {
+	const Shape * shape;
+	Vec3 position;
+	Quat orientation;
+	Vec3 dir;
+	float maxT;
+	unsigned int mask;
+
+	shapeCast_t() : shape( NULL ), maxT( 0.0f ), mask( ~0u ) {}
+	shapeCast_t( const Shape * s, const Vec3 & pos, const Quat & orient, const Vec3 & d, const float distance ) : shape( s ), position( pos ), orientation( orient ), dir( d ), maxT( distance ), mask( ~0u ) {}
+};
+
+/*
+====================================================
+overlap_t
+
+Finds the bodies that touch a convex shape at the transform
+====================================================
+*/
+struct overlap_t {
+	const Shape * shape;
+	Vec3 position;
+	Quat orientation;
+	unsigned int mask;
+
+	overlap_t() : shape( NULL ), mask( ~0u ) {}
+	overlap_t( const Shape * s, const Vec3 & pos, const Quat & orient ) : shape( s ), position( pos ), orientation( orient ), mask( ~0u ) {}
+};
+
+/*
+====================================================
+frustum_t
+
+The convex volume inside six planes, built from a view projection matrix
+with Vulkan's clip space, x and y in [ -1, 1 ] and z in [ 0, 1 ].  Works
+for perspective and orthographic projections alike.
+====================================================
+*/
+struct frustum_t {
+	Vec4 planes[ 6 ];	// unit normal in xyz pointing inwards, a point p is inside when normal.Dot( p ) + w >= 0 for all of them
+
+	frustum_t() {}
+	frustum_t( const Mat4 & matProj, const Mat4 & matView, const float margin = 0.0f );	// margin pushes every plane out, in world units
+
+	volumeTest_t Classify( const Bounds & bounds ) const;
+};
+
+/*
+====================================================
+rayHit_t
+
+A hit of a ray or a shape cast
+====================================================
+*/
+struct rayHit_t {
+	int body;		// index of the body in the pool
+	float t;		// distance along the ray, zero when it starts inside the body
+	Vec3 point;		// world space, on the surface of the body
+	Vec3 normal;	// world space surface normal, against the ray when it starts inside
+};
+
+enum rayCastMode_t {
+	RAYCAST_CLOSEST,	// the nearest hit
+	RAYCAST_ANY,		// whichever hit is found first, for line of sight
+	RAYCAST_ALL,		// every body along the ray, nearest first
+};
+
+// The results of one query of a batch, hits[ first ] to hits[ first + count - 1 ]
+struct rayResult_t {
+	int first;
+	int count;
+};
+
+bool RayCastShape( const Shape * shape, const Vec3 & start, const Vec3 & dir, const float maxT, float & t, Vec3 & normal );
+bool RayCastBody( const Body & body, const Vec3 & start, const Vec3 & dir, const float maxT, float & t, Vec3 & normal );
+
+/*
+====================================================
+SceneQuery
+
+Ray casts, shape casts, overlap tests and volume queries against the bodies of a scene.
+Static bodies are found through
+the broadphase's static tree, the others through a tree over their current
+bounds that is rebuilt by the first query after Invalidate.
+
+Queries only read the bodies, any number of them can run at the same time
+from different threads.  They must not overlap an Update of the scene, or
+bodies being added and removed.
+====================================================
+*/
+class SceneQuery {
+public:
+	SceneQuery( const BodyPool & bodies, BroadPhaseState & broadPhase ) : m_bodies( bodies ), m_broadPhase( broadPhase ), m_isDirty( true ) {}
+	SceneQuery( const SceneQuery & rhs ) = delete;
+	SceneQuery & operator = ( const SceneQuery & rhs ) = delete;
+
+	// Call whenever bodies move, come or go
+	void Invalidate() { m_isDirty.store( true, std::memory_order_release ); }
+
+	bool RayCast( const ray_t & ray, const rayCastMode_t mode, std::vector< rayHit_t > & hits );
+
+	// Rays are cast in packets of four across worker threads.  results[ i ] is the range of hits of rays[ i ]
+	void RayCastMany( const ray_t * rays, const int num, const rayCastMode_t mode, std::vector< rayHit_t > & hits, rayResult_t * results );
+
+	// Sweeps with GJK against every body the swept bounds overlap.  In RAYCAST_ALL mode a body is hit once, where the shape first touches it
+	bool ShapeCast( const shapeCast_t & cast, const rayCastMode_t mode, std::vector< rayHit_t > & hits );
+	void ShapeCastMany( const shapeCast_t * casts, const int num, const rayCastMode_t mode, std::vector< rayHit_t > & hits, rayResult_t * results );
+
+	// Fills out the indices of the bodies the shape touches, in increasing order
+	bool Overlap( const overlap_t & query, std::vector< int > & bodies );
+	void OverlapMany( const overlap_t * queries, const int num, std::vector< int > & bodies, rayResult_t * results );
+
+	// Fills out the indices of the bodies whose world bounds touch the volume, in increasing order
+	bool QueryAABB( const Bounds & bounds, std::vector< int > & bodies, const unsigned int mask = ~0u );
+	bool QueryFrustum( const frustum_t & frustum, std::vector< int > & bodies, const unsigned int mask = ~0u );
+
+private:
+	void Prepare();
+	void CastRay( const ray_t & ray, const rayCastMode_t mode, std::vector< rayHit_t > & hits ) const;
+	void CastPacket( const ray_t * rays, const int num, const rayCastMode_t mode, std::vector< rayHit_t > & hits, rayResult_t * results, std::vector< rayHit_t > * laneHits ) const;
+	void CastShape( const shapeCast_t & cast, const rayCastMode_t mode, std::vector< rayHit_t > & hits ) const;
+	void FindOverlaps( const overlap_t & query, std::vector< int > & bodies ) const;
+
+	template< typename Callback >
+	void QueryBounds( const Bounds & bounds, Callback && callback ) const;
+
+	template< typename Classify >
+	void QueryVolume( Classify && classify, const unsigned int mask, std::vector< int > & bodies ) const;
+
+private:
+	const BodyPool & m_bodies;
+	BroadPhaseState & m_broadPhase;	// rebuilt here when the scene hasn't stepped since it changed
+
+	std::vector< int > m_dynamicIds;	// body index of each entry in m_dynamicTree
+	std::vector< Bounds > m_dynamicBounds;
+	BVH m_dynamicTree;
+
+	std::mutex m_prepareMutex;
+	std::atomic< bool > m_isDirty;
+};
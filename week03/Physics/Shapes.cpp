@@ -2,11 +2,12 @@
 //  Shapes.cpp
 //
 #include "Shapes.h"
+#include <mutex>
 
 static const float w = 50;
 static const float h = 25;
 
-Vec3 g_boxGround[] = {
+const Vec3 g_boxGround[] = {
 	Vec3(-w,-h, 0 ),
 	Vec3( w,-h, 0 ),
 	Vec3(-w, h, 0 ),
@@ -18,7 +19,7 @@ Vec3 g_boxGround[] = {
 	Vec3( w, h,-1 ),
 };
 
-Vec3 g_boxWall0[] = {
+const Vec3 g_boxWall0[] = {
 	Vec3(-1,-h, 0 ),
 	Vec3( 1,-h, 0 ),
 	Vec3(-1, h, 0 ),
@@ -30,7 +31,7 @@ Vec3 g_boxWall0[] = {
 	Vec3( 1, h, 5 ),
 };
 
-Vec3 g_boxWall1[] = {
+const Vec3 g_boxWall1[] = {
 	Vec3(-w,-1, 0 ),
 	Vec3( w,-1, 0 ),
 	Vec3(-w, 1, 0 ),
@@ -42,7 +43,7 @@ Vec3 g_boxWall1[] = {
 	Vec3( w, 1, 5 ),
 };
 
-Vec3 g_boxUnit[] = {
+const Vec3 g_boxUnit[] = {
 	Vec3(-1,-1,-1 ),
 	Vec3( 1,-1,-1 ),
 	Vec3(-1, 1,-1 ),
@@ -55,7 +56,7 @@ Vec3 g_boxUnit[] = {
 };
 
 static const float t = 0.25f;
-Vec3 g_boxSmall[] = {
+const Vec3 g_boxSmall[] = {
 	Vec3(-t,-t,-t ),
 	Vec3( t,-t,-t ),
 	Vec3(-t, t,-t ),
@@ -68,7 +69,7 @@ Vec3 g_boxSmall[] = {
 };
 
 static const float l = 3.0f;
-Vec3 g_boxBeam[] = {
+const Vec3 g_boxBeam[] = {
 	Vec3(-l,-t,-t ),
 	Vec3( l,-t,-t ),
 	Vec3(-l, t,-t ),
@@ -80,7 +81,7 @@ Vec3 g_boxBeam[] = {
 	Vec3( l, t, t ),
 };
 
-Vec3 g_boxPlatform[] = {
+const Vec3 g_boxPlatform[] = {
 	Vec3(-l,-l,-t ),
 	Vec3( l,-l,-t ),
 	Vec3(-l, l,-t ),
@@ -95,7 +96,7 @@ Vec3 g_boxPlatform[] = {
 static const float t2 = 0.25f;
 static const float w2 = t2 * 2.0f;
 static const float h3 = t2 * 4.0f;
-Vec3 g_boxBody[] = {
+const Vec3 g_boxBody[] = {
 	Vec3(-t2,-w2,-h3 ),
 	Vec3( t2,-w2,-h3 ),
 	Vec3(-t2, w2,-h3 ),
@@ -108,7 +109,7 @@ Vec3 g_boxBody[] = {
 };
 
 static const float h2 = 0.25f;
-Vec3 g_boxLimb[] = {
+const Vec3 g_boxLimb[] = {
 	Vec3(-h3,-h2,-h2 ),
 	Vec3( h3,-h2,-h2 ),
 	Vec3(-h3, h2,-h2 ),
@@ -120,7 +121,7 @@ Vec3 g_boxLimb[] = {
 	Vec3( h3, h2, h2 ),
 };
 
-Vec3 g_boxHead[] = {
+const Vec3 g_boxHead[] = {
 	Vec3(-h2,-h2,-h2 ),
 	Vec3( h2,-h2,-h2 ),
 	Vec3(-h2, h2,-h2 ),
@@ -133,7 +134,7 @@ Vec3 g_boxHead[] = {
 };
 
 Vec3 g_diamond[ 7 * 8 ];
-void FillDiamond() {
+static void FillDiamondOnce() {
 	Vec3 pts[ 4 + 4 ];
 	pts[ 0 ] = Vec3( 0.1f, 0, -1 );
 	pts[ 1 ] = Vec3( 1, 0, 0 );
@@ -162,4 +163,9 @@ void FillDiamond() {
 			idx++;
 		}
 	}
+}
+
+static std::once_flag s_fillDiamondFlag;
+void FillDiamond() {
+	std::call_once( s_fillDiamondFlag, FillDiamondOnce );
 }
\ No newline at end of file
@@ -5,16 +5,20 @@
 #include "Shapes/ShapeSphere.h"
 #include "Shapes/ShapeBox.h"
 #include "Shapes/ShapeConvex.h"
+#include "Shapes/ShapeCompound.h"
+#include "Shapes/ShapeTriangle.h"
+#include "Shapes/ShapeTriangleMesh.h"
+#include "Shapes/ShapeHeightfield.h"
 
-extern Vec3 g_boxGround[ 8 ];
-extern Vec3 g_boxWall0[ 8 ];
-extern Vec3 g_boxWall1[ 8 ];
-extern Vec3 g_boxUnit[ 8 ];
-extern Vec3 g_boxSmall[ 8 ];
-extern Vec3 g_boxBeam[ 8 ];
-extern Vec3 g_boxPlatform[ 8 ];
-extern Vec3 g_boxBody[ 8 ];
-extern Vec3 g_boxLimb[ 8 ];
-extern Vec3 g_boxHead[ 8 ];
+extern const Vec3 g_boxGround[ 8 ];
+extern const Vec3 g_boxWall0[ 8 ];
+extern const Vec3 g_boxWall1[ 8 ];
+extern const Vec3 g_boxUnit[ 8 ];
+extern const Vec3 g_boxSmall[ 8 ];
+extern const Vec3 g_boxBeam[ 8 ];
+extern const Vec3 g_boxPlatform[ 8 ];
+extern const Vec3 g_boxBody[ 8 ];
+extern const Vec3 g_boxLimb[ 8 ];
+extern const Vec3 g_boxHead[ 8 ];
 extern Vec3 g_diamond[ 7 * 8 ];
-void FillDiamond();
\ No newline at end of file
+void FillDiamond();	// safe to call from any number of threads, only the first call fills g_diamond
\ No newline at end of file
@@ -15,6 +15,8 @@ Shape
 */
 class Shape {
 public:
+	virtual ~Shape() {}
+
 	virtual Mat3 InertiaTensor() const = 0;
 
 	virtual Bounds GetBounds( const Vec3 & pos, const Quat & orient ) const = 0;
@@ -26,6 +28,10 @@ public:
 		SHAPE_SPHERE,
 		SHAPE_BOX,
 		SHAPE_CONVEX,
+		SHAPE_COMPOUND,
+		SHAPE_TRIANGLE,
+		SHAPE_TRIANGLE_MESH,
+		SHAPE_HEIGHTFIELD,
 	};
 	virtual shapeType_t GetType() const = 0;
 
@@ -0,0 +1,181 @@
+//
+//  ShapeCompound.cpp
+//
+#include "ShapeCompound.h"
+#include <assert.h>
+
+/*
+========================================================================================================
+
+ShapeCompound
+
+========================================================================================================
+*/
+
+/*
+====================================================
+ShapeCompound::~ShapeCompound
+====================================================
+*/
+ShapeCompound::~ShapeCompound() {
+    for ( int i = 0; i < m_children.size(); i++ ) {
+        delete m_children[ i ].shape;
+    }
+    m_children.clear();
+}
+
+/*
+====================================================
+ShapeCompound::Build
+
+Needs at least one child, and the masses can't all be zero
+====================================================
+*/
+void ShapeCompound::Build( const child_t * children, const int num ) {
+    assert( num > 0 );
+    m_children.clear();
+    m_children.reserve( num );
+    for ( int i = 0; i < num; i++ ) {
+        m_children.push_back( children[ i ] );
+    }
+
+    // Bounds of each child in the compound's space, and the tree over them
+    m_bounds.Clear();
+    m_childBounds.clear();
+    m_childBounds.reserve( num );
+    for ( int i = 0; i < num; i++ ) {
+        const child_t & child = m_children[ i ];
+        const Bounds bounds = child.shape->GetBounds( child.position, child.orientation );
+        m_childBounds.push_back( bounds );
+        m_bounds.Expand( bounds );
+    }
+    m_tree.Build( m_childBounds.data(), num );
+
+    //
+    //	Combine the mass properties
+    //
+    float totalMass = 0.0f;
+    Vec3 cm( 0.0f );
+    for ( int i = 0; i < num; i++ ) {
+        const child_t & child = m_children[ i ];
+        const Vec3 childCM = child.position + child.orientation.RotatePoint( child.shape->GetCenterOfMass() );
+        cm += childCM * child.mass;
+        assert( child.mass >= 0.0f );
+        totalMass += child.mass;
+    }
+    assert( totalMass > 0.0f );
+    m_centerOfMass = cm / totalMass;
+
+    // The child tensors are per unit mass about their own center of mass.
+    // Rotate them into the compound's space, then move them to the compound's
+    // center of mass with the parallel axis theorem.
+    m_inertiaTensor.Zero();
+    for ( int i = 0; i < num; i++ ) {
+        const child_t & child = m_children[ i ];
+        const Mat3 orient = child.orientation.ToMat3();
+        Mat3 tensor = orient * child.shape->InertiaTensor() * orient.Transpose();
+
+        const Vec3 childCM = child.position + child.orientation.RotatePoint( child.shape->GetCenterOfMass() );
+        const Vec3 R = childCM - m_centerOfMass;
+        const float R2 = R.GetLengthSqr();
+        Mat3 patTensor;
+        patTensor.rows[ 0 ] = Vec3(	R2 - R.x * R.x,		-R.x * R.y,		-R.x * R.z );
+        patTensor.rows[ 1 ] = Vec3(		-R.y * R.x,	R2 - R.y * R.y,		-R.y * R.z );
+        patTensor.rows[ 2 ] = Vec3(		-R.z * R.x,		-R.z * R.y,	R2 - R.z * R.z );
+
+        tensor += patTensor;
+        tensor *= child.mass / totalMass;
+        m_inertiaTensor += tensor;
+    }
+}
+
+/*
+====================================================
+ShapeCompound::GetChildTransform
+
+Gets the world space transform of a child from the compound's world space transform
+====================================================
+*/
+void ShapeCompound::GetChildTransform( const int idx, const Vec3 & pos, const Quat & orient, Vec3 & childPos, Quat & childOrient ) const {
+    const child_t & child = m_children[ idx ];
+    childPos = pos + orient.RotatePoint( child.position );
+    childOrient = orient * child.orientation;
+}
+
+/*
+====================================================
+ShapeCompound::Support
+
+This is the support of the convex hull of the children.
+The narrow phase never uses it for contacts, it tests the children individually.
+====================================================
+*/
+Vec3 ShapeCompound::Support( const Vec3 & dir, const Vec3 & pos, const Quat & orient, const float bias ) const {
+    Vec3 maxPt = pos;
+    float maxDist = -1e10f;
+    for ( int i = 0; i < m_children.size(); i++ ) {
+        Vec3 childPos;
+        Quat childOrient;
+        GetChildTransform( i, pos, orient, childPos, childOrient );
+
+        const Vec3 pt = m_children[ i ].shape->Support( dir, childPos, childOrient, bias );
+        const float dist = dir.Dot( pt );
+        if ( dist > maxDist ) {
+            maxDist = dist;
+            maxPt = pt;
+        }
+    }
+    return maxPt;
+}
+
+/*
+====================================================
+ShapeCompound::GetBounds
+====================================================
+*/
+Bounds ShapeCompound::GetBounds( const Vec3 & pos, const Quat & orient ) const {
+    Vec3 corners[ 8 ];
+    corners[ 0 ] = Vec3( m_bounds.mins.x, m_bounds.mins.y, m_bounds.mins.z );
+    corners[ 1 ] = Vec3( m_bounds.mins.x, m_bounds.mins.y, m_bounds.maxs.z );
+    corners[ 2 ] = Vec3( m_bounds.mins.x, m_bounds.maxs.y, m_bounds.mins.z );
+    corners[ 3 ] = Vec3( m_bounds.maxs.x, m_bounds.mins.y, m_bounds.mins.z );
+
+    corners[ 4 ] = Vec3( m_bounds.maxs.x, m_bounds.maxs.y, m_bounds.maxs.z );
+    corners[ 5 ] = Vec3( m_bounds.maxs.x, m_bounds.maxs.y, m_bounds.mins.z );
+    corners[ 6 ] = Vec3( m_bounds.maxs.x, m_bounds.mins.y, m_bounds.maxs.z );
+    corners[ 7 ] = Vec3( m_bounds.mins.x, m_bounds.maxs.y, m_bounds.maxs.z );
+
+    Bounds bounds;
+    for ( int i = 0; i < 8; i++ ) {
+        corners[ i ] = orient.RotatePoint( corners[ i ] ) + pos;
+        bounds.Expand( corners[ i ] );
+    }
+
+    return bounds;
+}
+
+/*
+====================================================
+ShapeCompound::FastestLinearSpeed
+====================================================
+*/
+float ShapeCompound::FastestLinearSpeed( const Vec3 & angularVelocity, const Vec3 & dir ) const {
+    float maxSpeed = 0.0f;
+    for ( int i = 0; i < m_childBounds.size(); i++ ) {
+        const Bounds & bounds = m_childBounds[ i ];
+        for ( int corner = 0; corner < 8; corner++ ) {
+            const Vec3 pt(
+                ( corner & 1 ) ? bounds.maxs.x : bounds.mins.x,
+                ( corner & 2 ) ? bounds.maxs.y : bounds.mins.y,
+                ( corner & 4 ) ? bounds.maxs.z : bounds.mins.z
+            );
+            Vec3 r = pt - m_centerOfMass;
+            Vec3 linearVelocity = angularVelocity.Cross( r );
+            float speed = dir.Dot( linearVelocity );
+            if ( speed > maxSpeed ) {
+                maxSpeed = speed;
+            }
+        }
+    }
+    return maxSpeed;
+}
@@ -0,0 +1,53 @@
+//
+//	ShapeCompound.h
+//
+#pragma once
+#include "ShapeBase.h"
+#include "../BVH.h"
+
+/*
+====================================================
+ShapeCompound
+
+A rigid collection of convex child shapes, each with a transform relative
+to the compound's model space.  The compound owns its children.
+====================================================
+*/
+class ShapeCompound : public Shape {
+public:
+	struct child_t {
+		Shape * shape;
+		Vec3 position;		// origin of the child in the compound's model space
+		Quat orientation;	// orientation of the child in the compound's model space
+		float mass;			// relative mass of the child, used to combine the mass properties
+	};
+
+	explicit ShapeCompound( const child_t * children, const int num ) {
+		Build( children, num );
+	}
+	~ShapeCompound();
+	ShapeCompound( const ShapeCompound & rhs ) = delete;
+	ShapeCompound & operator = ( const ShapeCompound & rhs ) = delete;
+
+	void Build( const child_t * children, const int num );
+
+	Vec3 Support( const Vec3 & dir, const Vec3 & pos, const Quat & orient, const float bias ) const override;
+
+	Mat3 InertiaTensor() const override { return m_inertiaTensor; }
+
+	Bounds GetBounds( const Vec3 & pos, const Quat & orient ) const override;
+	Bounds GetBounds() const override { return m_bounds; }
+
+	float FastestLinearSpeed( const Vec3 & angularVelocity, const Vec3 & dir ) const override;
+
+	shapeType_t GetType() const override { return SHAPE_COMPOUND; }
+
+	void GetChildTransform( const int idx, const Vec3 & pos, const Quat & orient, Vec3 & childPos, Quat & childOrient ) const;
+
+public:
+	std::vector< child_t > m_children;
+	std::vector< Bounds > m_childBounds;	// bounds of each child in the compound's model space
+	BVH m_tree;								// built over m_childBounds
+	Bounds m_bounds;
+	Mat3 m_inertiaTensor;
+};
\ No newline at end of file
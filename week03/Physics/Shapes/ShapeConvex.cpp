@@ -629,6 +629,28 @@ void ShapeConvex::Build( const Vec3 * pts, const int num ) {
     m_bounds.Clear();
     m_bounds.Expand( m_points.data(), m_points.size() );
 
+    // Keep the face planes for ray casts, pointing away from the inside of the hull
+    Vec3 inside( 0.0f );
+    for ( int i = 0; i < m_points.size(); i++ ) {
+        inside += m_points[ i ];
+    }
+    inside /= (float)m_points.size();
+
+    m_planes.clear();
+    m_planes.reserve( hullTriangles.size() );
+    for ( int i = 0; i < hullTriangles.size(); i++ ) {
+        const tri_t & tri = hullTriangles[ i ];
+        const Vec3 & a = hullPoints[ tri.a ];
+        Vec3 normal = ( hullPoints[ tri.b ] - a ).Cross( hullPoints[ tri.c ] - a );
+        if ( normal.GetLengthSqr() < 1e-12f ) {
+            continue;
+        }
+        normal.Normalize();
+        if ( normal.Dot( a - inside ) < 0.0f ) {
+            normal *= -1.0f;
+        }
+        m_planes.push_back( Vec4( normal.x, normal.y, normal.z, normal.Dot( a ) ) );
+    }
 
 #if USE_TASKFLOW
     m_centerOfMass = CalculateCenterOfMassWithTaskFlow( hullPoints, hullTriangles );
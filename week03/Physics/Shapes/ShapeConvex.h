@@ -46,6 +46,7 @@ public:
 
 public:
 	std::vector< Vec3 > m_points;
+	std::vector< Vec4 > m_planes;	// outward face planes of the hull, normal in xyz and distance from the origin in w
 	Bounds m_bounds;
 	Mat3 m_inertiaTensor;
 };
\ No newline at end of file
@@ -0,0 +1,76 @@
+//
+//  ShapeHeightfield.cpp
+//
+#include "ShapeHeightfield.h"
+
+/*
+========================================================================================================
+
+ShapeHeightfield
+
+========================================================================================================
+*/
+
+/*
+====================================================
+ShapeHeightfield::Build
+====================================================
+*/
+void ShapeHeightfield::Build( const float * heights, const int numX, const int numY, const float spacing, const float thickness ) {
+    m_heights.assign( heights, heights + numX * numY );
+    m_numX = numX;
+    m_numY = numY;
+    m_spacing = spacing;
+    m_thickness = thickness;
+
+    m_bounds.Clear();
+    for ( int y = 0; y < m_numY; y++ ) {
+        for ( int x = 0; x < m_numX; x++ ) {
+            const Vec3 pt = GetPoint( x, y );
+            m_bounds.Expand( pt );
+            m_bounds.Expand( pt - Vec3( 0, 0, m_thickness ) );
+        }
+    }
+
+    m_centerOfMass.Zero();
+}
+
+/*
+====================================================
+ShapeHeightfield::Support
+
+The narrow phase tests the cells individually, so this is only the support of the bounds
+====================================================
+*/
+Vec3 ShapeHeightfield::Support( const Vec3 & dir, const Vec3 & pos, const Quat & orient, const float bias ) const {
+    const Vec3 localDir = orient.Inverse().RotatePoint( dir );
+    const Vec3 localPt(
+        ( localDir.x > 0.0f ) ? m_bounds.maxs.x : m_bounds.mins.x,
+        ( localDir.y > 0.0f ) ? m_bounds.maxs.y : m_bounds.mins.y,
+        ( localDir.z > 0.0f ) ? m_bounds.maxs.z : m_bounds.mins.z
+    );
+
+    Vec3 norm = dir;
+    norm.Normalize();
+    norm *= bias;
+
+    return orient.RotatePoint( localPt ) + pos + norm;
+}
+
+/*
+====================================================
+ShapeHeightfield::GetBounds
+====================================================
+*/
+Bounds ShapeHeightfield::GetBounds( const Vec3 & pos, const Quat & orient ) const {
+    Bounds bounds;
+    for ( int corner = 0; corner < 8; corner++ ) {
+        const Vec3 pt(
+            ( corner & 1 ) ? m_bounds.maxs.x : m_bounds.mins.x,
+            ( corner & 2 ) ? m_bounds.maxs.y : m_bounds.mins.y,
+            ( corner & 4 ) ? m_bounds.maxs.z : m_bounds.mins.z
+        );
+        bounds.Expand( orient.RotatePoint( pt ) + pos );
+    }
+    return bounds;
+}
@@ -0,0 +1,91 @@
+//
+//	ShapeHeightfield.h
+//
+#pragma once
+#include "ShapeBase.h"
+#include <algorithm>
+
+/*
+====================================================
+ShapeHeightfield
+
+Static terrain defined by a regular grid of heights along z.
+Sample ( x, y ) sits at ( x * spacing, y * spacing, heights[ y * numX + x ] ) in model space.
+Only valid on bodies with m_invMass == 0.  The grid itself is the acceleration
+structure, the narrow phase only visits the cells under the other body's swept bounds.
+====================================================
+*/
+class ShapeHeightfield : public Shape {
+public:
+	explicit ShapeHeightfield( const float * heights, const int numX, const int numY, const float spacing, const float thickness = 0.1f ) {
+		Build( heights, numX, numY, spacing, thickness );
+	}
+	void Build( const float * heights, const int numX, const int numY, const float spacing, const float thickness );
+
+	Vec3 Support( const Vec3 & dir, const Vec3 & pos, const Quat & orient, const float bias ) const override;
+
+	// Heightfields are static, they have no inverse mass
+	Mat3 InertiaTensor() const override { Mat3 tensor; tensor.Identity(); return tensor; }
+
+	Bounds GetBounds( const Vec3 & pos, const Quat & orient ) const override;
+	Bounds GetBounds() const override { return m_bounds; }
+
+	shapeType_t GetType() const override { return SHAPE_HEIGHTFIELD; }
+
+	Vec3 GetPoint( const int x, const int y ) const { return Vec3( x * m_spacing, y * m_spacing, m_heights[ y * m_numX + x ] ); }
+
+	template< typename Callback >
+	void QueryTriangles( const Bounds & bounds, Callback && callback ) const;
+
+public:
+	std::vector< float > m_heights;
+	int m_numX;
+	int m_numY;
+	float m_spacing;
+	float m_thickness;
+	Bounds m_bounds;
+};
+
+/*
+====================================================
+ShapeHeightfield::QueryTriangles
+
+Calls callback( a, b, c ) for both triangles of every cell that overlaps the model space bounds
+====================================================
+*/
+template< typename Callback >
+inline void ShapeHeightfield::QueryTriangles( const Bounds & bounds, Callback && callback ) const {
+	if ( !bounds.DoesIntersect( m_bounds ) ) {
+		return;
+	}
+
+	const int maxCellX = m_numX - 2;
+	const int maxCellY = m_numY - 2;
+	int minX = (int)floorf( bounds.mins.x / m_spacing );
+	int minY = (int)floorf( bounds.mins.y / m_spacing );
+	int maxX = (int)floorf( bounds.maxs.x / m_spacing );
+	int maxY = (int)floorf( bounds.maxs.y / m_spacing );
+	minX = ( minX < 0 ) ? 0 : minX;
+	minY = ( minY < 0 ) ? 0 : minY;
+	maxX = ( maxX > maxCellX ) ? maxCellX : maxX;
+	maxY = ( maxY > maxCellY ) ? maxCellY : maxY;
+
+	for ( int y = minY; y <= maxY; y++ ) {
+		for ( int x = minX; x <= maxX; x++ ) {
+			const Vec3 a = GetPoint( x, y );
+			const Vec3 b = GetPoint( x + 1, y );
+			const Vec3 c = GetPoint( x + 1, y + 1 );
+			const Vec3 d = GetPoint( x, y + 1 );
+
+			// Reject cells that are entirely above or below the bounds
+			const float cellMax = std::max( std::max( a.z, b.z ), std::max( c.z, d.z ) );
+			const float cellMin = std::min( std::min( a.z, b.z ), std::min( c.z, d.z ) ) - m_thickness;
+			if ( cellMax < bounds.mins.z || cellMin > bounds.maxs.z ) {
+				continue;
+			}
+
+			callback( a, b, c );
+			callback( a, c, d );
+		}
+	}
+}
@@ -0,0 +1,76 @@
+//
+//  ShapeTriangle.cpp
+//
+#include "ShapeTriangle.h"
+
+/*
+========================================================================================================
+
+ShapeTriangle
+
+========================================================================================================
+*/
+
+/*
+====================================================
+ShapeTriangle::Build
+====================================================
+*/
+void ShapeTriangle::Build( const Vec3 & a, const Vec3 & b, const Vec3 & c, const float thickness ) {
+    Vec3 normal = ( b - a ).Cross( c - a );
+    normal.Normalize();
+    const Vec3 offset = normal * thickness;
+
+    m_points[ 0 ] = a;
+    m_points[ 1 ] = b;
+    m_points[ 2 ] = c;
+    m_points[ 3 ] = a - offset;
+    m_points[ 4 ] = b - offset;
+    m_points[ 5 ] = c - offset;
+
+    m_bounds.Clear();
+    for ( int i = 0; i < NUM_POINTS; i++ ) {
+        m_bounds.Expand( m_points[ i ] );
+    }
+
+    m_centerOfMass.Zero();
+}
+
+/*
+====================================================
+ShapeTriangle::Support
+====================================================
+*/
+Vec3 ShapeTriangle::Support( const Vec3 & dir, const Vec3 & pos, const Quat & orient, const float bias ) const {
+    // Find the point in furthest in direction
+    Vec3 maxPt = orient.RotatePoint( m_points[ 0 ] ) + pos;
+    float maxDist = dir.Dot( maxPt );
+    for ( int i = 1; i < NUM_POINTS; i++ ) {
+        const Vec3 pt = orient.RotatePoint( m_points[ i ] ) + pos;
+        const float dist = dir.Dot( pt );
+
+        if ( dist > maxDist ) {
+            maxDist = dist;
+            maxPt = pt;
+        }
+    }
+
+    Vec3 norm = dir;
+    norm.Normalize();
+    norm *= bias;
+
+    return maxPt + norm;
+}
+
+/*
+====================================================
+ShapeTriangle::GetBounds
+====================================================
+*/
+Bounds ShapeTriangle::GetBounds( const Vec3 & pos, const Quat & orient ) const {
+    Bounds bounds;
+    for ( int i = 0; i < NUM_POINTS; i++ ) {
+        bounds.Expand( orient.RotatePoint( m_points[ i ] ) + pos );
+    }
+    return bounds;
+}
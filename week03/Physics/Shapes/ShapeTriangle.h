@@ -0,0 +1,38 @@
+//
+//	ShapeTriangle.h
+//
+#pragma once
+#include "ShapeBase.h"
+
+/*
+====================================================
+ShapeTriangle
+
+A single triangle of a static mesh or heightfield, extruded along its back face
+by a small thickness so GJK/EPA always see a solid.  These are only created
+temporarily by the narrow phase, they are never the shape of a body.
+====================================================
+*/
+class ShapeTriangle : public Shape {
+public:
+	ShapeTriangle() {}
+	explicit ShapeTriangle( const Vec3 & a, const Vec3 & b, const Vec3 & c, const float thickness ) {
+		Build( a, b, c, thickness );
+	}
+	void Build( const Vec3 & a, const Vec3 & b, const Vec3 & c, const float thickness );
+
+	Vec3 Support( const Vec3 & dir, const Vec3 & pos, const Quat & orient, const float bias ) const override;
+
+	// Triangles belong to static bodies, which have no inverse mass
+	Mat3 InertiaTensor() const override { Mat3 tensor; tensor.Identity(); return tensor; }
+
+	Bounds GetBounds( const Vec3 & pos, const Quat & orient ) const override;
+	Bounds GetBounds() const override { return m_bounds; }
+
+	shapeType_t GetType() const override { return SHAPE_TRIANGLE; }
+
+public:
+	static const int NUM_POINTS = 6;
+	Vec3 m_points[ NUM_POINTS ];	// the triangle followed by its extruded copy
+	Bounds m_bounds;
+};
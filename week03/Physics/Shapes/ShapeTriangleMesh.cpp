@@ -0,0 +1,94 @@
+//
+//  ShapeTriangleMesh.cpp
+//
+#include "ShapeTriangleMesh.h"
+#include "ShapeTriangle.h"
+
+/*
+========================================================================================================
+
+ShapeTriangleMesh
+
+========================================================================================================
+*/
+
+/*
+====================================================
+ShapeTriangleMesh::Build
+====================================================
+*/
+void ShapeTriangleMesh::Build( const Vec3 * verts, const int numVerts, const int * indices, const int numIndices, const float thickness ) {
+    m_vertices.assign( verts, verts + numVerts );
+    m_indices.assign( indices, indices + numIndices );
+    m_thickness = thickness;
+
+    const int numTris = GetNumTriangles();
+    m_triBounds.clear();
+    m_triBounds.reserve( numTris );
+    m_bounds.Clear();
+    for ( int i = 0; i < numTris; i++ ) {
+        Vec3 a;
+        Vec3 b;
+        Vec3 c;
+        GetTriangle( i, a, b, c );
+
+        const ShapeTriangle tri( a, b, c, m_thickness );
+        m_triBounds.push_back( tri.GetBounds() );
+        m_bounds.Expand( tri.GetBounds() );
+    }
+    m_tree.Build( m_triBounds.data(), numTris );
+
+    m_centerOfMass.Zero();
+}
+
+/*
+====================================================
+ShapeTriangleMesh::GetTriangle
+====================================================
+*/
+void ShapeTriangleMesh::GetTriangle( const int idx, Vec3 & a, Vec3 & b, Vec3 & c ) const {
+    a = m_vertices[ m_indices[ idx * 3 + 0 ] ];
+    b = m_vertices[ m_indices[ idx * 3 + 1 ] ];
+    c = m_vertices[ m_indices[ idx * 3 + 2 ] ];
+}
+
+/*
+====================================================
+ShapeTriangleMesh::Support
+
+The narrow phase tests the triangles individually, so this is only the support
+of the bounds, which keeps it cheap for very large meshes.
+====================================================
+*/
+Vec3 ShapeTriangleMesh::Support( const Vec3 & dir, const Vec3 & pos, const Quat & orient, const float bias ) const {
+    const Vec3 localDir = orient.Inverse().RotatePoint( dir );
+    const Vec3 localPt(
+        ( localDir.x > 0.0f ) ? m_bounds.maxs.x : m_bounds.mins.x,
+        ( localDir.y > 0.0f ) ? m_bounds.maxs.y : m_bounds.mins.y,
+        ( localDir.z > 0.0f ) ? m_bounds.maxs.z : m_bounds.mins.z
+    );
+
+    Vec3 norm = dir;
+    norm.Normalize();
+    norm *= bias;
+
+    return orient.RotatePoint( localPt ) + pos + norm;
+}
+
+/*
+====================================================
+ShapeTriangleMesh::GetBounds
+====================================================
+*/
+Bounds ShapeTriangleMesh::GetBounds( const Vec3 & pos, const Quat & orient ) const {
+    Bounds bounds;
+    for ( int corner = 0; corner < 8; corner++ ) {
+        const Vec3 pt(
+            ( corner & 1 ) ? m_bounds.maxs.x : m_bounds.mins.x,
+            ( corner & 2 ) ? m_bounds.maxs.y : m_bounds.mins.y,
+            ( corner & 4 ) ? m_bounds.maxs.z : m_bounds.mins.z
+        );
+        bounds.Expand( orient.RotatePoint( pt ) + pos );
+    }
+    return bounds;
+}
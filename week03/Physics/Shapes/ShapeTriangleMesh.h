@@ -0,0 +1,65 @@
+//
+//	ShapeTriangleMesh.h
+//
+#pragma once
+#include "ShapeBase.h"
+#include "../BVH.h"
+
+/*
+====================================================
+ShapeTriangleMesh
+
+Static level geometry.  Only valid on bodies with m_invMass == 0.
+The triangles are kept in a BVH so the narrow phase only visits the
+triangles that overlap the other body's swept bounds.
+====================================================
+*/
+class ShapeTriangleMesh : public Shape {
+public:
+	explicit ShapeTriangleMesh( const Vec3 * verts, const int numVerts, const int * indices, const int numIndices, const float thickness = 0.1f ) {
+		Build( verts, numVerts, indices, numIndices, thickness );
+	}
+	void Build( const Vec3 * verts, const int numVerts, const int * indices, const int numIndices, const float thickness );
+
+	Vec3 Support( const Vec3 & dir, const Vec3 & pos, const Quat & orient, const float bias ) const override;
+
+	// Meshes are static, they have no inverse mass
+	Mat3 InertiaTensor() const override { Mat3 tensor; tensor.Identity(); return tensor; }
+
+	Bounds GetBounds( const Vec3 & pos, const Quat & orient ) const override;
+	Bounds GetBounds() const override { return m_bounds; }
+
+	shapeType_t GetType() const override { return SHAPE_TRIANGLE_MESH; }
+
+	int GetNumTriangles() const { return (int)m_indices.size() / 3; }
+	void GetTriangle( const int idx, Vec3 & a, Vec3 & b, Vec3 & c ) const;
+
+	template< typename Callback >
+	void QueryTriangles( const Bounds & bounds, Callback && callback ) const;
+
+public:
+	std::vector< Vec3 > m_vertices;
+	std::vector< int > m_indices;		// three per triangle
+	std::vector< Bounds > m_triBounds;	// bounds of each extruded triangle
+	BVH m_tree;							// built over m_triBounds
+	Bounds m_bounds;
+	float m_thickness;
+};
+
+/*
+====================================================
+ShapeTriangleMesh::QueryTriangles
+
+Calls callback( a, b, c ) for every triangle whose bounds overlap the model space bounds
+====================================================
+*/
+template< typename Callback >
+inline void ShapeTriangleMesh::QueryTriangles( const Bounds & bounds, Callback && callback ) const {
+	m_tree.Query( bounds, [ & ]( const int triIdx ) {
+		Vec3 a;
+		Vec3 b;
+		Vec3 c;
+		GetTriangle( triIdx, a, b, c );
+		callback( a, b, c );
+	} );
+}
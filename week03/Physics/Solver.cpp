@@ -0,0 +1,488 @@
+//
+//  Solver.cpp
+//
+#include "Solver.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+/*
+====================================================
+GetSolverInverseInertia
+
+The world space inverse inertia, zero for bodies that impulses don't move
+====================================================
+*/
+Mat3 GetSolverInverseInertia( const Body * body ) {
+    if ( 0.0f == body->m_invMass ) {
+        Mat3 zero;
+        zero.Zero();
+        return zero;
+    }
+    return body->GetInverseInertiaTensorWorldSpace();
+}
+
+/*
+====================================================
+InitRow
+
+Fills in the jacobian and everything derived from it.  Returns false
+for rows that can't apply an impulse, those should not be solved.
+The bias and bounds are left for the caller.
+====================================================
+*/
+bool InitRow( solverRow_t & row, Body * bodyA, const Mat3 & invInertiaA, Body * bodyB, const Mat3 & invInertiaB,
+    const Vec3 & linearA, const Vec3 & angularA, const Vec3 & linearB, const Vec3 & angularB ) {
+    row.bodyA = bodyA;
+    row.bodyB = bodyB;
+    row.linearA = linearA;
+    row.angularA = angularA;
+    row.linearB = linearB;
+    row.angularB = angularB;
+
+    row.invMassLinearA = linearA * bodyA->m_invMass;
+    row.invMassAngularA = invInertiaA * angularA;
+    row.invMassLinearB = linearB * bodyB->m_invMass;
+    row.invMassAngularB = invInertiaB * angularB;
+
+    const float k = linearA.Dot( row.invMassLinearA ) + angularA.Dot( row.invMassAngularA ) +
+                    linearB.Dot( row.invMassLinearB ) + angularB.Dot( row.invMassAngularB );
+
+    row.bias = 0.0f;
+    row.lambdaMin = -1e30f;
+    row.lambdaMax = 1e30f;
+    row.normalRow = 0;
+    row.friction = 0.0f;
+    row.lambda = 0.0f;
+    row.cachedLambda = NULL;
+    row.blockSize = 0;
+
+    if ( !( k > 1e-12f ) ) {
+        row.effectiveMass = 0.0f;
+        return false;
+    }
+    row.effectiveMass = 1.0f / k;
+    return true;
+}
+
+/*
+====================================================
+InitBlock
+
+Makes num rows in a row into one block, they must already have been initialized
+====================================================
+*/
+void InitBlock( solverRow_t * rows, const int num ) {
+    if ( num < 2 || num > MAX_BLOCK_ROWS ) {
+        return;
+    }
+
+    for ( int i = 0; i < num; i++ ) {
+        solverRow_t & row = rows[ i ];
+        for ( int j = 0; j < num; j++ ) {
+            const solverRow_t & other = rows[ j ];
+            row.blockK[ j ] = row.linearA.Dot( other.invMassLinearA ) + row.angularA.Dot( other.invMassAngularA ) +
+                              row.linearB.Dot( other.invMassLinearB ) + row.angularB.Dot( other.invMassAngularB );
+        }
+    }
+    rows[ 0 ].blockSize = num;
+}
+
+/*
+====================================================
+ApplyRowImpulse
+====================================================
+*/
+static inline void ApplyRowImpulse( const solverRow_t & row, const float impulse ) {
+    row.bodyA->m_linearVelocity += row.invMassLinearA * impulse;
+    row.bodyA->m_angularVelocity += row.invMassAngularA * impulse;
+    row.bodyB->m_linearVelocity += row.invMassLinearB * impulse;
+    row.bodyB->m_angularVelocity += row.invMassAngularB * impulse;
+}
+
+/*
+====================================================
+WarmStartRows
+
+Applies the impulses the rows ended with last frame
+====================================================
+*/
+void WarmStartRows( solverRow_t * rows, const int num ) {
+    for ( int i = 0; i < num; i++ ) {
+        solverRow_t & row = rows[ i ];
+        if ( NULL == row.cachedLambda ) {
+            continue;
+        }
+
+        row.lambda = *row.cachedLambda;
+        if ( 0.0f != row.lambda ) {
+            ApplyRowImpulse( row, row.lambda );
+        }
+    }
+}
+
+/*
+====================================================
+GetRowVelocity
+
+J * v + bias, the velocity the row's impulse has to cancel
+====================================================
+*/
+static inline float GetRowVelocity( const solverRow_t & row ) {
+    const Body * bodyA = row.bodyA;
+    const Body * bodyB = row.bodyB;
+    return row.linearA.Dot( bodyA->m_linearVelocity ) + row.angularA.Dot( bodyA->m_angularVelocity ) +
+           row.linearB.Dot( bodyB->m_linearVelocity ) + row.angularB.Dot( bodyB->m_angularVelocity ) + row.bias;
+}
+
+/*
+====================================================
+SolveRow
+
+Returns how much the row's lambda changed
+====================================================
+*/
+static inline float SolveRow( solverRow_t * rows, const int i ) {
+    solverRow_t & row = rows[ i ];
+
+    float lambdaMin = row.lambdaMin;
+    float lambdaMax = row.lambdaMax;
+    if ( 0 != row.normalRow ) {
+        lambdaMax = row.friction * rows[ i - row.normalRow ].lambda;
+        lambdaMin = -lambdaMax;
+    }
+
+    const float oldLambda = row.lambda;
+    float lambda = oldLambda - row.effectiveMass * GetRowVelocity( row );
+    lambda = ( lambda < lambdaMin ) ? lambdaMin : lambda;
+    lambda = ( lambda > lambdaMax ) ? lambdaMax : lambda;
+    row.lambda = lambda;
+
+    ApplyRowImpulse( row, lambda - oldLambda );
+    return fabsf( lambda - oldLambda );
+}
+
+/*
+====================================================
+SolveActiveSet
+
+Solves K * x = -b for the rows in mask by gaussian elimination, the other
+rows of x are zero.  Returns false when that part of K is singular, which
+happens for four contacts on a face: they only span three degrees of freedom.
+====================================================
+*/
+static bool SolveActiveSet( const solverRow_t * rows, const int mask, const float * b, float * x ) {
+    int idx[ MAX_BLOCK_ROWS ];
+    int n = 0;
+    for ( int i = 0; i < MAX_BLOCK_ROWS; i++ ) {
+        x[ i ] = 0.0f;
+        if ( mask & ( 1 << i ) ) {
+            idx[ n++ ] = i;
+        }
+    }
+
+    float m[ MAX_BLOCK_ROWS ][ MAX_BLOCK_ROWS + 1 ];
+    float maxDiagonal = 0.0f;
+    for ( int r = 0; r < n; r++ ) {
+        for ( int c = 0; c < n; c++ ) {
+            m[ r ][ c ] = rows[ idx[ r ] ].blockK[ idx[ c ] ];
+        }
+        m[ r ][ n ] = -b[ idx[ r ] ];
+        maxDiagonal = ( m[ r ][ r ] > maxDiagonal ) ? m[ r ][ r ] : maxDiagonal;
+    }
+
+    for ( int c = 0; c < n; c++ ) {
+        int pivot = c;
+        for ( int r = c + 1; r < n; r++ ) {
+            if ( fabsf( m[ r ][ c ] ) > fabsf( m[ pivot ][ c ] ) ) {
+                pivot = r;
+            }
+        }
+        if ( !( fabsf( m[ pivot ][ c ] ) > 1e-5f * maxDiagonal ) ) {
+            return false;
+        }
+        if ( pivot != c ) {
+            for ( int k = c; k <= n; k++ ) {
+                const float tmp = m[ c ][ k ];
+                m[ c ][ k ] = m[ pivot ][ k ];
+                m[ pivot ][ k ] = tmp;
+            }
+        }
+        for ( int r = c + 1; r < n; r++ ) {
+            const float scale = m[ r ][ c ] / m[ c ][ c ];
+            for ( int k = c; k <= n; k++ ) {
+                m[ r ][ k ] -= scale * m[ c ][ k ];
+            }
+        }
+    }
+
+    for ( int r = n - 1; r >= 0; r-- ) {
+        float sum = m[ r ][ n ];
+        for ( int c = r + 1; c < n; c++ ) {
+            sum -= m[ r ][ c ] * x[ idx[ c ] ];
+        }
+        x[ idx[ r ] ] = sum / m[ r ][ r ];
+    }
+    return true;
+}
+
+/*
+====================================================
+SolveBlock
+
+Solves the rows of a block together as the LCP
+
+    w = K * x + b,  x >= 0,  w >= 0,  x_i * w_i = 0
+
+by trying which rows push (x > 0) and which are left separating (w > 0).
+The active sets are tried from most to fewest rows, resting contacts usually
+push at every point.  Returns false when no active set is consistent, the
+caller then falls back to solving the rows one at a time.  residual is
+set to the largest change of any row's lambda.
+====================================================
+*/
+static const int s_blockCases[] = {
+    15,
+    7, 11, 13, 14,
+    3, 5, 6, 9, 10, 12,
+    1, 2, 4, 8,
+    0
+};
+
+static bool SolveBlock( solverRow_t * rows, const int num, float & residual ) {
+    // b is the velocity without the impulses accumulated so far, so x is the new total impulse
+    float a[ MAX_BLOCK_ROWS ] = { 0.0f };
+    float b[ MAX_BLOCK_ROWS ] = { 0.0f };
+    for ( int i = 0; i < num; i++ ) {
+        a[ i ] = rows[ i ].lambda;
+        b[ i ] = GetRowVelocity( rows[ i ] );
+    }
+    for ( int i = 0; i < num; i++ ) {
+        for ( int j = 0; j < num; j++ ) {
+            b[ i ] -= rows[ i ].blockK[ j ] * a[ j ];
+        }
+    }
+
+    // Rounding leaves a separating velocity a little below zero for rows that are exactly resting
+    const float tolerance = 1e-4f;
+
+    const int numCases = sizeof( s_blockCases ) / sizeof( s_blockCases[ 0 ] );
+    for ( int c = 0; c < numCases; c++ ) {
+        const int mask = s_blockCases[ c ];
+        if ( 0 != ( mask >> num ) ) {
+            continue;
+        }
+
+        float x[ MAX_BLOCK_ROWS ];
+        if ( !SolveActiveSet( rows, mask, b, x ) ) {
+            continue;
+        }
+
+        bool isValid = true;
+        for ( int i = 0; i < num && isValid; i++ ) {
+            if ( mask & ( 1 << i ) ) {
+                isValid = ( x[ i ] >= 0.0f );
+                continue;
+            }
+            float w = b[ i ];
+            for ( int j = 0; j < num; j++ ) {
+                w += rows[ i ].blockK[ j ] * x[ j ];
+            }
+            isValid = ( w >= -tolerance );
+        }
+        if ( !isValid ) {
+            continue;
+        }
+
+        residual = 0.0f;
+        for ( int i = 0; i < num; i++ ) {
+            rows[ i ].lambda = x[ i ];
+            ApplyRowImpulse( rows[ i ], x[ i ] - a[ i ] );
+            residual = std::max( residual, fabsf( x[ i ] - a[ i ] ) );
+        }
+        return true;
+    }
+    return false;
+}
+
+/*
+====================================================
+SolveRows
+
+One projected Gauss-Seidel sweep.  The accumulated impulse of each row is
+clamped to its bounds as it goes, so later rows see the clamped result.
+Returns the residual, the largest change of any row's lambda.
+====================================================
+*/
+float SolveRows( solverRow_t * rows, const int num ) {
+    float residual = 0.0f;
+    for ( int i = 0; i < num; i++ ) {
+        const int blockSize = rows[ i ].blockSize;
+        if ( blockSize > 1 ) {
+            float blockResidual = 0.0f;
+            if ( !SolveBlock( rows + i, blockSize, blockResidual ) ) {
+                for ( int j = 0; j < blockSize; j++ ) {
+                    blockResidual = std::max( blockResidual, SolveRow( rows, i + j ) );
+                }
+            }
+            residual = std::max( residual, blockResidual );
+            i += blockSize - 1;
+            continue;
+        }
+
+        residual = std::max( residual, SolveRow( rows, i ) );
+    }
+    return residual;
+}
+
+/*
+====================================================
+FindIsland
+====================================================
+*/
+static int FindIsland( int * parent, int idx ) {
+    while ( parent[ idx ] != idx ) {
+        parent[ idx ] = parent[ parent[ idx ] ];
+        idx = parent[ idx ];
+    }
+    return idx;
+}
+
+/*
+====================================================
+BuildIslands
+
+Copies the rows into islandRows grouped by island and fills in islands,
+which needs room for numRows entries.  Returns the number of islands.
+
+Static bodies don't join islands, everything resting on the ground would
+be one island otherwise.  Runs of rows between the same two bodies are
+moved together, so the rows of a constraint or manifold stay in order
+and their friction and block offsets stay valid.  Islands are in the
+order their first row was in, and keep the order of their rows.
+====================================================
+*/
+int BuildIslands( const BodyPool & bodies, const solverRow_t * rows, const int numRows, solverRow_t * islandRows, solverIsland_t * islands, FrameArena & arena ) {
+    if ( 0 == numRows ) {
+        return 0;
+    }
+
+    const int numBodies = bodies.size();
+    int * parent = arena.Alloc< int >( numBodies );
+    int * islandOfRoot = arena.Alloc< int >( numBodies );
+    for ( int i = 0; i < numBodies; i++ ) {
+        parent[ i ] = i;
+        islandOfRoot[ i ] = -1;
+    }
+
+    // Split the rows into runs between the same two bodies
+    int * groupStart = arena.Alloc< int >( numRows + 1 );
+    int * groupBody = arena.Alloc< int >( numRows );
+    int numGroups = 0;
+    for ( int i = 0; i < numRows; i++ ) {
+        const solverRow_t & row = rows[ i ];
+        if ( i > 0 && row.bodyA == rows[ i - 1 ].bodyA && row.bodyB == rows[ i - 1 ].bodyB ) {
+            continue;
+        }
+
+        const int a = ( 0.0f != row.bodyA->m_invMass ) ? bodies.IndexOf( row.bodyA ) : -1;
+        const int b = ( 0.0f != row.bodyB->m_invMass ) ? bodies.IndexOf( row.bodyB ) : -1;
+        if ( a >= 0 && b >= 0 ) {
+            parent[ FindIsland( parent, a ) ] = FindIsland( parent, b );
+        }
+        groupStart[ numGroups ] = i;
+        groupBody[ numGroups ] = ( a >= 0 ) ? a : b;
+        numGroups++;
+    }
+    groupStart[ numGroups ] = numRows;
+
+    // Number the islands and count their rows
+    int * groupIsland = arena.Alloc< int >( numGroups );
+    int numIslands = 0;
+    for ( int g = 0; g < numGroups; g++ ) {
+        int island;
+        if ( groupBody[ g ] < 0 ) {
+            island = numIslands++;
+            islands[ island ].numRows = 0;
+        } else {
+            const int root = FindIsland( parent, groupBody[ g ] );
+            if ( islandOfRoot[ root ] < 0 ) {
+                islandOfRoot[ root ] = numIslands++;
+                islands[ islandOfRoot[ root ] ].numRows = 0;
+            }
+            island = islandOfRoot[ root ];
+        }
+        groupIsland[ g ] = island;
+        islands[ island ].numRows += groupStart[ g + 1 ] - groupStart[ g ];
+    }
+
+    int firstRow = 0;
+    for ( int i = 0; i < numIslands; i++ ) {
+        islands[ i ].firstRow = firstRow;
+        firstRow += islands[ i ].numRows;
+    }
+
+    // Scatter the groups, reusing numRows as the fill count
+    for ( int i = 0; i < numIslands; i++ ) {
+        islands[ i ].numRows = 0;
+    }
+    for ( int g = 0; g < numGroups; g++ ) {
+        solverIsland_t & island = islands[ groupIsland[ g ] ];
+        const int num = groupStart[ g + 1 ] - groupStart[ g ];
+        memcpy( islandRows + island.firstRow + island.numRows, rows + groupStart[ g ], sizeof( solverRow_t ) * num );
+        island.numRows += num;
+    }
+    return numIslands;
+}
+
+/*
+====================================================
+SolveIslands
+
+Sweeps each island until it converges or runs out of iterations
+====================================================
+*/
+void SolveIslands( solverRow_t * rows, const solverIsland_t * islands, const int numIslands, const solverSettings_t & settings, solverStats_t & stats ) {
+    stats.numIslands = numIslands;
+    stats.minIterations = 0;
+    stats.maxIterations = 0;
+    stats.totalIterations = 0;
+    stats.maxResidual = 0.0f;
+
+    const int maxIterations = std::max( settings.maxIterations, 1 );
+    const int minIterations = std::min( std::max( settings.minIterations, 1 ), maxIterations );
+    for ( int i = 0; i < numIslands; i++ ) {
+        solverRow_t * islandRows = rows + islands[ i ].firstRow;
+        const int numRows = islands[ i ].numRows;
+
+        int iterations = 0;
+        float residual = 0.0f;
+        while ( iterations < maxIterations ) {
+            residual = SolveRows( islandRows, numRows );
+            iterations++;
+            if ( iterations >= minIterations && residual < settings.tolerance ) {
+                break;
+            }
+        }
+
+        stats.minIterations = ( 0 == i ) ? iterations : std::min( stats.minIterations, iterations );
+        stats.maxIterations = std::max( stats.maxIterations, iterations );
+        stats.totalIterations += iterations;
+        stats.maxResidual = std::max( stats.maxResidual, residual );
+    }
+}
+
+/*
+====================================================
+StoreRows
+
+Hands the accumulated impulses back to the constraints for warm starting
+====================================================
+*/
+void StoreRows( const solverRow_t * rows, const int num ) {
+    for ( int i = 0; i < num; i++ ) {
+        if ( NULL != rows[ i ].cachedLambda ) {
+            *rows[ i ].cachedLambda = rows[ i ].lambda;
+        }
+    }
+}
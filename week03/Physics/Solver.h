@@ -0,0 +1,99 @@
+//
+//	Solver.h
+//
+#pragma once
+#include "Body.h"
+#include "BodyPool.h"
+#include "FrameArena.h"
+
+/*
+====================================================
+solverRow_t
+
+One scalar row of a constraint, J * v + bias = 0 with lambdaMin <= lambda <= lambdaMax.
+Everything that stays the same while iterating is precomputed by InitRow:
+the jacobian, M^-1 * J^T and the effective mass 1 / ( J * M^-1 * J^T ).
+Solving a row is then a few dot products and multiply adds.
+
+Friction rows scale their bounds by the accumulated impulse of a normal
+row, which is normalRow rows before them.
+
+A block is blockSize rows in a row that are solved together as one small
+LCP instead of one after the other, the normal rows of a contact manifold.
+blockK holds each block row's entries of J * M^-1 * J^T.
+====================================================
+*/
+const int MAX_BLOCK_ROWS = 4;
+
+struct solverRow_t {
+	Body * bodyA;
+	Body * bodyB;
+
+	// The jacobian, split by body
+	Vec3 linearA;
+	Vec3 angularA;
+	Vec3 linearB;
+	Vec3 angularB;
+
+	// M^-1 * J^T, the change in velocity per unit of lambda
+	Vec3 invMassLinearA;
+	Vec3 invMassAngularA;
+	Vec3 invMassLinearB;
+	Vec3 invMassAngularB;
+
+	float effectiveMass;
+	float bias;
+
+	float lambdaMin;
+	float lambdaMax;
+	int normalRow;		// 0 for rows with fixed bounds
+	float friction;		// bounds are +/- friction times the normal row's lambda
+
+	float lambda;			// accumulated impulse, starts at the warm start
+	float * cachedLambda;	// where the constraint keeps lambda between frames, may be NULL
+
+	int blockSize;			// set on the first row of a block, 0 everywhere else
+	float blockK[ MAX_BLOCK_ROWS ];
+};
+
+/*
+====================================================
+solverIsland_t
+
+Rows that share no dynamic body with any other island's rows.  An island
+is iterated until its residual, the largest change of any row's lambda in
+a sweep, is below the tolerance, at least minIterations and at most
+maxIterations times.
+====================================================
+*/
+struct solverIsland_t {
+	int firstRow;
+	int numRows;
+};
+
+struct solverSettings_t {
+	solverSettings_t() : minIterations( 2 ), maxIterations( 5 ), tolerance( 1e-3f ) {}
+
+	int minIterations;
+	int maxIterations;
+	float tolerance;		// impulse, N * s
+};
+
+struct solverStats_t {
+	int numIslands;
+	int minIterations;		// sweeps of the island that converged fastest
+	int maxIterations;		// sweeps of the island that took longest
+	int totalIterations;	// sweeps summed over every island
+	float maxResidual;		// largest residual any island stopped at
+};
+
+bool InitRow( solverRow_t & row, Body * bodyA, const Mat3 & invInertiaA, Body * bodyB, const Mat3 & invInertiaB,
+	const Vec3 & linearA, const Vec3 & angularA, const Vec3 & linearB, const Vec3 & angularB );
+Mat3 GetSolverInverseInertia( const Body * body );
+void InitBlock( solverRow_t * rows, const int num );
+
+void WarmStartRows( solverRow_t * rows, const int num );
+float SolveRows( solverRow_t * rows, const int num );
+int BuildIslands( const BodyPool & bodies, const solverRow_t * rows, const int numRows, solverRow_t * islandRows, solverIsland_t * islands, FrameArena & arena );
+void SolveIslands( solverRow_t * rows, const solverIsland_t * islands, const int numIslands, const solverSettings_t & settings, solverStats_t & stats );
+void StoreRows( const solverRow_t * rows, const int num );
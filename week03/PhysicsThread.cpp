@@ -0,0 +1,264 @@
+//
+//  PhysicsThread.cpp
+//
+#include "PhysicsThread.h"
+#include <chrono>
+#include <algorithm>
+
+/*
+========================================================================================================
+
+sceneSnapshot_t
+
+========================================================================================================
+*/
+
+/*
+====================================================
+sceneSnapshot_t::GetAlpha
+
+How far from the previous towards the current transforms a frame drawn
+at time should be.  Stays at 1 when the physics thread falls behind or is paused.
+====================================================
+*/
+float sceneSnapshot_t::GetAlpha( const double time ) const {
+    if ( fixedDt <= 0.0f ) {
+        return 1.0f;
+    }
+
+    const float alpha = (float)( ( time - stepTime ) / fixedDt );
+    if ( alpha < 0.0f ) {
+        return 0.0f;
+    }
+    if ( alpha > 1.0f ) {
+        return 1.0f;
+    }
+    return alpha;
+}
+
+/*
+====================================================
+sceneSnapshot_t::GetTransform
+====================================================
+*/
+void sceneSnapshot_t::GetTransform( const int idx, const float alpha, Vec3 & pos, Quat & orient ) const {
+    if ( idx >= (int)previous.size() ) {
+        pos = current[ idx ].position;
+        orient = current[ idx ].orientation;
+        return;
+    }
+    InterpolateTransform( previous[ idx ], current[ idx ], alpha, pos, orient );
+}
+
+/*
+====================================================
+sceneSnapshot_t::CaptureBodies
+====================================================
+*/
+void sceneSnapshot_t::CaptureBodies( const Scene & scene ) {
+    const int numBodies = scene.m_bodies.size();
+    current.resize( numBodies );
+    isAlive.resize( numBodies );
+    for ( int i = 0; i < numBodies; i++ ) {
+        isAlive[ i ] = scene.m_bodies.IsAlive( i ) ? 1 : 0;
+        current[ i ].position = scene.m_bodies[ i ].m_position;
+        current[ i ].orientation = scene.m_bodies[ i ].m_orientation;
+    }
+    previous = scene.m_previousTransforms;
+
+    // Whatever alpha the body is drawn at, it's between the two transforms
+    treeIds.clear();
+    treeBounds.clear();
+    for ( int i = 0; i < numBodies; i++ ) {
+        if ( !isAlive[ i ] ) {
+            continue;
+        }
+        const Shape * shape = scene.m_bodies[ i ].m_shape;
+        Bounds bounds = shape->GetBounds( current[ i ].position, current[ i ].orientation );
+        if ( i < (int)previous.size() ) {
+            bounds.Expand( shape->GetBounds( previous[ i ].position, previous[ i ].orientation ) );
+        }
+        treeIds.push_back( i );
+        treeBounds.push_back( bounds );
+    }
+    tree.Build( treeBounds.data(), (int)treeBounds.size() );
+}
+
+/*
+====================================================
+sceneSnapshot_t::QueryFrustum
+====================================================
+*/
+void sceneSnapshot_t::QueryFrustum( const frustum_t & frustum, std::vector< int > & bodies ) const {
+    bodies.clear();
+    tree.QueryVolume( [ &frustum ]( const Bounds & bounds ) {
+        return frustum.Classify( bounds );
+    }, [ & ]( const int item, const bool isInside ) {
+        if ( isInside || VOLUME_OUTSIDE != frustum.Classify( treeBounds[ item ] ) ) {
+            bodies.push_back( treeIds[ item ] );
+        }
+    } );
+    std::sort( bodies.begin(), bodies.end() );
+}
+
+/*
+========================================================================================================
+
+SnapshotBuffer
+
+========================================================================================================
+*/
+
+/*
+====================================================
+SnapshotBuffer::Publish
+====================================================
+*/
+void SnapshotBuffer::Publish() {
+    // Release the back snapshot to the reader, and keep writing into whichever was in the middle
+    const int prev = m_middle.exchange( m_back | FRESH_BIT, std::memory_order_acq_rel );
+    m_back = prev & INDEX_MASK;
+}
+
+/*
+====================================================
+SnapshotBuffer::Acquire
+====================================================
+*/
+const sceneSnapshot_t & SnapshotBuffer::Acquire() {
+    if ( m_middle.load( std::memory_order_relaxed ) & FRESH_BIT ) {
+        const int prev = m_middle.exchange( m_front, std::memory_order_acq_rel );
+        m_front = prev & INDEX_MASK;
+    }
+    return m_snapshots[ m_front ];
+}
+
+/*
+========================================================================================================
+
+PhysicsThread
+
+========================================================================================================
+*/
+
+/*
+====================================================
+PhysicsThread::PhysicsThread
+====================================================
+*/
+PhysicsThread::PhysicsThread() :
+    m_scene( NULL ),
+    m_isRunning( false ),
+    m_isPaused( false ),
+    m_stepRequested( false ),
+    m_resetRequested( false ),
+    m_numSteps( 0 ) {
+}
+
+/*
+====================================================
+PhysicsThread::~PhysicsThread
+====================================================
+*/
+PhysicsThread::~PhysicsThread() {
+    Stop();
+}
+
+/*
+====================================================
+PhysicsThread::GetTimeSeconds
+====================================================
+*/
+double PhysicsThread::GetTimeSeconds() {
+    return std::chrono::duration< double >( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+/*
+====================================================
+PhysicsThread::Start
+====================================================
+*/
+void PhysicsThread::Start( Scene * scene ) {
+    Stop();
+
+    m_scene = scene;
+    m_numSteps = 0;
+
+    // Publish the starting state, so the reader has something to draw before the first step
+    PublishSnapshot( 0.0f );
+
+    m_isRunning.store( true );
+    m_thread = std::thread( &PhysicsThread::Run, this );
+}
+
+/*
+====================================================
+PhysicsThread::Stop
+====================================================
+*/
+void PhysicsThread::Stop() {
+    m_isRunning.store( false );
+    if ( m_thread.joinable() ) {
+        m_thread.join();
+    }
+}
+
+/*
+====================================================
+PhysicsThread::PublishSnapshot
+====================================================
+*/
+void PhysicsThread::PublishSnapshot( const float stepMS ) {
+    sceneSnapshot_t & snapshot = m_snapshots.GetBack();
+
+    snapshot.CaptureBodies( *m_scene );
+
+    // The scene is m_accumulator behind real time
+    snapshot.fixedDt = m_scene->m_fixedDt;
+    snapshot.stepTime = GetTimeSeconds() - m_scene->m_accumulator;
+    snapshot.stepMS = stepMS;
+    snapshot.numSteps = m_numSteps;
+
+    m_snapshots.Publish();
+}
+
+/*
+====================================================
+PhysicsThread::Run
+====================================================
+*/
+void PhysicsThread::Run() {
+    double timeLastStep = GetTimeSeconds();
+
+    while ( m_isRunning.load() ) {
+        const double time = GetTimeSeconds();
+        float elapsed_sec = (float)( time - timeLastStep );
+        timeLastStep = time;
+
+        if ( m_resetRequested.exchange( false ) ) {
+            m_scene->Reset();
+            PublishSnapshot( 0.0f );
+            elapsed_sec = 0.0f;
+        }
+
+        if ( m_isPaused.load() ) {
+            elapsed_sec = 0.0f;
+            if ( m_stepRequested.exchange( false ) ) {
+                elapsed_sec = m_scene->m_fixedDt;
+            }
+        }
+
+        if ( elapsed_sec > 0.0f ) {
+            const double stepStart = GetTimeSeconds();
+            const int numSteps = m_scene->Step( elapsed_sec );
+            if ( numSteps > 0 ) {
+                m_numSteps += numSteps;
+                PublishSnapshot( (float)( ( GetTimeSeconds() - stepStart ) * 1000.0 ) );
+            }
+        }
+
+        // Sleep until the next step is due, instead of spinning on the accumulator
+        const float untilNextStep = m_scene->m_fixedDt - m_scene->m_accumulator;
+        std::this_thread::sleep_for( std::chrono::duration< float >( untilNextStep ) );
+    }
+}
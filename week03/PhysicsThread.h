@@ -0,0 +1,119 @@
+//
+//  PhysicsThread.h
+//
+#pragma once
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "Scene.h"
+
+/*
+====================================================
+sceneSnapshot_t
+
+The body transforms of the last two fixed steps, as published by the physics thread.
+The current transforms are where the bodies were at stepTime, renderers draw
+one step behind and blend towards them.  The live bodies' bounds over both
+steps come with a tree, so a renderer can cull without touching the scene.
+====================================================
+*/
+struct sceneSnapshot_t {
+	sceneSnapshot_t() : fixedDt( 0.0f ), stepTime( 0.0 ), stepMS( 0.0f ), numSteps( 0 ) {}
+
+	std::vector< bodyTransform_t > previous;
+	std::vector< bodyTransform_t > current;
+	std::vector< unsigned char > isAlive;	// removed bodies leave dead slots behind
+	std::vector< int > treeIds;			// body index of each item in tree
+	std::vector< Bounds > treeBounds;	// world bounds of each live body at the previous and current transforms
+	BVH tree;
+	float fixedDt;
+	double stepTime;	// PhysicsThread::GetTimeSeconds() that the current transforms belong to
+	float stepMS;		// wall clock milliseconds of the last Scene::Step
+	long long numSteps;	// steps run since the thread was started
+
+	int GetNumBodies() const { return (int)current.size(); }
+	bool IsAlive( const int idx ) const { return 0 != isAlive[ idx ]; }
+	float GetAlpha( const double time ) const;
+	void GetTransform( const int idx, const float alpha, Vec3 & pos, Quat & orient ) const;
+
+	void CaptureBodies( const Scene & scene );	// the transforms, liveness and tree, the rest is up to the caller
+
+	// Fills out the indices of the live bodies whose bounds touch the frustum, in increasing order
+	void QueryFrustum( const frustum_t & frustum, std::vector< int > & bodies ) const;
+};
+
+/*
+====================================================
+SnapshotBuffer
+
+A lock free triple buffer.  The writer fills the back snapshot and swaps
+it with the middle one, the reader swaps the middle one with its front
+snapshot when there is a newer one.  Neither side ever waits on the other,
+and the reader always has a complete snapshot.
+====================================================
+*/
+class SnapshotBuffer {
+public:
+	SnapshotBuffer() : m_back( 0 ), m_middle( 1 ), m_front( 2 ) {}
+
+	// Writer side
+	sceneSnapshot_t & GetBack() { return m_snapshots[ m_back ]; }
+	void Publish();
+
+	// Reader side, the snapshot stays valid until the next Acquire
+	const sceneSnapshot_t & Acquire();
+
+private:
+	static const int INDEX_MASK = 3;
+	static const int FRESH_BIT = 4;	// set in m_middle when the writer published since the last Acquire
+
+	sceneSnapshot_t m_snapshots[ 3 ];
+	int m_back;
+	std::atomic< int > m_middle;
+	int m_front;
+};
+
+/*
+====================================================
+PhysicsThread
+
+Steps a scene at its fixed rate on a thread of its own, and publishes the
+body transforms after every Scene::Step.  Every other thread only talks to
+it through the requests and the snapshots, and must not touch the scene
+while the thread is running.
+====================================================
+*/
+class PhysicsThread {
+public:
+	PhysicsThread();
+	~PhysicsThread();
+	PhysicsThread( const PhysicsThread & rhs ) = delete;
+	PhysicsThread & operator = ( const PhysicsThread & rhs ) = delete;
+
+	void Start( Scene * scene );
+	void Stop();
+	bool IsRunning() const { return m_isRunning.load(); }
+
+	void SetPaused( const bool isPaused ) { m_isPaused.store( isPaused ); }
+	void RequestStep() { m_stepRequested.store( true ); }
+	void RequestReset() { m_resetRequested.store( true ); }
+
+	const sceneSnapshot_t & AcquireSnapshot() { return m_snapshots.Acquire(); }
+
+	static double GetTimeSeconds();
+
+private:
+	void Run();
+	void PublishSnapshot( const float stepMS );
+
+	Scene * m_scene;
+	std::thread m_thread;
+	std::atomic< bool > m_isRunning;
+	std::atomic< bool > m_isPaused;
+	std::atomic< bool > m_stepRequested;
+	std::atomic< bool > m_resetRequested;
+
+	long long m_numSteps;
+	SnapshotBuffer m_snapshots;
+};
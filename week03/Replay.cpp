@@ -0,0 +1,398 @@
+//
+//  Replay.cpp
+//
+#include "Replay.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+static const char REPLAY_MAGIC[ 4 ] = { 'G', 'P', 'W', 'R' };
+static const int REPLAY_VERSION = 1;
+
+/*
+====================================================
+replaySpawn_t::replaySpawn_t
+====================================================
+*/
+replaySpawn_t::replaySpawn_t() :
+    shape( SPAWN_SPHERE ),
+    size( 0.5f, 0.5f, 0.5f ),
+    position( 0, 0, 0 ),
+    orientation( 0, 0, 0, 1 ),
+    linearVelocity( 0, 0, 0 ),
+    angularVelocity( 0, 0, 0 ),
+    invMass( 1.0f ),
+    elasticity( 0.5f ),
+    friction( 0.5f ) {
+}
+
+/*
+====================================================
+replaySpawn_t::MakeBody
+====================================================
+*/
+Body replaySpawn_t::MakeBody() const {
+    Body body;
+    body.m_position = position;
+    body.m_orientation = orientation;
+    body.m_linearVelocity = linearVelocity;
+    body.m_angularVelocity = angularVelocity;
+    body.m_invMass = invMass;
+    body.m_elasticity = elasticity;
+    body.m_friction = friction;
+
+    if ( SPAWN_BOX == shape ) {
+        Vec3 pts[ 8 ];
+        for ( int i = 0; i < 8; i++ ) {
+            pts[ i ].x = ( i & 1 ) ? size.x : -size.x;
+            pts[ i ].y = ( i & 2 ) ? size.y : -size.y;
+            pts[ i ].z = ( i & 4 ) ? size.z : -size.z;
+        }
+        body.m_shape = new ShapeBox( pts, 8 );
+    } else {
+        body.m_shape = new ShapeSphere( size.x );
+    }
+    return body;
+}
+
+/*
+================================================================================================
+
+Hashing
+
+================================================================================================
+*/
+
+/*
+====================================================
+HashBytes
+
+32 bit FNV-1a
+====================================================
+*/
+static unsigned int HashBytes( unsigned int hash, const void * data, const int num ) {
+    const unsigned char * bytes = (const unsigned char *)data;
+    for ( int i = 0; i < num; i++ ) {
+        hash ^= bytes[ i ];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/*
+====================================================
+HashBody
+
+The bits of the body's transform and velocities, a difference in the last
+place of any of them changes it
+====================================================
+*/
+unsigned int HashBody( const Body & body ) {
+    unsigned int hash = 2166136261u;
+    hash = HashBytes( hash, &body.m_position, sizeof( Vec3 ) );
+    hash = HashBytes( hash, &body.m_orientation, sizeof( Quat ) );
+    hash = HashBytes( hash, &body.m_linearVelocity, sizeof( Vec3 ) );
+    hash = HashBytes( hash, &body.m_angularVelocity, sizeof( Vec3 ) );
+    return hash;
+}
+
+/*
+====================================================
+HashBodies
+
+64 bit FNV-1a of every slot's HashBody
+====================================================
+*/
+unsigned long long HashBodies( const BodyPool & bodies, std::vector< unsigned int > & bodyHashes ) {
+    bodyHashes.resize( bodies.size() );
+
+    unsigned long long hash = 14695981039346656037ull;
+    for ( int i = 0; i < bodies.size(); i++ ) {
+        bodyHashes[ i ] = bodies.IsAlive( i ) ? HashBody( bodies[ i ] ) : 0;
+
+        const unsigned char * bytes = (const unsigned char *)&bodyHashes[ i ];
+        for ( int j = 0; j < (int)sizeof( unsigned int ); j++ ) {
+            hash ^= bytes[ j ];
+            hash *= 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+/*
+================================================================================================
+
+Files
+
+================================================================================================
+*/
+
+template< typename T >
+static bool WriteValue( FILE * file, const T & value ) {
+    return 1 == fwrite( &value, sizeof( T ), 1, file );
+}
+
+template< typename T >
+static bool ReadValue( FILE * file, T & value ) {
+    return 1 == fread( &value, sizeof( T ), 1, file );
+}
+
+template< typename T >
+static bool WriteArray( FILE * file, const std::vector< T > & values ) {
+    const int num = (int)values.size();
+    if ( !WriteValue( file, num ) ) {
+        return false;
+    }
+    return 0 == num || num == fwrite( values.data(), sizeof( T ), num, file );
+}
+
+template< typename T >
+static bool ReadArray( FILE * file, std::vector< T > & values ) {
+    int num = 0;
+    if ( !ReadValue( file, num ) || num < 0 ) {
+        return false;
+    }
+    values.resize( num );
+    return 0 == num || num == fread( values.data(), sizeof( T ), num, file );
+}
+
+/*
+====================================================
+replayLog_t::Save
+====================================================
+*/
+bool replayLog_t::Save( const char * path ) const {
+    FILE * file = fopen( path, "wb" );
+    if ( NULL == file ) {
+        return false;
+    }
+
+    const std::vector< char > presetName( preset.begin(), preset.end() );
+    bool isOk = ( 1 == fwrite( REPLAY_MAGIC, sizeof( REPLAY_MAGIC ), 1, file ) );
+    isOk = isOk && WriteValue( file, REPLAY_VERSION );
+    isOk = isOk && WriteArray( file, presetName );
+    isOk = isOk && WriteValue( file, gravity );
+    isOk = isOk && WriteValue( file, blockSolver );
+    isOk = isOk && WriteValue( file, speculativeContacts );
+    isOk = isOk && WriteValue( file, solverSettings );
+    isOk = isOk && WriteValue( file, broadPhaseType );
+    isOk = isOk && WriteValue( file, initialHash );
+    isOk = isOk && WriteArray( file, initialBodyHashes );
+
+    const int numSteps = (int)steps.size();
+    isOk = isOk && WriteValue( file, numSteps );
+    for ( int i = 0; i < numSteps && isOk; i++ ) {
+        const replayStep_t & step = steps[ i ];
+        isOk = isOk && WriteValue( file, step.dt );
+        isOk = isOk && WriteArray( file, step.inputs );
+        isOk = isOk && WriteValue( file, step.hash );
+        isOk = isOk && WriteArray( file, step.bodyHashes );
+    }
+
+    isOk = ( 0 == fclose( file ) ) && isOk;
+    return isOk;
+}
+
+/*
+====================================================
+replayLog_t::Load
+====================================================
+*/
+bool replayLog_t::Load( const char * path ) {
+    FILE * file = fopen( path, "rb" );
+    if ( NULL == file ) {
+        return false;
+    }
+
+    char magic[ 4 ];
+    int version = 0;
+    std::vector< char > presetName;
+    bool isOk = ( 1 == fread( magic, sizeof( magic ), 1, file ) ) && ( 0 == memcmp( magic, REPLAY_MAGIC, sizeof( magic ) ) );
+    isOk = isOk && ReadValue( file, version ) && ( REPLAY_VERSION == version );
+    isOk = isOk && ReadArray( file, presetName );
+    isOk = isOk && ReadValue( file, gravity );
+    isOk = isOk && ReadValue( file, blockSolver );
+    isOk = isOk && ReadValue( file, speculativeContacts );
+    isOk = isOk && ReadValue( file, solverSettings );
+    isOk = isOk && ReadValue( file, broadPhaseType );
+    isOk = isOk && ReadValue( file, initialHash );
+    isOk = isOk && ReadArray( file, initialBodyHashes );
+
+    int numSteps = 0;
+    isOk = isOk && ReadValue( file, numSteps ) && ( numSteps >= 0 );
+    steps.clear();
+    for ( int i = 0; i < numSteps && isOk; i++ ) {
+        replayStep_t step;
+        isOk = isOk && ReadValue( file, step.dt );
+        isOk = isOk && ReadArray( file, step.inputs );
+        isOk = isOk && ReadValue( file, step.hash );
+        isOk = isOk && ReadArray( file, step.bodyHashes );
+        steps.push_back( step );
+    }
+    preset.assign( presetName.begin(), presetName.end() );
+
+    fclose( file );
+    return isOk;
+}
+
+/*
+================================================================================================
+
+ReplayRecorder
+
+================================================================================================
+*/
+
+/*
+====================================================
+ReplayRecorder::Begin
+====================================================
+*/
+void ReplayRecorder::Begin( const Scene & scene ) {
+    m_log = replayLog_t();
+    m_log.preset = Scene::GetPresetName( scene.m_preset );
+    m_log.gravity = scene.m_gravity;
+    m_log.blockSolver = scene.m_blockSolver;
+    m_log.speculativeContacts = scene.m_speculativeContacts;
+    m_log.solverSettings = scene.m_solverSettings;
+    m_log.broadPhaseType = (int)scene.m_broadPhase.m_type;
+    m_log.initialHash = HashBodies( scene.m_bodies, m_log.initialBodyHashes );
+
+    m_pendingInputs.clear();
+}
+
+/*
+====================================================
+ReplayRecorder::ApplyImpulse
+====================================================
+*/
+void ReplayRecorder::ApplyImpulse( Scene & scene, const int body, const Vec3 & point, const Vec3 & impulse ) {
+    if ( body < 0 || body >= scene.m_bodies.size() || !scene.m_bodies.IsAlive( body ) ) {
+        return;
+    }
+    scene.m_bodies[ body ].ApplyImpulse( point, impulse );
+
+    replayInput_t input;
+    input.type = replayInput_t::INPUT_IMPULSE;
+    input.body = body;
+    input.point = point;
+    input.impulse = impulse;
+    m_pendingInputs.push_back( input );
+}
+
+/*
+====================================================
+ReplayRecorder::Spawn
+====================================================
+*/
+bodyHandle_t ReplayRecorder::Spawn( Scene & scene, const replaySpawn_t & spawn ) {
+    const bodyHandle_t handle = scene.AddBody( spawn.MakeBody() );
+
+    replayInput_t input;
+    input.type = replayInput_t::INPUT_SPAWN;
+    input.body = handle.index;
+    input.spawn = spawn;
+    m_pendingInputs.push_back( input );
+    return handle;
+}
+
+/*
+====================================================
+ReplayRecorder::Update
+====================================================
+*/
+void ReplayRecorder::Update( Scene & scene, const float dt_sec ) {
+    scene.Update( dt_sec );
+
+    m_log.steps.push_back( replayStep_t() );
+    replayStep_t & step = m_log.steps.back();
+    step.dt = dt_sec;
+    step.inputs.swap( m_pendingInputs );
+    step.hash = HashBodies( scene.m_bodies, step.bodyHashes );
+    m_pendingInputs.clear();
+}
+
+/*
+================================================================================================
+
+CheckReplay
+
+================================================================================================
+*/
+
+/*
+====================================================
+FindDivergedBody
+
+The first slot whose hash differs, -1 when only the number of slots does
+====================================================
+*/
+static int FindDivergedBody( const std::vector< unsigned int > & expected, const std::vector< unsigned int > & actual ) {
+    const int num = (int)std::min( expected.size(), actual.size() );
+    for ( int i = 0; i < num; i++ ) {
+        if ( expected[ i ] != actual[ i ] ) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+====================================================
+CheckReplay
+====================================================
+*/
+replayCheck_t CheckReplay( const replayLog_t & log ) {
+    replayCheck_t result;
+
+    Scene scene;
+    if ( !scene.SetPreset( log.preset.c_str() ) ) {
+        result.isDiverged = true;
+        return result;
+    }
+    scene.Reset();
+    scene.m_gravity = log.gravity;
+    scene.m_blockSolver = log.blockSolver;
+    scene.m_speculativeContacts = log.speculativeContacts;
+    scene.m_solverSettings = log.solverSettings;
+    scene.m_broadPhase.m_type = (BroadPhaseState::broadPhaseType_t)log.broadPhaseType;
+    scene.m_broadPhase.Invalidate();
+
+    std::vector< unsigned int > bodyHashes;
+    if ( HashBodies( scene.m_bodies, bodyHashes ) != log.initialHash ) {
+        result.isDiverged = true;
+        result.body = FindDivergedBody( log.initialBodyHashes, bodyHashes );
+        return result;
+    }
+
+    for ( int i = 0; i < log.steps.size(); i++ ) {
+        const replayStep_t & step = log.steps[ i ];
+        for ( int j = 0; j < step.inputs.size(); j++ ) {
+            const replayInput_t & input = step.inputs[ j ];
+            if ( replayInput_t::INPUT_SPAWN == input.type ) {
+                // Impulses later on name the body by its slot, so it has to land in the same one
+                const bodyHandle_t handle = scene.AddBody( input.spawn.MakeBody() );
+                if ( handle.index != input.body ) {
+                    result.isDiverged = true;
+                    result.step = i;
+                    result.body = input.body;
+                    return result;
+                }
+            } else if ( input.body < scene.m_bodies.size() && scene.m_bodies.IsAlive( input.body ) ) {
+                scene.m_bodies[ input.body ].ApplyImpulse( input.point, input.impulse );
+            }
+        }
+
+        scene.Update( step.dt );
+        result.numStepsRun++;
+
+        if ( HashBodies( scene.m_bodies, bodyHashes ) != step.hash ) {
+            result.isDiverged = true;
+            result.step = i;
+            result.body = FindDivergedBody( step.bodyHashes, bodyHashes );
+            return result;
+        }
+    }
+
+    return result;
+}
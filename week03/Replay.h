@@ -0,0 +1,145 @@
+//
+//  Replay.h
+//
+#pragma once
+#include <vector>
+#include <string>
+
+#include "Scene.h"
+
+/*
+====================================================
+replaySpawn_t
+
+A body added between updates.  Only the shapes that can be described
+by a few numbers can be spawned, spheres and boxes.
+====================================================
+*/
+struct replaySpawn_t {
+	enum shape_t {
+		SPAWN_SPHERE,	// size.x is the radius
+		SPAWN_BOX,		// size is the half extents
+	};
+
+	int shape;
+	Vec3 size;
+	Vec3 position;
+	Quat orientation;
+	Vec3 linearVelocity;
+	Vec3 angularVelocity;
+	float invMass;
+	float elasticity;
+	float friction;
+
+	replaySpawn_t();
+	Body MakeBody() const;	// the shape is new'd, the scene owns it once the body is added
+};
+
+/*
+====================================================
+replayInput_t
+
+Anything done to the scene from outside between two updates
+====================================================
+*/
+struct replayInput_t {
+	enum type_t {
+		INPUT_IMPULSE,	// ApplyImpulse( point, impulse ) on body
+		INPUT_SPAWN,	// AddBody of spawn.MakeBody()
+	};
+
+	int type;
+	int body;
+	Vec3 point;
+	Vec3 impulse;
+	replaySpawn_t spawn;
+};
+
+/*
+====================================================
+replayStep_t
+
+One Scene::Update, the inputs that came before it and the state it left
+====================================================
+*/
+struct replayStep_t {
+	float dt;
+	std::vector< replayInput_t > inputs;
+	unsigned long long hash;				// HashBodies of bodyHashes
+	std::vector< unsigned int > bodyHashes;	// HashBody of every slot, 0 for the free ones
+};
+
+/*
+====================================================
+replayLog_t
+
+A scene preset and its settings, the state Reset left it in, and every
+step after that.  Files are written in the native byte order, they only
+replay on machines of the same endianness.
+====================================================
+*/
+struct replayLog_t {
+	std::string preset;
+	Vec3 gravity;
+	bool blockSolver;
+	bool speculativeContacts;
+	solverSettings_t solverSettings;
+	int broadPhaseType;
+
+	unsigned long long initialHash;
+	std::vector< unsigned int > initialBodyHashes;
+	std::vector< replayStep_t > steps;
+
+	replayLog_t() : gravity( GRAVITY ), blockSolver( true ), speculativeContacts( false ), broadPhaseType( 0 ), initialHash( 0 ) {}
+
+	bool Save( const char * path ) const;
+	bool Load( const char * path );
+};
+
+unsigned int HashBody( const Body & body );
+unsigned long long HashBodies( const BodyPool & bodies, std::vector< unsigned int > & bodyHashes );
+
+/*
+====================================================
+ReplayRecorder
+
+Goes between the game and the scene, and logs whatever it passes on.
+Begin once the scene has been Reset, then make every change to it
+through the recorder until the log is taken.
+====================================================
+*/
+class ReplayRecorder {
+public:
+	void Begin( const Scene & scene );
+
+	void ApplyImpulse( Scene & scene, const int body, const Vec3 & point, const Vec3 & impulse );
+	bodyHandle_t Spawn( Scene & scene, const replaySpawn_t & spawn );
+	void Update( Scene & scene, const float dt_sec );
+
+	const replayLog_t & GetLog() const { return m_log; }
+
+private:
+	replayLog_t m_log;
+	std::vector< replayInput_t > m_pendingInputs;	// since the last Update
+};
+
+/*
+====================================================
+replayCheck_t
+
+Where a replay first went its own way.  A step of -1 is the state Reset
+left the scene in, a body of -1 is a change in the number of slots.
+====================================================
+*/
+struct replayCheck_t {
+	bool isDiverged;
+	int step;
+	int body;
+	int numStepsRun;
+
+	replayCheck_t() : isDiverged( false ), step( -1 ), body( -1 ), numStepsRun( 0 ) {}
+};
+
+// Rebuilds the logged preset, and feeds it the logged inputs through Scene::Update
+// until a step's state differs from the log, or the log runs out
+replayCheck_t CheckReplay( const replayLog_t & log );
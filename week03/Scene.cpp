@@ -6,6 +6,11 @@
 #include "Physics/Intersections.h"
 #include "Physics/Broadphase.h"
 #include "Physics/GJK.h"
+#include "Physics/Solver.h"
+#include "Physics/Profiler.h"
+#include <string.h>
+#include <chrono>
+#include <algorithm>
 
 /*
 ========================================================================================================
@@ -21,10 +26,17 @@ Scene::~Scene
 ====================================================
 */
 Scene::~Scene() {
+	// Removed bodies keep their shape until they are flushed, freed slots have none
 	for ( int i = 0; i < m_bodies.size(); i++ ) {
 		delete m_bodies[ i ].m_shape;
+		m_bodies[ i ].m_shape = NULL;
 	}
 	m_bodies.clear();
+
+    for ( int i = 0; i < m_constraints.size(); i++ ) {
+        delete m_constraints[ i ];
+    }
+    m_constraints.clear();
 }
 
 /*
@@ -35,14 +47,23 @@ Scene::Reset
 void Scene::Reset() {
 	for ( int i = 0; i < m_bodies.size(); i++ ) {
 		delete m_bodies[ i ].m_shape;
+		m_bodies[ i ].m_shape = NULL;
 	}
 	m_bodies.clear();
+	m_manifolds.Clear();
 
     for ( int i = 0; i < m_constraints.size(); i++ ) {
         delete m_constraints[ i ];
     }
     m_constraints.clear();
 
+    m_broadPhase.Invalidate();
+    m_query.Invalidate();
+
+    m_accumulator = 0.0f;
+    m_droppedTime = 0.0f;
+    m_previousTransforms.clear();
+
 	Initialize();
 }
 
@@ -51,7 +72,7 @@ void Scene::Reset() {
 AddStandardSandBox
 ====================================================
 */
-void AddStandardSandBox( std::vector< Body > & bodies ) {
+void AddStandardSandBox( BodyPool & bodies ) {
     Body body;
 
     body.m_position = Vec3( 0, 0, 0 );
@@ -62,7 +83,7 @@ void AddStandardSandBox( std::vector< Body > & bodies ) {
     body.m_elasticity = 0.5f;
     body.m_friction = 0.5f;
     body.m_shape = new ShapeBox( g_boxGround, sizeof( g_boxGround ) / sizeof( Vec3 ) );
-    bodies.push_back( body );
+    bodies.Add( body );
 
     body.m_position = Vec3( 50, 0, 0 );
     body.m_orientation = Quat( 0, 0, 0, 1 );
@@ -72,7 +93,7 @@ void AddStandardSandBox( std::vector< Body > & bodies ) {
     body.m_elasticity = 0.5f;
     body.m_friction = 0.0f;
     body.m_shape = new ShapeBox( g_boxWall0, sizeof( g_boxWall0 ) / sizeof( Vec3 ) );
-    bodies.push_back( body );
+    bodies.Add( body );
 
     body.m_position = Vec3(-50, 0, 0 );
     body.m_orientation = Quat( 0, 0, 0, 1 );
@@ -82,7 +103,7 @@ void AddStandardSandBox( std::vector< Body > & bodies ) {
     body.m_elasticity = 0.5f;
     body.m_friction = 0.0f;
     body.m_shape = new ShapeBox( g_boxWall0, sizeof( g_boxWall0 ) / sizeof( Vec3 ) );
-    bodies.push_back( body );
+    bodies.Add( body );
 
     body.m_position = Vec3( 0, 25, 0 );
     body.m_orientation = Quat( 0, 0, 0, 1 );
@@ -92,7 +113,7 @@ void AddStandardSandBox( std::vector< Body > & bodies ) {
     body.m_elasticity = 0.5f;
     body.m_friction = 0.0f;
     body.m_shape = new ShapeBox( g_boxWall1, sizeof( g_boxWall1 ) / sizeof( Vec3 ) );
-    bodies.push_back( body );
+    bodies.Add( body );
 
     body.m_position = Vec3( 0,-25, 0 );
     body.m_orientation = Quat( 0, 0, 0, 1 );
@@ -102,380 +123,964 @@ void AddStandardSandBox( std::vector< Body > & bodies ) {
     body.m_elasticity = 0.5f;
     body.m_friction = 0.0f;
     body.m_shape = new ShapeBox( g_boxWall1, sizeof( g_boxWall1 ) / sizeof( Vec3 ) );
-    bodies.push_back( body );
+    bodies.Add( body );
 }
 
 /*
 ====================================================
-Scene::Initialize
+AddRagdoll
 ====================================================
 */
-void Scene::Initialize() {
+void AddRagdoll( BodyPool & bodies, std::vector< Constraint * > & constraints, const Vec3 & offset ) {
     Body body;
 
-    //
-    //	Build a ragdoll
-    //
-    if (true)
+    // head
+    body.m_position = Vec3( 0, 0, 5.5f ) + offset;
+    body.m_orientation = Quat( 0, 0, 0, 1 );
+    body.m_shape = new ShapeBox( g_boxSmall, sizeof( g_boxSmall ) / sizeof( Vec3 ) );
+    body.m_invMass = 2.0f;
+    body.m_elasticity = 1.0f;
+    body.m_friction = 1.0f;
+    const int idxHead = bodies.Add( body ).index;
+
+    // torso
+    body.m_position = Vec3( 0, 0, 4 ) + offset;
+    body.m_orientation = Quat( 0, 0, 0, 1 );
+    body.m_shape = new ShapeBox( g_boxBody, sizeof( g_boxBody ) / sizeof( Vec3 ) );
+    body.m_invMass = 0.5f;
+    body.m_elasticity = 1.0f;
+    body.m_friction = 1.0f;
+    const int idxTorso = bodies.Add( body ).index;
+
+    // left arm
+    body.m_position = Vec3( 0.0f, 2.0f, 4.75f ) + offset;
+    body.m_orientation = Quat( Vec3( 0, 0, 1 ), -3.1415f / 2.0f );
+    body.m_shape = new ShapeBox( g_boxLimb, sizeof( g_boxLimb ) / sizeof( Vec3 ) );
+    body.m_invMass = 1.0f;
+    body.m_elasticity = 1.0f;
+    body.m_friction = 1.0f;
+    const int idxArmLeft = bodies.Add( body ).index;
+
+    // right arm
+    body.m_position = Vec3( 0.0f, -2.0f, 4.75f ) + offset;
+    body.m_orientation = Quat( Vec3( 0, 0, 1 ), 3.1415f / 2.0f );
+    body.m_shape = new ShapeBox( g_boxLimb, sizeof( g_boxLimb ) / sizeof( Vec3 ) );
+    body.m_invMass = 1.0f;
+    body.m_elasticity = 1.0f;
+    body.m_friction = 1.0f;
+    const int idxArmRight = bodies.Add( body ).index;
+
+    // left leg
+    body.m_position = Vec3( 0.0f, 1.0f, 2.5f ) + offset;
+    body.m_orientation = Quat( Vec3( 0, 1, 0 ), 3.1415f / 2.0f );
+    body.m_shape = new ShapeBox( g_boxLimb, sizeof( g_boxLimb ) / sizeof( Vec3 ) );
+    body.m_invMass = 1.0f;
+    body.m_elasticity = 1.0f;
+    body.m_friction = 1.0f;
+    const int idxLegLeft = bodies.Add( body ).index;
+
+    // right leg
+    body.m_position = Vec3( 0.0f, -1.0f, 2.5f ) + offset;
+    body.m_orientation = Quat( Vec3( 0, 1, 0 ), 3.1415f / 2.0f );
+    body.m_shape = new ShapeBox( g_boxLimb, sizeof( g_boxLimb ) / sizeof( Vec3 ) );
+    body.m_invMass = 1.0f;
+    body.m_elasticity = 1.0f;
+    body.m_friction = 1.0f;
+    const int idxLegRight = bodies.Add( body ).index;
+
+    // Neck
     {
-        Vec3 offset = Vec3( -5, 0, 0 );
+        ConstraintHingeQuatLimited * joint = new ConstraintHingeQuatLimited();
+        joint->m_bodyA = &bodies[ idxHead ];
+        joint->m_bodyB = &bodies[ idxTorso ];
 
-        // head
-        body.m_position = Vec3( 0, 0, 5.5f ) + offset;
-        body.m_orientation = Quat( 0, 0, 0, 1 );
-        body.m_shape = new ShapeBox( g_boxSmall, sizeof( g_boxSmall ) / sizeof( Vec3 ) );
-        body.m_invMass = 2.0f;
-        body.m_elasticity = 1.0f;
-        body.m_friction = 1.0f;
-        m_bodies.push_back( body );
+        const Vec3 jointWorldSpaceAnchor	= joint->m_bodyA->m_position + Vec3( 0, 0, -0.5f );
+        joint->m_anchorA	= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+        joint->m_anchorB	= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
 
-        // torso
-        body.m_position = Vec3( 0, 0, 4 ) + offset;
-        body.m_orientation = Quat( 0, 0, 0, 1 );
-        body.m_shape = new ShapeBox( g_boxBody, sizeof( g_boxBody ) / sizeof( Vec3 ) );
-        body.m_invMass = 0.5f;
-        body.m_elasticity = 1.0f;
-        body.m_friction = 1.0f;
-        m_bodies.push_back( body );
+        joint->m_axisA = joint->m_bodyA->m_orientation.Inverse().RotatePoint( Vec3( 0, 1, 0 ) );
 
-        // left arm
-        body.m_position = Vec3( 0.0f, 2.0f, 4.75f ) + offset;
-        body.m_orientation = Quat( Vec3( 0, 0, 1 ), -3.1415f / 2.0f );
-        body.m_shape = new ShapeBox( g_boxLimb, sizeof( g_boxLimb ) / sizeof( Vec3 ) );
-        body.m_invMass = 1.0f;
-        body.m_elasticity = 1.0f;
-        body.m_friction = 1.0f;
-        m_bodies.push_back( body );
+        // Set the initial relative orientation
+        joint->m_q0 = joint->m_bodyA->m_orientation.Inverse() * joint->m_bodyB->m_orientation;
 
-        // right arm
-        body.m_position = Vec3( 0.0f, -2.0f, 4.75f ) + offset;
-        body.m_orientation = Quat( Vec3( 0, 0, 1 ), 3.1415f / 2.0f );
-        body.m_shape = new ShapeBox( g_boxLimb, sizeof( g_boxLimb ) / sizeof( Vec3 ) );
-        body.m_invMass = 1.0f;
-        body.m_elasticity = 1.0f;
-        body.m_friction = 1.0f;
-        m_bodies.push_back( body );
+        constraints.push_back( joint );
+    }
 
-        // left leg
-        body.m_position = Vec3( 0.0f, 1.0f, 2.5f ) + offset;
-        body.m_orientation = Quat( Vec3( 0, 1, 0 ), 3.1415f / 2.0f );
-        body.m_shape = new ShapeBox( g_boxLimb, sizeof( g_boxLimb ) / sizeof( Vec3 ) );
-        body.m_invMass = 1.0f;
-        body.m_elasticity = 1.0f;
-        body.m_friction = 1.0f;
-        m_bodies.push_back( body );
+    // Shoulder Left
+    {
+        ConstraintConstantVelocityLimited * joint = new ConstraintConstantVelocityLimited();
+        joint->m_bodyB = &bodies[ idxArmLeft ];
+        joint->m_bodyA = &bodies[ idxTorso ];
 
-        // right leg
-        body.m_position = Vec3( 0.0f, -1.0f, 2.5f ) + offset;
-        body.m_orientation = Quat( Vec3( 0, 1, 0 ), 3.1415f / 2.0f );
-        body.m_shape = new ShapeBox( g_boxLimb, sizeof( g_boxLimb ) / sizeof( Vec3 ) );
-        body.m_invMass = 1.0f;
-        body.m_elasticity = 1.0f;
-        body.m_friction = 1.0f;
-        m_bodies.push_back( body );
+        const Vec3 jointWorldSpaceAnchor	= joint->m_bodyB->m_position + Vec3( 0, -1.0f, 0.0f );
+        joint->m_anchorA	= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+        joint->m_anchorB	= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
 
-        const int idxHead = 0;
-        const int idxTorso = 1;
-        const int idxArmLeft = 2;
-        const int idxArmRight = 3;
-        const int idxLegLeft = 4;
-        const int idxLegRight = 5;
+        joint->m_axisA = joint->m_bodyA->m_orientation.Inverse().RotatePoint( Vec3( 0, 1, 0 ) );
 
-        // Neck
-        {
-            ConstraintHingeQuatLimited * joint = new ConstraintHingeQuatLimited();
-            joint->m_bodyA = &m_bodies[ idxHead ];
-            joint->m_bodyB = &m_bodies[ idxTorso ];
+        // Set the initial relative orientation
+        joint->m_q0 = joint->m_bodyA->m_orientation.Inverse() * joint->m_bodyB->m_orientation;
 
-            const Vec3 jointWorldSpaceAnchor	= joint->m_bodyA->m_position + Vec3( 0, 0, -0.5f );
-            joint->m_anchorA	= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
-            joint->m_anchorB	= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+        constraints.push_back( joint );
+    }
 
-            joint->m_axisA = joint->m_bodyA->m_orientation.Inverse().RotatePoint( Vec3( 0, 1, 0 ) );
+    // Shoulder Right
+    {
+        ConstraintConstantVelocityLimited * joint = new ConstraintConstantVelocityLimited();
+        joint->m_bodyB = &bodies[ idxArmRight ];
+        joint->m_bodyA = &bodies[ idxTorso ];
 
-            // Set the initial relative orientation
-            joint->m_q0 = joint->m_bodyA->m_orientation.Inverse() * joint->m_bodyB->m_orientation;
+        const Vec3 jointWorldSpaceAnchor	= joint->m_bodyB->m_position + Vec3( 0, 1.0f, 0.0f );
+        joint->m_anchorA	= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+        joint->m_anchorB	= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
 
-            m_constraints.push_back( joint );
-        }
+        joint->m_axisA = joint->m_bodyA->m_orientation.Inverse().RotatePoint( Vec3( 0, -1, 0 ) );
 
-        // Shoulder Left
-        {
-            ConstraintConstantVelocityLimited * joint = new ConstraintConstantVelocityLimited();
-            joint->m_bodyB = &m_bodies[ idxArmLeft ];
-            joint->m_bodyA = &m_bodies[ idxTorso ];
+        // Set the initial relative orientation
+        joint->m_q0 = joint->m_bodyA->m_orientation.Inverse() * joint->m_bodyB->m_orientation;
 
-            const Vec3 jointWorldSpaceAnchor	= joint->m_bodyB->m_position + Vec3( 0, -1.0f, 0.0f );
-            joint->m_anchorA	= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
-            joint->m_anchorB	= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+        constraints.push_back( joint );
+    }
 
-            joint->m_axisA = joint->m_bodyA->m_orientation.Inverse().RotatePoint( Vec3( 0, 1, 0 ) );
+    // Hip Left
+    {
+        ConstraintHingeQuatLimited * joint = new ConstraintHingeQuatLimited();
+        joint->m_bodyB = &bodies[ idxLegLeft ];
+        joint->m_bodyA = &bodies[ idxTorso ];
 
-            // Set the initial relative orientation
-            joint->m_q0 = joint->m_bodyA->m_orientation.Inverse() * joint->m_bodyB->m_orientation;
+        const Vec3 jointWorldSpaceAnchor	= joint->m_bodyB->m_position + Vec3( 0, 0, 0.5f );
+        joint->m_anchorA	= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+        joint->m_anchorB	= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
 
-            m_constraints.push_back( joint );
-        }
+        joint->m_axisA = joint->m_bodyA->m_orientation.Inverse().RotatePoint( Vec3( 0, 1, 0 ) );
 
-        // Shoulder Right
-        {
-            ConstraintConstantVelocityLimited * joint = new ConstraintConstantVelocityLimited();
-            joint->m_bodyB = &m_bodies[ idxArmRight ];
-            joint->m_bodyA = &m_bodies[ idxTorso ];
+        // Set the initial relative orientation
+        joint->m_q0 = joint->m_bodyA->m_orientation.Inverse() * joint->m_bodyB->m_orientation;
 
-            const Vec3 jointWorldSpaceAnchor	= joint->m_bodyB->m_position + Vec3( 0, 1.0f, 0.0f );
-            joint->m_anchorA	= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
-            joint->m_anchorB	= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+        constraints.push_back( joint );
+    }
 
-            joint->m_axisA = joint->m_bodyA->m_orientation.Inverse().RotatePoint( Vec3( 0, -1, 0 ) );
+    // Hip Right
+    {
+        ConstraintHingeQuatLimited * joint = new ConstraintHingeQuatLimited();
+        joint->m_bodyB = &bodies[ idxLegRight ];
+        joint->m_bodyA = &bodies[ idxTorso ];
 
-            // Set the initial relative orientation
-            joint->m_q0 = joint->m_bodyA->m_orientation.Inverse() * joint->m_bodyB->m_orientation;
+        const Vec3 jointWorldSpaceAnchor	= joint->m_bodyB->m_position + Vec3( 0, 0, 0.5f );
+        joint->m_anchorA	= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+        joint->m_anchorB	= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
 
-            m_constraints.push_back( joint );
-        }
+        joint->m_axisA = joint->m_bodyA->m_orientation.Inverse().RotatePoint( Vec3( 0, 1, 0 ) );
 
-        // Hip Left
-        {
-            ConstraintHingeQuatLimited * joint = new ConstraintHingeQuatLimited();
-            joint->m_bodyB = &m_bodies[ idxLegLeft ];
-            joint->m_bodyA = &m_bodies[ idxTorso ];
+        // Set the initial relative orientation
+        joint->m_q0 = joint->m_bodyA->m_orientation.Inverse() * joint->m_bodyB->m_orientation;
 
-            const Vec3 jointWorldSpaceAnchor	= joint->m_bodyB->m_position + Vec3( 0, 0, 0.5f );
-            joint->m_anchorA	= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
-            joint->m_anchorB	= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+        constraints.push_back( joint );
+    }
+}
 
-            joint->m_axisA = joint->m_bodyA->m_orientation.Inverse().RotatePoint( Vec3( 0, 1, 0 ) );
+/*
+====================================================
+AddDistanceJoint
 
-            // Set the initial relative orientation
-            joint->m_q0 = joint->m_bodyA->m_orientation.Inverse() * joint->m_bodyB->m_orientation;
+A static box with a box hanging off it
+====================================================
+*/
+void AddDistanceJoint( BodyPool & bodies, std::vector< Constraint * > & constraints, const Vec3 & pos ) {
+    Body body;
+    body.m_friction = 1.0f;
 
-            m_constraints.push_back( joint );
-        }
+    body.m_position = pos;
+    body.m_orientation = Quat(0, 0, 0, 1);
+    body.m_shape = new ShapeBox(g_boxSmall, sizeof(g_boxSmall)/sizeof(Vec3));
+    body.m_invMass = 0.0f;
+    body.m_elasticity = 1.0f;
+    Body* bodyA = bodies.Get(bodies.Add(body));
 
-        // Hip Right
-        {
-            ConstraintHingeQuatLimited * joint = new ConstraintHingeQuatLimited();
-            joint->m_bodyB = &m_bodies[ idxLegRight ];
-            joint->m_bodyA = &m_bodies[ idxTorso ];
+    body.m_position = pos + Vec3(1, 0, 0);
+    body.m_orientation = Quat(0, 0, 0, 1);
+    body.m_shape = new ShapeBox(g_boxSmall, sizeof(g_boxSmall)/sizeof(Vec3));
+    body.m_invMass = 1.0f;
+    body.m_elasticity = 1.0f;
+    Body* bodyB = bodies.Get(bodies.Add(body));
 
-            const Vec3 jointWorldSpaceAnchor	= joint->m_bodyB->m_position + Vec3( 0, 0, 0.5f );
-            joint->m_anchorA	= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
-            joint->m_anchorB	= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+    const Vec3 jointWorldSpaceAnchor = bodyA->m_position;
 
-            joint->m_axisA = joint->m_bodyA->m_orientation.Inverse().RotatePoint( Vec3( 0, 1, 0 ) );
+    ConstraintDistance* joint = new ConstraintDistance();
 
-            // Set the initial relative orientation
-            joint->m_q0 = joint->m_bodyA->m_orientation.Inverse() * joint->m_bodyB->m_orientation;
+    joint->m_bodyA = bodyA;
+    joint->m_anchorA = joint->m_bodyA->WorldSpaceToBodySpace(jointWorldSpaceAnchor);
 
-            m_constraints.push_back( joint );
+    joint->m_bodyB = bodyB;
+    joint->m_anchorB = joint->m_bodyB->WorldSpaceToBodySpace(jointWorldSpaceAnchor);
+    constraints.push_back(joint);
+}
+
+/*
+====================================================
+AddChain
+
+A static box at pos with numJoints boxes hanging off it
+====================================================
+*/
+void AddChain( BodyPool & bodies, std::vector< Constraint * > & constraints, const Vec3 & pos, const int numJoints ) {
+    Body body;
+    body.m_friction = 1.0f;
+
+    Body * last = NULL;
+    for ( int i = 0; i < numJoints; i++ ) {
+        if ( i == 0 ) {
+            body.m_position = pos;
+            body.m_orientation = Quat( 0, 0, 0, 1 );
+            body.m_shape = new ShapeBox( g_boxSmall, sizeof( g_boxSmall ) / sizeof( Vec3 ) );
+            body.m_invMass = 0.0f;
+            body.m_elasticity = 1.0f;
+            last = bodies.Get( bodies.Add( body ) );
+        } else {
+            body.m_invMass = 1.0f;
         }
-    }
 
-    //
-    // Build a joint
-    //
-    if (true)
-    {
-        body.m_position = Vec3(0, -10, 5);
-        body.m_orientation = Quat(0, 0, 0, 1);
-        body.m_shape = new ShapeBox(g_boxSmall, sizeof(g_boxSmall)/sizeof(Vec3));
-        body.m_invMass = 0.0f;
-        body.m_elasticity = 1.0f;
-        m_bodies.push_back(body);
-        Body* bodyA = &m_bodies[m_bodies.size() - 1];
+        body.m_linearVelocity = Vec3( 0, 0, 0 );
+
+        Body * bodyA = last;
+        const Vec3 jointWorldSpaceAnchor	= bodyA->m_position;
+
+        ConstraintDistance * joint = new ConstraintDistance();
 
-        body.m_position = Vec3(1, -10, 5);
-        body.m_orientation = Quat(0, 0, 0, 1);
-        body.m_shape = new ShapeBox(g_boxSmall, sizeof(g_boxSmall)/sizeof(Vec3));
+        joint->m_bodyA			= bodyA;
+        joint->m_anchorA		= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+
+        body.m_position = joint->m_bodyA->m_position + Vec3( 1, 0, 0 );
+        body.m_orientation = Quat( 0, 0, 0, 1 );
+        body.m_shape = new ShapeBox( g_boxSmall, sizeof( g_boxSmall ) / sizeof( Vec3 ) );
         body.m_invMass = 1.0f;
         body.m_elasticity = 1.0f;
-        m_bodies.push_back(body);
-        Body* bodyB = &m_bodies[m_bodies.size() - 1];
+        last = bodies.Get( bodies.Add( body ) );
 
-        const Vec3 jointWorldSpaceAnchor = bodyA->m_position;
+        joint->m_bodyB			= last;
+        joint->m_anchorB		= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
 
-        ConstraintDistance* joint = new ConstraintDistance();
+        constraints.push_back( joint );
+    }
+}
 
-        joint->m_bodyA = bodyA;
-        joint->m_anchorA = joint->m_bodyA->WorldSpaceToBodySpace(jointWorldSpaceAnchor);
+/*
+====================================================
+AddBoxStack
 
-        joint->m_bodyB = bodyB;
-        joint->m_anchorB = joint->m_bodyB->WorldSpaceToBodySpace(jointWorldSpaceAnchor);
-        m_constraints.push_back(joint);
-    }
+A grid of numX by numY stacks of stackHeight boxes
+====================================================
+*/
+void AddBoxStack( BodyPool & bodies, const Vec3 & pos, const int numX, const int numY, const int stackHeight ) {
+    Body body;
 
-    //
-    // Build a chain for funsies
-    //
-    if (true)
-    {
-        const int numJoints = 5;
-        for ( int i = 0; i < numJoints; i++ ) {
-            if ( i == 0 ) {
-                body.m_position = Vec3( 0.0f, 15.0f, (float)numJoints + 3.0f );
+    for ( int x = 0; x < numX; x++ ) {
+        for ( int y = 0; y < numY; y++ ) {
+            for ( int z = 0; z < stackHeight; z++ ) {
+                float offset = ( ( z & 1 ) == 0 ) ? 0.0f : 0.15f;
+                float xx = (float)x + offset;
+                float yy = (float)y + offset;
+                float delta = 0.04f;
+                float scaleHeight = 2.0f + delta;
+                float deltaHeight = 1.0f + delta;
+                body.m_position = pos + Vec3( (float)xx * scaleHeight, (float)yy * scaleHeight, deltaHeight + (float)z * scaleHeight );
                 body.m_orientation = Quat( 0, 0, 0, 1 );
-                body.m_shape = new ShapeBox( g_boxSmall, sizeof( g_boxSmall ) / sizeof( Vec3 ) );
-                body.m_invMass = 0.0f;
-                body.m_elasticity = 1.0f;
-                m_bodies.push_back( body );
-            } else {
+                body.m_shape = new ShapeBox( g_boxUnit, sizeof( g_boxUnit ) / sizeof( Vec3 ) );
                 body.m_invMass = 1.0f;
+                body.m_elasticity = 0.5f;
+                body.m_friction = 0.5f;
+                bodies.Add( body );
             }
+        }
+    }
+}
 
-            body.m_linearVelocity = Vec3( 0, 0, 0 );
+/*
+====================================================
+AddMotor
+====================================================
+*/
+void AddMotor( BodyPool & bodies, std::vector< Constraint * > & constraints, const Vec3 & motorPos ) {
+    Body body;
 
-            Body * bodyA = &m_bodies[ m_bodies.size() - 1 ];
-            const Vec3 jointWorldSpaceAnchor	= bodyA->m_position;
+    Vec3 motorAxis = Vec3( 0, 0, 1 ).Normalize();
+    Quat motorOrient = Quat( 1, 0, 0, 0 );
 
-            ConstraintDistance * joint = new ConstraintDistance();
+    body.m_position = motorPos;
+    body.m_linearVelocity = Vec3( 0.0f, 0.0f, 0.0f );
+    body.m_orientation = Quat( 0, 0, 0, 1 );
+    body.m_shape = new ShapeBox( g_boxSmall, sizeof( g_boxSmall ) / sizeof( Vec3 ) );
+    body.m_invMass = 0.0f;
+    body.m_elasticity = 0.9f;
+    body.m_friction = 0.5f;
+    Body * bodyA = bodies.Get( bodies.Add( body ) );
+
+    body.m_position = motorPos - motorAxis;
+    body.m_linearVelocity = Vec3( 0.0f, 0.0f, 0.0f );
+    body.m_orientation = motorOrient;
+    body.m_shape = new ShapeBox( g_boxBeam, sizeof( g_boxBeam ) / sizeof( Vec3 ) );
+    body.m_invMass = 0.01f;
+    body.m_elasticity = 1.0f;
+    body.m_friction = 0.5f;
+    Body * bodyB = bodies.Get( bodies.Add( body ) );
+    {
+        ConstraintMotor * joint = new ConstraintMotor();
+        joint->m_bodyA = bodyA;
+        joint->m_bodyB = bodyB;
 
-            joint->m_bodyA			= &m_bodies[ m_bodies.size() - 1 ];
-            joint->m_anchorA		= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+        const Vec3 jointWorldSpaceAnchor	= joint->m_bodyA->m_position;
+        joint->m_anchorA	= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+        joint->m_anchorB	= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
 
-            body.m_position = joint->m_bodyA->m_position + Vec3( 1, 0, 0 );
-            body.m_orientation = Quat( 0, 0, 0, 1 );
-            body.m_shape = new ShapeBox( g_boxSmall, sizeof( g_boxSmall ) / sizeof( Vec3 ) );
-            body.m_invMass = 1.0f;
-            body.m_elasticity = 1.0f;
-            m_bodies.push_back( body );
+        joint->m_motorSpeed = 2.0f;
+        joint->m_motorAxis	= joint->m_bodyA->m_orientation.Inverse().RotatePoint( motorAxis );
 
-            joint->m_bodyB			= &m_bodies[ m_bodies.size() - 1 ];
-            joint->m_anchorB		= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+        // Set the initial relative orientation (in bodyA's space)
+        joint->m_q0 = joint->m_bodyA->m_orientation.Inverse() * joint->m_bodyB->m_orientation;
 
-            m_constraints.push_back( joint );
-        }
+        constraints.push_back( joint );
     }
+}
 
-    //
-    //	Stack of Boxes
-    //
-    if (true)
+/*
+====================================================
+AddMover
+
+A kinematic platform with a box resting on it
+====================================================
+*/
+void AddMover( BodyPool & bodies, std::vector< Constraint * > & constraints, const Vec3 & pos ) {
+    Body body;
+
+    body.m_position = pos;
+    body.m_linearVelocity = Vec3( 0, 0, 0 );
+    body.m_orientation = Quat( 0, 0, 0, 1 );
+    body.m_shape = new ShapeBox( g_boxPlatform, sizeof( g_boxPlatform ) / sizeof( Vec3 ) );
+    body.m_invMass = 0.0f;
+    body.m_elasticity = 0.1f;
+    body.m_friction = 0.9f;
+    body.m_isKinematic = true;
+    Body * platform = bodies.Get( bodies.Add( body ) );
+    body.m_isKinematic = false;
     {
-        const int stackHeight = 5;
-        for ( int x = 0; x < 1; x++ ) {
-            for ( int y = 0; y < 1; y++ ) {
-                for ( int z = 0; z < stackHeight; z++ ) {
-                    float offset = ( ( z & 1 ) == 0 ) ? 0.0f : 0.15f;
-                    float xx = (float)x + offset;
-                    float yy = (float)y + offset;
-                    float delta = 0.04f;
-                    float scaleHeight = 2.0f + delta;
-                    float deltaHeight = 1.0f + delta;
-                    body.m_position = Vec3( (float)xx * scaleHeight, (float)yy * scaleHeight, deltaHeight + (float)z * scaleHeight );
-                    body.m_orientation = Quat( 0, 0, 0, 1 );
-                    body.m_shape = new ShapeBox( g_boxUnit, sizeof( g_boxUnit ) / sizeof( Vec3 ) );
-                    body.m_invMass = 1.0f;
-                    body.m_elasticity = 0.5f;
-                    body.m_friction = 0.5f;
-                    m_bodies.push_back( body );
+        ConstraintMoverSimple * mover = new ConstraintMoverSimple();
+        mover->m_bodyA = platform;
+
+        constraints.push_back( mover );
+    }
+
+    body.m_position = pos + Vec3( 0, 0, 1.3f );
+    body.m_linearVelocity = Vec3( 0, 0, 0 );
+    body.m_orientation = Quat( 0, 0, 0, 1 );
+    body.m_shape = new ShapeBox( g_boxUnit, sizeof( g_boxUnit ) / sizeof( Vec3 ) );
+    body.m_invMass = 1.0f;
+    body.m_elasticity = 0.1f;
+    body.m_friction = 0.9f;
+    bodies.Add( body );
+}
+
+/*
+====================================================
+AddShapePile
+
+A grid of numX by numY columns of height bodies, cycling through
+spheres, boxes and diamond hulls
+====================================================
+*/
+void AddShapePile( BodyPool & bodies, const Vec3 & pos, const int numX, const int numY, const int height ) {
+    // Building a hull integrates its mass properties, which takes far longer than copying one
+    const ShapeConvex diamond( g_diamond, sizeof( g_diamond ) / sizeof( Vec3 ) );
+
+    Body body;
+    body.m_orientation = Quat( 0, 0, 0, 1 );
+    body.m_invMass = 1.0f;
+    body.m_elasticity = 0.5f;
+    body.m_friction = 0.5f;
+
+    int idx = 0;
+    for ( int z = 0; z < height; z++ ) {
+        for ( int y = 0; y < numY; y++ ) {
+            for ( int x = 0; x < numX; x++ ) {
+                body.m_position = pos + Vec3( (float)x * 2.5f, (float)y * 2.5f, 2.0f + (float)z * 2.5f );
+                switch ( idx % 3 ) {
+                    case 0: body.m_shape = new ShapeSphere( 1.0f ); break;
+                    case 1: body.m_shape = new ShapeBox( g_boxUnit, sizeof( g_boxUnit ) / sizeof( Vec3 ) ); break;
+                    default: body.m_shape = new ShapeConvex( diamond ); break;
                 }
+                bodies.Add( body );
+                idx++;
             }
         }
     }
+}
 
+/*
+====================================================
+AddMeshGround
 
+A flat triangle mesh of numX by numY vertices, spacing apart, with its
+first vertex at pos.  The triangles face up.
+====================================================
+*/
+void AddMeshGround( BodyPool & bodies, const Vec3 & pos, const int numX, const int numY, const float spacing ) {
+    std::vector< Vec3 > verts;
+    verts.reserve( numX * numY );
+    for ( int y = 0; y < numY; y++ ) {
+        for ( int x = 0; x < numX; x++ ) {
+            verts.push_back( Vec3( (float)x * spacing, (float)y * spacing, 0.0f ) );
+        }
+    }
 
-    //
-    //	Motor
-    //
-    if (true)
-    {
-        Vec3 motorPos = Vec3( 5, 0, 2 );
-        Vec3 motorAxis = Vec3( 0, 0, 1 ).Normalize();
-        Quat motorOrient = Quat( 1, 0, 0, 0 );
+    std::vector< int > indices;
+    indices.reserve( ( numX - 1 ) * ( numY - 1 ) * 6 );
+    for ( int y = 0; y < numY - 1; y++ ) {
+        for ( int x = 0; x < numX - 1; x++ ) {
+            const int a = y * numX + x;
+            const int b = a + 1;
+            const int c = a + numX + 1;
+            const int d = a + numX;
+            indices.push_back( a ); indices.push_back( b ); indices.push_back( c );
+            indices.push_back( a ); indices.push_back( c ); indices.push_back( d );
+        }
+    }
 
-        body.m_position = motorPos;
-        body.m_linearVelocity = Vec3( 0.0f, 0.0f, 0.0f );
-        body.m_orientation = Quat( 0, 0, 0, 1 );
-        body.m_shape = new ShapeBox( g_boxSmall, sizeof( g_boxSmall ) / sizeof( Vec3 ) );
-        body.m_invMass = 0.0f;
-        body.m_elasticity = 0.9f;
-        body.m_friction = 0.5f;
-        m_bodies.push_back( body );
-
-        body.m_position = motorPos - motorAxis;
-        body.m_linearVelocity = Vec3( 0.0f, 0.0f, 0.0f );
-        body.m_orientation = motorOrient;
-        body.m_shape = new ShapeBox( g_boxBeam, sizeof( g_boxBeam ) / sizeof( Vec3 ) );
-        body.m_invMass = 0.01f;
-        body.m_elasticity = 1.0f;
-        body.m_friction = 0.5f;
-        m_bodies.push_back( body );
-        {
-            ConstraintMotor * joint = new ConstraintMotor();
-            joint->m_bodyA = &m_bodies[ m_bodies.size() - 2 ];
-            joint->m_bodyB = &m_bodies[ m_bodies.size() - 1 ];
+    Body body;
+    body.m_position = pos;
+    body.m_orientation = Quat( 0, 0, 0, 1 );
+    body.m_invMass = 0.0f;
+    body.m_elasticity = 0.5f;
+    body.m_friction = 0.5f;
+    body.m_shape = new ShapeTriangleMesh( verts.data(), (int)verts.size(), indices.data(), (int)indices.size() );
+    bodies.Add( body );
+}
 
-            const Vec3 jointWorldSpaceAnchor	= joint->m_bodyA->m_position;
-            joint->m_anchorA	= joint->m_bodyA->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
-            joint->m_anchorB	= joint->m_bodyB->WorldSpaceToBodySpace( jointWorldSpaceAnchor );
+/*
+====================================================
+AddTerrain
 
-            joint->m_motorSpeed = 2.0f;
-            joint->m_motorAxis	= joint->m_bodyA->m_orientation.Inverse().RotatePoint( motorAxis );
+A heightfield of numX by numY samples, spacing apart, with its first
+sample at pos.  It's a shallow bowl with ripples, so whatever lands on it
+rolls towards the middle instead of off the edges.
+====================================================
+*/
+void AddTerrain( BodyPool & bodies, const Vec3 & pos, const int numX, const int numY, const float spacing ) {
+    const float centerX = 0.5f * (float)( numX - 1 ) * spacing;
+    const float centerY = 0.5f * (float)( numY - 1 ) * spacing;
+    std::vector< float > heights( numX * numY );
+    for ( int y = 0; y < numY; y++ ) {
+        for ( int x = 0; x < numX; x++ ) {
+            const float dx = (float)x * spacing - centerX;
+            const float dy = (float)y * spacing - centerY;
+            heights[ y * numX + x ] = 0.01f * ( dx * dx + dy * dy ) + 0.5f * sinf( 0.5f * dx ) * cosf( 0.5f * dy );
+        }
+    }
+
+    Body body;
+    body.m_position = pos;
+    body.m_orientation = Quat( 0, 0, 0, 1 );
+    body.m_invMass = 0.0f;
+    body.m_elasticity = 0.5f;
+    body.m_friction = 0.5f;
+    body.m_shape = new ShapeHeightfield( heights.data(), numX, numY, spacing );
+    bodies.Add( body );
+}
+
+/*
+====================================================
+NewDumbbell
 
-            // Set the initial relative orientation (in bodyA's space)
-            joint->m_q0 = joint->m_bodyA->m_orientation.Inverse() * joint->m_bodyB->m_orientation;
+Two spheres of radius 0.5 joined by a bar, 3 long down the x axis
+====================================================
+*/
+ShapeCompound * NewDumbbell() {
+    const float w = 0.15f;
+    const Vec3 bar[] = {
+        Vec3(-1,-w,-w ),
+        Vec3( 1,-w,-w ),
+        Vec3(-1, w,-w ),
+        Vec3( 1, w,-w ),
+
+        Vec3(-1,-w, w ),
+        Vec3( 1,-w, w ),
+        Vec3(-1, w, w ),
+        Vec3( 1, w, w ),
+    };
+
+    ShapeCompound::child_t children[ 3 ];
+    children[ 0 ].shape = new ShapeSphere( 0.5f );
+    children[ 0 ].position = Vec3( -1, 0, 0 );
+    children[ 0 ].mass = 1.0f;
+    children[ 1 ].shape = new ShapeSphere( 0.5f );
+    children[ 1 ].position = Vec3( 1, 0, 0 );
+    children[ 1 ].mass = 1.0f;
+    children[ 2 ].shape = new ShapeBox( bar, sizeof( bar ) / sizeof( Vec3 ) );
+    children[ 2 ].position = Vec3( 0, 0, 0 );
+    children[ 2 ].mass = 0.25f;
+    for ( int i = 0; i < 3; i++ ) {
+        children[ i ].orientation = Quat( 0, 0, 0, 1 );
+    }
+    return new ShapeCompound( children, 3 );
+}
+
+/*
+====================================================
+AddDumbbellPile
+
+A grid of numX by numY columns of height dumbbells.  Every other layer
+is turned a quarter around z, so the layers land across each other.
+====================================================
+*/
+void AddDumbbellPile( BodyPool & bodies, const Vec3 & pos, const int numX, const int numY, const int height ) {
+    Body body;
+    body.m_invMass = 1.0f;
+    body.m_elasticity = 0.5f;
+    body.m_friction = 0.5f;
 
-            m_constraints.push_back( joint );
+    for ( int z = 0; z < height; z++ ) {
+        body.m_orientation = ( z & 1 ) ? Quat( Vec3( 0, 0, 1 ), 3.1415f / 2.0f ) : Quat( 0, 0, 0, 1 );
+        for ( int y = 0; y < numY; y++ ) {
+            for ( int x = 0; x < numX; x++ ) {
+                body.m_position = pos + Vec3( (float)x * 3.5f, (float)y * 3.5f, 1.0f + (float)z * 1.5f );
+                body.m_shape = NewDumbbell();
+                bodies.Add( body );
+            }
         }
     }
+}
 
-    //
-    //	Mover
-    //
-    if (true)
-    {
-        body.m_position = Vec3( 10, 0, 5 );
-        body.m_linearVelocity = Vec3( 0, 0, 0 );
-        body.m_orientation = Quat( 0, 0, 0, 1 );
-        body.m_shape = new ShapeBox( g_boxPlatform, sizeof( g_boxPlatform ) / sizeof( Vec3 ) );
-        body.m_invMass = 0.0f;
-        body.m_elasticity = 0.1f;
-        body.m_friction = 0.9f;
-        m_bodies.push_back( body );
-        {
-            ConstraintMoverSimple * mover = new ConstraintMoverSimple();
-            mover->m_bodyA = &m_bodies[ m_bodies.size() - 1 ];
+/*
+====================================================
+Scene presets
+
+Each preset builds a complete world.  Bodies never move in the pool,
+maxBodies only reserves room for them up front.
+====================================================
+*/
+struct scenePreset_t {
+    const char * name;
+    int maxBodies;
+    void ( *build )( BodyPool & bodies, std::vector< Constraint * > & constraints );
+};
+
+static void BuildPresetDefault( BodyPool & bodies, std::vector< Constraint * > & constraints ) {
+    AddRagdoll( bodies, constraints, Vec3( -5, 0, 0 ) );
+    AddDistanceJoint( bodies, constraints, Vec3( 0, -10, 5 ) );
+    AddChain( bodies, constraints, Vec3( 0.0f, 15.0f, 5.0f + 3.0f ), 5 );
+    AddBoxStack( bodies, Vec3( 0, 0, 0 ), 1, 1, 5 );
+    AddMotor( bodies, constraints, Vec3( 5, 0, 2 ) );
+    AddMover( bodies, constraints, Vec3( 10, 0, 5 ) );
+    AddStandardSandBox( bodies );
+}
+
+static void BuildPresetRagdoll( BodyPool & bodies, std::vector< Constraint * > & constraints ) {
+    AddRagdoll( bodies, constraints, Vec3( 0, 0, 0 ) );
+    AddStandardSandBox( bodies );
+}
+
+static void BuildPresetChain( BodyPool & bodies, std::vector< Constraint * > & constraints ) {
+    AddChain( bodies, constraints, Vec3( 0, 0, 8 ), 5 );
+    AddStandardSandBox( bodies );
+}
+
+static void BuildPresetStack( BodyPool & bodies, std::vector< Constraint * > & constraints ) {
+    AddBoxStack( bodies, Vec3( 0, 0, 0 ), 1, 1, 5 );
+    AddStandardSandBox( bodies );
+}
+
+static void BuildPresetMover( BodyPool & bodies, std::vector< Constraint * > & constraints ) {
+    AddMover( bodies, constraints, Vec3( 0, 0, 5 ) );
+    AddStandardSandBox( bodies );
+}
+
+static void BuildPresetPile1k( BodyPool & bodies, std::vector< Constraint * > & constraints ) {
+    AddBoxStack( bodies, Vec3( -10, -10, 0 ), 10, 10, 10 );
+    AddStandardSandBox( bodies );
+}
+
+static void BuildPresetPile10k( BodyPool & bodies, std::vector< Constraint * > & constraints ) {
+    AddBoxStack( bodies, Vec3( -20, -20, 0 ), 20, 20, 25 );
+    AddStandardSandBox( bodies );
+}
 
-            m_constraints.push_back( mover );
+// Long chains hang in open space, so the links only ever touch each other
+static void BuildPresetChain100( BodyPool & bodies, std::vector< Constraint * > & constraints ) {
+    AddChain( bodies, constraints, Vec3( 0, 0, 0 ), 100 );
+}
+
+static void BuildPresetChain1000( BodyPool & bodies, std::vector< Constraint * > & constraints ) {
+    AddChain( bodies, constraints, Vec3( 0, 0, 0 ), 1000 );
+}
+
+// The same pile on a box, on a million triangle mesh of the same size, and on a heightfield
+static void BuildPresetShapes( BodyPool & bodies, std::vector< Constraint * > & constraints ) {
+    AddShapePile( bodies, Vec3( -10, -10, 0 ), 8, 8, 4 );
+    AddStandardSandBox( bodies );
+}
+
+static void BuildPresetMesh( BodyPool & bodies, std::vector< Constraint * > & constraints ) {
+    AddShapePile( bodies, Vec3( -10, -10, 0 ), 8, 8, 4 );
+    AddMeshGround( bodies, Vec3( -500, -250, 0 ), 1001, 501, 1.0f );
+}
+
+static void BuildPresetTerrain( BodyPool & bodies, std::vector< Constraint * > & constraints ) {
+    AddShapePile( bodies, Vec3( -10, -10, 8 ), 8, 8, 4 );
+    AddTerrain( bodies, Vec3( -32, -32, 0 ), 129, 129, 0.5f );
+}
+
+static void BuildPresetCompound( BodyPool & bodies, std::vector< Constraint * > & constraints ) {
+    AddDumbbellPile( bodies, Vec3( -10, -10, 0 ), 6, 6, 6 );
+    AddStandardSandBox( bodies );
+}
+
+static const scenePreset_t s_presets[] = {
+    { "default",	128,	BuildPresetDefault },
+    { "ragdoll",	128,	BuildPresetRagdoll },
+    { "chain",		128,	BuildPresetChain },
+    { "stack",		128,	BuildPresetStack },
+    { "mover",		128,	BuildPresetMover },
+    { "pile_1k",	1024 + 128,	BuildPresetPile1k },
+    { "pile_10k",	10000 + 128,	BuildPresetPile10k },
+    { "chain_100",	128,	BuildPresetChain100 },
+    { "chain_1000",	1024 + 128,	BuildPresetChain1000 },
+    { "shapes",		256 + 128,	BuildPresetShapes },
+    { "mesh",		256 + 128,	BuildPresetMesh },
+    { "terrain",	256 + 128,	BuildPresetTerrain },
+    { "compound",	256 + 128,	BuildPresetCompound },
+};
+static const int s_numPresets = sizeof( s_presets ) / sizeof( s_presets[ 0 ] );
+
+/*
+====================================================
+Scene::GetNumPresets
+====================================================
+*/
+int Scene::GetNumPresets() {
+    return s_numPresets;
+}
+
+/*
+====================================================
+Scene::GetPresetName
+====================================================
+*/
+const char * Scene::GetPresetName( const int idx ) {
+    return s_presets[ idx ].name;
+}
+
+/*
+====================================================
+Scene::SetPreset
+
+Selects the world that Initialize builds, returns false for unknown names
+====================================================
+*/
+bool Scene::SetPreset( const char * name ) {
+    for ( int i = 0; i < s_numPresets; i++ ) {
+        if ( 0 == strcmp( s_presets[ i ].name, name ) ) {
+            m_preset = i;
+            return true;
         }
+    }
+    return false;
+}
 
-        body.m_position = Vec3( 10, 0, 6.3f );
-        body.m_linearVelocity = Vec3( 0, 0, 0 );
-        body.m_orientation = Quat( 0, 0, 0, 1 );
-        body.m_shape = new ShapeBox( g_boxUnit, sizeof( g_boxUnit ) / sizeof( Vec3 ) );
-        body.m_invMass = 1.0f;
-        body.m_elasticity = 0.1f;
-        body.m_friction = 0.9f;
-        m_bodies.push_back( body );
+/*
+====================================================
+Scene::Initialize
+====================================================
+*/
+void Scene::Initialize() {
+    const scenePreset_t & preset = s_presets[ m_preset ];
+    m_bodies.reserve( m_bodies.size() + preset.maxBodies );
+    preset.build( m_bodies, m_constraints );
+}
+
+/*
+====================================================
+Scene::BuildBroadPhase
+
+Rebuilds the static tree and the pairs that the broadphase filters out
+====================================================
+*/
+void Scene::BuildBroadPhase() {
+    m_broadPhase.Build( m_bodies );
+    BuildIgnoredPairs();
+}
+
+/*
+====================================================
+Scene::BuildIgnoredPairs
+
+Bodies directly connected by a joint don't collide with each other
+====================================================
+*/
+void Scene::BuildIgnoredPairs() {
+    m_broadPhase.ClearIgnoredPairs();
+    for ( int i = 0; i < m_constraints.size(); i++ ) {
+        const Constraint * constraint = m_constraints[ i ];
+        if ( constraint->m_collideConnected || NULL == constraint->m_bodyA || NULL == constraint->m_bodyB ) {
+            continue;
+        }
+
+        const int a = m_bodies.IndexOf( constraint->m_bodyA );
+        const int b = m_bodies.IndexOf( constraint->m_bodyB );
+        m_broadPhase.AddIgnoredPair( a, b );
     }
+}
 
+/*
+====================================================
+Scene::AddBody
+====================================================
+*/
+bodyHandle_t Scene::AddBody( const Body & body ) {
+    const bodyHandle_t handle = m_bodies.Add( body );
+    m_broadPhase.AddBody( m_bodies, handle.index );
+    m_query.Invalidate();
+    return handle;
+}
 
+/*
+====================================================
+Scene::RemoveBody
 
-    //
-    //	Standard floor and walls
-    //
-    AddStandardSandBox( m_bodies );
+The body stops simulating right away, stale handles are ignored
+====================================================
+*/
+void Scene::RemoveBody( const bodyHandle_t & handle ) {
+    if ( NULL == m_bodies.Get( handle ) ) {
+        return;
+    }
+    m_broadPhase.RemoveBody( m_bodies, handle.index );
+    m_bodies.Remove( handle.index );
+    m_query.Invalidate();
 }
 
 /*
 ====================================================
-CompareContacts
+Scene::FlushRemovedBodies
+
+Drops everything that still points at the bodies removed since the last
+update, then lets the pool reuse their slots.  Done once per update, so
+removing many bodies costs one pass over the manifolds and constraints.
+====================================================
+*/
+void Scene::FlushRemovedBodies() {
+    const std::vector< int > & removed = m_bodies.GetRemovedSlots();
+    if ( removed.empty() ) {
+        return;
+    }
+
+    std::vector< const Body * > removedBodies( removed.size() );
+    for ( int i = 0; i < removed.size(); i++ ) {
+        removedBodies[ i ] = &m_bodies[ removed[ i ] ];
+    }
+    std::sort( removedBodies.begin(), removedBodies.end() );
+
+    m_manifolds.RemoveBodies( removedBodies.data(), (int)removedBodies.size() );
+
+    // Joints can't work without both of their bodies
+    int numConstraints = 0;
+    for ( int i = 0; i < m_constraints.size(); i++ ) {
+        Constraint * constraint = m_constraints[ i ];
+        const bool hasA = std::binary_search( removedBodies.begin(), removedBodies.end(), constraint->m_bodyA );
+        const bool hasB = std::binary_search( removedBodies.begin(), removedBodies.end(), constraint->m_bodyB );
+        if ( hasA || hasB ) {
+            delete constraint;
+            continue;
+        }
+        m_constraints[ numConstraints++ ] = constraint;
+    }
+    if ( numConstraints != (int)m_constraints.size() ) {
+        m_constraints.resize( numConstraints );
+        BuildIgnoredPairs();
+    }
+
+    for ( int i = 0; i < removed.size(); i++ ) {
+        Body & body = m_bodies[ removed[ i ] ];
+        delete body.m_shape;
+        body.m_shape = NULL;
+    }
+    m_bodies.FlushRemoved();
+}
+
+/*
+====================================================
+sceneState_t::GetNumBytes
+====================================================
+*/
+size_t sceneState_t::GetNumBytes() const {
+    size_t numBytes = sizeof( Body ) * bodies.bodies.size();
+    numBytes += sizeof( unsigned int ) * bodies.generations.size() + bodies.isAlive.size();
+    numBytes += sizeof( int ) * ( bodies.freeSlots.size() + bodies.removedSlots.size() + 1 );
+    numBytes += sizeof( manifoldState_t ) * manifolds.manifolds.size();
+    numBytes += sizeof( manifoldContactState_t ) * manifolds.contacts.size();
+    numBytes += sizeof( Constraint * ) * constraints.size() + sizeof( float ) * constraintState.size();
+    numBytes += sizeof( bodyTransform_t ) * previousTransforms.size() + sizeof( float ) * 2;
+    return numBytes;
+}
+
+/*
+====================================================
+Scene::SaveState
+====================================================
+*/
+void Scene::SaveState( sceneState_t & state ) const {
+    m_bodies.SaveState( state.bodies );
+    m_manifolds.SaveState( m_bodies, state.manifolds );
+
+    state.constraints = m_constraints;
+    int stateSize = 0;
+    for ( int i = 0; i < m_constraints.size(); i++ ) {
+        stateSize += m_constraints[ i ]->GetStateSize();
+    }
+    state.constraintState.resize( stateSize );
+    float * values = state.constraintState.data();
+    for ( int i = 0; i < m_constraints.size(); i++ ) {
+        m_constraints[ i ]->SaveState( values );
+        values += m_constraints[ i ]->GetStateSize();
+    }
+
+    state.previousTransforms = m_previousTransforms;
+    state.accumulator = m_accumulator;
+    state.droppedTime = m_droppedTime;
+}
+
+/*
+====================================================
+Scene::RestoreState
+
+Rolling back over steps that didn't add or remove anything only copies
+the state back.  Otherwise the bodies added since the save are deleted,
+and the broadphase is built again for the bodies of the save.
+====================================================
+*/
+bool Scene::RestoreState( const sceneState_t & state ) {
+    const bodyPoolState_t & saved = state.bodies;
+    const std::vector< int > & removed = m_bodies.GetRemovedSlots();
+
+    // The slots only ever grow, short of a Reset
+    if ( saved.size() > m_bodies.size() || state.constraints.size() > m_constraints.size() ) {
+        return false;
+    }
+    if ( !std::equal( state.constraints.begin(), state.constraints.end(), m_constraints.begin() ) ) {
+        return false;
+    }
+
+    if ( !m_bodies.HasSameSlots( saved ) ) {
+        // Which shapes still belong to bodies of the save, the rest were added since
+        std::vector< unsigned char > isPending( m_bodies.size(), 0 );
+        for ( int i = 0; i < removed.size(); i++ ) {
+            isPending[ removed[ i ] ] = 1;
+        }
+        std::vector< unsigned char > isKept( m_bodies.size(), 0 );
+        for ( int i = 0; i < saved.size(); i++ ) {
+            if ( !saved.IsAlive( i ) ) {
+                continue;
+            }
+            const unsigned int generation = saved.generations[ i ];
+            const bool isSame = m_bodies.IsAlive( i ) && m_bodies.GetGeneration( i ) == generation;
+            const bool isRemoving = isPending[ i ] && m_bodies.GetGeneration( i ) == generation + 1;
+            if ( !isSame && !isRemoving ) {
+                return false;	// flushed, its shape is gone
+            }
+            isKept[ i ] = 1;
+        }
+        for ( int i = 0; i < saved.removedSlots.size(); i++ ) {
+            const int idx = saved.removedSlots[ i ];
+            if ( isPending[ idx ] && m_bodies.GetGeneration( idx ) == saved.generations[ idx ] ) {
+                isKept[ idx ] = 1;
+            }
+        }
+
+        for ( int i = 0; i < m_bodies.size(); i++ ) {
+            if ( !isKept[ i ] ) {
+                delete m_bodies[ i ].m_shape;
+                m_bodies[ i ].m_shape = NULL;
+            }
+        }
+        m_bodies.RestoreState( saved );
+
+        // Removals that were pending at the save and flushed since already deleted their shapes
+        for ( int i = 0; i < saved.removedSlots.size(); i++ ) {
+            const int idx = saved.removedSlots[ i ];
+            if ( !isKept[ idx ] ) {
+                m_bodies[ idx ].m_shape = NULL;
+            }
+        }
+        m_broadPhase.Invalidate();
+    } else {
+        m_bodies.RestoreState( saved );
+    }
+
+    m_manifolds.RestoreState( m_bodies, state.manifolds );
+
+    if ( state.constraints.size() != m_constraints.size() ) {
+        for ( int i = (int)state.constraints.size(); i < m_constraints.size(); i++ ) {
+            delete m_constraints[ i ];
+        }
+        m_constraints.resize( state.constraints.size() );
+        BuildIgnoredPairs();
+    }
+    const float * values = state.constraintState.data();
+    for ( int i = 0; i < m_constraints.size(); i++ ) {
+        m_constraints[ i ]->RestoreState( values );
+        values += m_constraints[ i ]->GetStateSize();
+    }
+
+    m_previousTransforms = state.previousTransforms;
+    m_accumulator = state.accumulator;
+    m_droppedTime = state.droppedTime;
+
+    m_query.Invalidate();
+    return true;
+}
+
+/*
+====================================================
+AdvanceBody
+
+Integrates a body from its own clock up to time, bodies already past it don't move
 ====================================================
 */
-int CompareContacts( const void * p1, const void * p2 )
-{
-    contact_t a = *(contact_t*)p1;
-    contact_t b = *(contact_t*)p2;
+static void AdvanceBody( Body & body, float & localTime, const float time ) {
+    if ( time > localTime ) {
+        body.Update( time - localTime );
+        localTime = time;
+    }
+}
 
-    if (a.timeOfImpact < b.timeOfImpact)
-        return -1;
+/*
+====================================================
+CompareContacts
 
-    if (a.timeOfImpact > b.timeOfImpact)
-        return 1;
+Used with a stable sort, contacts at the same time of impact stay in pair order
+====================================================
+*/
+static bool CompareContacts( const contact_t & a, const contact_t & b ) {
+    return a.timeOfImpact < b.timeOfImpact;
+}
 
-    return 0;
+/*
+====================================================
+EndStage
+
+Returns the milliseconds since start, and restarts it.
+The stage is also recorded as a profiler event while capturing.
+====================================================
+*/
+static float EndStage( const char * name, std::chrono::steady_clock::time_point & start ) {
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    const float ms = std::chrono::duration< float, std::milli >( now - start ).count();
+    start = now;
+
+#if ENABLE_PROFILER
+    if ( Profiler::IsCapturing() ) {
+        const double durationMicroseconds = ms * 1000.0;
+        Profiler::AddEvent( name, Profiler::GetTimeMicroseconds() - durationMicroseconds, durationMicroseconds );
+    }
+#endif
+    return ms;
 }
 
 /*
@@ -484,45 +1089,71 @@ Scene::Update
 ====================================================
 */
 void Scene::Update( const float dt_sec ) {
+    std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point stageStart = frameStart;
+
+    // Everything allocated from the arena is only valid until the end of this update
+    m_frameArena.Reset();
+    ScopedThreadArena threadArena( &m_frameArena );
+
+    FlushRemovedBodies();
     m_manifolds.RemoveExpired();
+    m_timings.manifolds = EndStage( "Scene::RemoveExpired", stageStart );
 
     // Gravity impulse
     for (int i = 0; i < m_bodies.size(); i++)
     {
+        if ( !m_bodies.IsAlive( i ) ) {
+            continue;
+        }
         Body* body = &m_bodies[i];
 
         // Gravity needs to be an impulse
         // I = dp , F = dp/ dt => dp = F * dt => I = F * dt
         // F = mgs
         float mass = 1.0f / body->m_invMass;
-        Vec3 impulseGravity = GRAVITY * mass * dt_sec;
+        Vec3 impulseGravity = m_gravity * mass * dt_sec;
         body->ApplyImpulseLinear(impulseGravity);
     }
+    m_timings.gravity = EndStage( "Scene::Gravity", stageStart );
 
     //
     // Broad Phase (build potential collision pairs)
     //
-    std::vector<collisionPair_t> collisionPairs;
-    BroadPhase(m_bodies.data(), (int)m_bodies.size(), collisionPairs, dt_sec);
+    if ( m_broadPhase.NeedsBuild( m_bodies ) ) {
+        BuildBroadPhase();
+    }
+    collisionPairs_t collisionPairs( ( ArenaAllocator< collisionPair_t >( &m_frameArena ) ) );
+    BroadPhase(m_broadPhase, m_bodies, collisionPairs, dt_sec);
+    PROFILE_COUNTER_ADD( COUNTER_PAIRS, (long long)collisionPairs.size() );
+    m_timings.broadPhase = EndStage( "Scene::BroadPhase", stageStart );
 
     //
     // Narrow Phase (perform actual collision detection)
     //
-    int numContacts = 0 ;
-    contact_t* contacts = (contact_t*)alloca(sizeof(contact_t) * collisionPairs.size()) ;
+    // Only pairs with a body fast enough to tunnel search for a time of impact
+    char * isFast = m_frameArena.Alloc< char >( m_bodies.size() );
+    for ( int i = 0; i < m_bodies.size(); i++ ) {
+        isFast[ i ] = m_bodies.IsAlive( i ) && NeedsContinuous( &m_bodies[ i ], dt_sec );
+        PROFILE_COUNTER_ADD( COUNTER_CCD_BODIES, (long long)isFast[ i ] );
+    }
+
+    // Only the ballistic hits are kept, most pairs never touch
+    std::vector< contact_t, ArenaAllocator< contact_t > > contacts( ( ArenaAllocator< contact_t >( &m_frameArena ) ) );
     for (int i = 0; i < collisionPairs.size(); i++)
     {
         const collisionPair_t& pair = collisionPairs[i];
         Body* bodyA = &m_bodies[pair.a];
         Body* bodyB = &m_bodies[pair.b];
 
-        // Skip body pairs with infinite mass
-        if (0.0f == bodyA->m_invMass && 0.0f == bodyB->m_invMass)
-            continue;
+        const bool isContinuous = isFast[ pair.a ] || isFast[ pair.b ];
+        PROFILE_COUNTER_ADD( COUNTER_CCD_PAIRS, (long long)isContinuous );
 
         contact_t contact;
-        if (Intersect(bodyA, bodyB, dt_sec, contact))
+        const bool didIntersect = m_speculativeContacts ? IntersectSpeculative( bodyA, bodyB, dt_sec, contact ) : Intersect( bodyA, bodyB, dt_sec, isContinuous, contact );
+        if ( didIntersect )
         {
+            PROFILE_COUNTER_ADD( COUNTER_CONTACTS, 1 );
             if ( 0.0f == contact.timeOfImpact)
             {
                 // static contact
@@ -531,17 +1162,19 @@ void Scene::Update( const float dt_sec ) {
             else
             {
                 // ballistic contact
-                contacts[numContacts] = contact;
-                numContacts++;
+                contacts.push_back( contact );
             }
         }
     }
 
+    m_timings.narrowPhase = EndStage( "Scene::NarrowPhase", stageStart );
+
     // Sort the times of impact from earliest to latest
-    if (numContacts > 1 )
+    if ( contacts.size() > 1 )
     {
-        qsort(contacts, numContacts, sizeof(contact_t) , CompareContacts);
+        std::stable_sort( contacts.begin(), contacts.end(), CompareContacts );
     }
+    m_timings.sortContacts = EndStage( "Scene::SortContacts", stageStart );
 
     //
     //	Solve Constraints
@@ -551,45 +1184,161 @@ void Scene::Update( const float dt_sec ) {
         m_constraints[i]->PreSolve(dt_sec);
     }
     m_manifolds.PreSolve(dt_sec);
-    const int maxIters = 5;
-    for ( int iters = 0; iters < maxIters; iters++ ) {
-        for ( int i = 0; i < m_constraints.size(); i++ ) {
-            m_constraints[ i ]->Solve();
-        }
-        m_manifolds.Solve();
+
+    // Every constraint becomes scalar rows, and one projected Gauss-Seidel solves them all together
+    int maxRows = m_manifolds.GetNumRows();
+    for ( int i = 0; i < m_constraints.size(); i++ ) {
+        maxRows += m_constraints[ i ]->GetNumRows();
+    }
+    solverRow_t * rows = m_frameArena.Alloc< solverRow_t >( maxRows );
+    int numRows = 0;
+    for ( int i = 0; i < m_constraints.size(); i++ ) {
+        numRows += m_constraints[ i ]->BuildRows( rows + numRows );
     }
+    numRows += m_manifolds.BuildRows( rows + numRows, m_blockSolver );
+
+    // Islands that settle early stop iterating, the ones still moving get more sweeps
+    solverRow_t * islandRows = m_frameArena.Alloc< solverRow_t >( numRows );
+    solverIsland_t * islands = m_frameArena.Alloc< solverIsland_t >( numRows );
+    const int numIslands = BuildIslands( m_bodies, rows, numRows, islandRows, islands, m_frameArena );
+    WarmStartRows( islandRows, numRows );
+    PROFILE_COUNTER_ADD( COUNTER_SOLVER_ROWS, (long long)numRows );
+    m_timings.preSolve = EndStage( "Scene::PreSolve", stageStart );
+
+    SolveIslands( islandRows, islands, numIslands, m_solverSettings, m_solverStats );
+    PROFILE_COUNTER_ADD( COUNTER_SOLVER_ISLANDS, (long long)m_solverStats.numIslands );
+    PROFILE_COUNTER_ADD( COUNTER_SOLVER_ITERATIONS, (long long)m_solverStats.totalIterations );
+    m_timings.solve = EndStage( "Scene::Solve", stageStart );
+
+    StoreRows( islandRows, numRows );
     for (int i = 0; i < m_constraints.size(); i++)
     {
         m_constraints[i]->PostSolve();
     }
     m_manifolds.PostSolve();
+    for ( int i = 0; i < m_bodies.size(); i++ ) {
+        if ( m_bodies.IsAlive( i ) ) {
+            m_bodies[ i ].ClampAngularVelocity();
+        }
+    }
+    m_timings.postSolve = EndStage( "Scene::PostSolve", stageStart );
 
     //
     // Apply ballistic impulses
     //
-    float accumulatedTime = 0.0f;
-    for (int i = 0; i < numContacts; i++)
-    {
-        contact_t& contact = contacts[i];
-        const float dt = contact.timeOfImpact - accumulatedTime;
-
-        // Position update
-        for (int j = 0 ; j < m_bodies.size() ; j++)
-        {
-            m_bodies[j].Update(dt);
+    // Every body keeps its own clock.  A time of impact only moves the two bodies
+    // that touch up to it, everything else is integrated once for the whole step.
+    float * localTime = m_frameArena.Alloc< float >( m_bodies.size() );
+    for ( int i = 0; i < m_bodies.size(); i++ ) {
+        localTime[ i ] = 0.0f;
+    }
+    for ( int i = 0; i < contacts.size(); i++ ) {
+        contact_t & contact = contacts[ i ];
+        const int idxA = m_bodies.IndexOf( contact.bodyA );
+        const int idxB = m_bodies.IndexOf( contact.bodyB );
+        if ( idxA < 0 || idxB < 0 ) {
+            continue;
         }
 
-        ResolveContact(contact);
-        accumulatedTime += dt;
+        AdvanceBody( m_bodies[ idxA ], localTime[ idxA ], contact.timeOfImpact );
+        AdvanceBody( m_bodies[ idxB ], localTime[ idxB ], contact.timeOfImpact );
+        ResolveContact( contact );
     }
 
     // Update the positions for the rest of this frame’s time
-    const float timeRemaining = dt_sec - accumulatedTime;
-    if (timeRemaining > 0.0f )
-    {
-        for (int i = 0 ; i < m_bodies.size() ; i++)
-        {
-            m_bodies[i].Update(timeRemaining);
+    for ( int i = 0; i < m_bodies.size(); i++ ) {
+        if ( m_bodies.IsAlive( i ) ) {
+            AdvanceBody( m_bodies[ i ], localTime[ i ], dt_sec );
         }
     }
-}
\ No newline at end of file
+    m_timings.ballistic = EndStage( "Scene::Ballistic", stageStart );
+    m_timings.total = EndStage( "Scene::Update", frameStart );
+
+    // The bodies have moved, the next query rebuilds its tree
+    m_query.Invalidate();
+
+    PROFILE_COUNTER_ADD( COUNTER_MANIFOLDS, (long long)m_manifolds.m_manifolds.size() );
+#if ENABLE_PROFILER
+    Profiler::EndThreadFrame( m_counters );
+#endif
+}
+
+/*
+====================================================
+Scene::Step
+====================================================
+*/
+int Scene::Step( const float elapsed_sec ) {
+    m_accumulator += elapsed_sec;
+
+    int numSteps = 0;
+    while ( m_accumulator >= m_fixedDt ) {
+        if ( numSteps >= m_maxStepsPerFrame ) {
+            // Simulating is slower than real time.  Catching up would only make the
+            // next frame longer still, so drop whole steps and keep the remainder.
+            const float dropped = m_accumulator - fmodf( m_accumulator, m_fixedDt );
+            m_accumulator -= dropped;
+            m_droppedTime += dropped;
+            break;
+        }
+
+        m_previousTransforms.resize( m_bodies.size() );
+        for ( int i = 0; i < m_bodies.size(); i++ ) {
+            m_previousTransforms[ i ].position = m_bodies[ i ].m_position;
+            m_previousTransforms[ i ].orientation = m_bodies[ i ].m_orientation;
+        }
+
+        const float dt_sec = m_fixedDt / (float)m_numSubSteps;
+        for ( int i = 0; i < m_numSubSteps; i++ ) {
+            Update( dt_sec );
+        }
+
+        m_accumulator -= m_fixedDt;
+        numSteps++;
+    }
+    return numSteps;
+}
+
+/*
+====================================================
+Scene::GetInterpolatedTransform
+
+The transform of a body between the previous and the current step,
+at the fraction of a step that is still in the accumulator
+====================================================
+*/
+void Scene::GetInterpolatedTransform( const int idx, Vec3 & pos, Quat & orient ) const {
+    const Body & body = m_bodies[ idx ];
+    if ( idx >= (int)m_previousTransforms.size() ) {
+        pos = body.m_position;
+        orient = body.m_orientation;
+        return;
+    }
+
+    bodyTransform_t current;
+    current.position = body.m_position;
+    current.orientation = body.m_orientation;
+    InterpolateTransform( m_previousTransforms[ idx ], current, GetInterpolationAlpha(), pos, orient );
+}
+
+/*
+====================================================
+InterpolateTransform
+
+Lerps the position and nlerps the orientation, through the shorter arc
+====================================================
+*/
+void InterpolateTransform( const bodyTransform_t & from, const bodyTransform_t & to, const float t, Vec3 & pos, Quat & orient ) {
+    pos = from.position + ( to.position - from.position ) * t;
+
+    const Quat & q0 = from.orientation;
+    Quat q1 = to.orientation;
+    if ( q0.x * q1.x + q0.y * q1.y + q0.z * q1.z + q0.w * q1.w < 0.0f ) {
+        q1 *= -1.0f;
+    }
+    orient.x = q0.x + ( q1.x - q0.x ) * t;
+    orient.y = q0.y + ( q1.y - q0.y ) * t;
+    orient.z = q0.z + ( q1.z - q0.z ) * t;
+    orient.w = q0.w + ( q1.w - q0.w ) * t;
+    orient.Normalize();
+}
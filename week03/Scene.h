@@ -3,11 +3,18 @@
 //
 #pragma once
 #include <vector>
+#include <string.h>
 
 #include "Physics/Shapes.h"
 #include "Physics/Body.h"
+#include "Physics/BodyPool.h"
 #include "Physics/Constraints.h"
 #include "Physics/Manifold.h"
+#include "Physics/Broadphase.h"
+#include "Physics/Profiler.h"
+#include "Physics/FrameArena.h"
+#include "Physics/Solver.h"
+#include "Physics/SceneQuery.h"
 
 /*
 ====================================================
@@ -17,17 +24,146 @@ Scene
 
 const static Vec3 GRAVITY = Vec3(0.0f, 0.0f, -10.0f);
 
+/*
+====================================================
+sceneTimings_t
+
+Wall clock milliseconds spent in each stage of the last Scene::Update
+====================================================
+*/
+struct sceneTimings_t {
+	float manifolds;
+	float gravity;
+	float broadPhase;
+	float narrowPhase;
+	float sortContacts;
+	float preSolve;
+	float solve;
+	float postSolve;
+	float ballistic;
+	float total;
+};
+
+/*
+====================================================
+bodyTransform_t
+====================================================
+*/
+struct bodyTransform_t {
+	Vec3 position;
+	Quat orientation;
+};
+
+/*
+====================================================
+sceneState_t
+
+Everything Scene::Update carries from one call to the next, see Scene::SaveState.
+Bodies keep their shape pointers, a state only belongs to the scene it came from.
+====================================================
+*/
+struct sceneState_t {
+	bodyPoolState_t bodies;
+	manifoldCollectorState_t manifolds;
+	std::vector< Constraint * > constraints;	// only compared against, to find the joints added since
+	std::vector< float > constraintState;		// GetStateSize floats of each joint, in order
+	std::vector< bodyTransform_t > previousTransforms;
+	float accumulator;
+	float droppedTime;
+
+	sceneState_t() : accumulator( 0.0f ), droppedTime( 0.0f ) {}
+	size_t GetNumBytes() const;
+};
+
 class Scene {
 public:
-	Scene() { m_bodies.reserve( 128 ); }
+	Scene() : m_query( m_bodies, m_broadPhase ), m_preset( 0 ), m_gravity( GRAVITY ), m_fixedDt( 1.0f / 60.0f ), m_numSubSteps( 2 ), m_maxStepsPerFrame( 4 ), m_blockSolver( true ), m_speculativeContacts( false ), m_accumulator( 0.0f ), m_droppedTime( 0.0f ) { memset( &m_timings, 0, sizeof( m_timings ) ); memset( &m_counters, 0, sizeof( m_counters ) ); memset( &m_solverStats, 0, sizeof( m_solverStats ) ); }
 	~Scene();
 
 	void Reset();
 	void Initialize();
 	void Update( const float dt_sec );	
 
-	std::vector< Body > m_bodies;
+	// Fixed rate stepping.  Step takes the real time that has passed and runs
+	// Update m_numSubSteps times for every m_fixedDt of it.  The time left over
+	// carries into the next call, and blends the rendered transforms between
+	// the last two steps.  Returns the number of steps that were run.
+	int Step( const float elapsed_sec );
+	float GetInterpolationAlpha() const { return m_accumulator / m_fixedDt; }
+	void GetInterpolatedTransform( const int idx, Vec3 & pos, Quat & orient ) const;
+
+	// Bodies can come and go between updates, both are O(1).  A removed body's
+	// manifolds and constraints are dropped at the start of the next Update,
+	// its slot is only reused after that.
+	bodyHandle_t AddBody( const Body & body );
+	void RemoveBody( const bodyHandle_t & handle );
+	Body * GetBody( const bodyHandle_t & handle ) { return m_bodies.Get( handle ); }
+
+	void BuildBroadPhase();
+	void BuildIgnoredPairs();
+
+	// Snapshots for rolling back.  Restoring removes the bodies and joints that
+	// were added since the save, and handles to them may resolve again once
+	// their slots are reused.  Bodies removed since the save can only come back
+	// while their removal is pending, RestoreState fails and leaves the scene
+	// alone once an Update has flushed them.
+	void SaveState( sceneState_t & state ) const;
+	bool RestoreState( const sceneState_t & state );
+
+	// Queries against the bodies as they were after the last Update, see SceneQuery
+	bool RayCast( const ray_t & ray, const rayCastMode_t mode, std::vector< rayHit_t > & hits ) { return m_query.RayCast( ray, mode, hits ); }
+	void RayCastMany( const ray_t * rays, const int num, const rayCastMode_t mode, std::vector< rayHit_t > & hits, rayResult_t * results ) { m_query.RayCastMany( rays, num, mode, hits, results ); }
+	bool ShapeCast( const Shape * shape, const bodyTransform_t & transform, const Vec3 & dir, const float distance, const rayCastMode_t mode, std::vector< rayHit_t > & hits ) { return m_query.ShapeCast( shapeCast_t( shape, transform.position, transform.orientation, dir, distance ), mode, hits ); }
+	void ShapeCastMany( const shapeCast_t * casts, const int num, const rayCastMode_t mode, std::vector< rayHit_t > & hits, rayResult_t * results ) { m_query.ShapeCastMany( casts, num, mode, hits, results ); }
+	bool Overlap( const Shape * shape, const bodyTransform_t & transform, std::vector< int > & bodies ) { return m_query.Overlap( overlap_t( shape, transform.position, transform.orientation ), bodies ); }
+	void OverlapMany( const overlap_t * queries, const int num, std::vector< int > & bodies, rayResult_t * results ) { m_query.OverlapMany( queries, num, bodies, results ); }
+	bool QueryAABB( const Bounds & bounds, std::vector< int > & bodies ) { return m_query.QueryAABB( bounds, bodies ); }
+	bool QueryFrustum( const frustum_t & frustum, std::vector< int > & bodies ) { return m_query.QueryFrustum( frustum, bodies ); }
+
+	// Presets are the worlds Initialize can build, "default" is the demo scene
+	bool SetPreset( const char * name );
+	static int GetNumPresets();
+	static const char * GetPresetName( const int idx );
+
+	BodyPool m_bodies;
 	std::vector< Constraint * >	m_constraints;
 	ManifoldCollector m_manifolds;
+	BroadPhaseState m_broadPhase;
+	SceneQuery m_query;
+
+	int m_preset;
+	Vec3 m_gravity;				// acceleration of every dynamic body, GRAVITY unless changed
+
+	float m_fixedDt;			// seconds of simulation per step
+	int m_numSubSteps;			// Update calls per step
+	int m_maxStepsPerFrame;		// when Step falls further behind than this, the backlog is dropped
+	bool m_blockSolver;			// solve the normal rows of each contact manifold together instead of one by one
+	solverSettings_t m_solverSettings;	// iteration bounds and tolerance of every island
+	bool m_speculativeContacts;	// contacts for pairs that could touch this step instead of times of impact
+	float m_accumulator;		// real time not simulated yet, always less than m_fixedDt after Step
+	float m_droppedTime;		// total seconds dropped to keep up
+	std::vector< bodyTransform_t > m_previousTransforms;	// body transforms before the last step
+
+	sceneTimings_t m_timings;
+	profileCounters_t m_counters;	// counters of the last Update, zero when the profiler is compiled out
+	solverStats_t m_solverStats;	// iterations and residuals of the last Update's solve
+	FrameArena m_frameArena;	// temporaries of the running Update, reset at its start
+
+private:
+	void FlushRemovedBodies();
 };
 
+void InterpolateTransform( const bodyTransform_t & from, const bodyTransform_t & to, const float t, Vec3 & pos, Quat & orient );
+
+void AddStandardSandBox( BodyPool & bodies );
+void AddRagdoll( BodyPool & bodies, std::vector< Constraint * > & constraints, const Vec3 & offset );
+void AddDistanceJoint( BodyPool & bodies, std::vector< Constraint * > & constraints, const Vec3 & pos );
+void AddChain( BodyPool & bodies, std::vector< Constraint * > & constraints, const Vec3 & pos, const int numJoints );
+void AddBoxStack( BodyPool & bodies, const Vec3 & pos, const int numX, const int numY, const int stackHeight );
+void AddMotor( BodyPool & bodies, std::vector< Constraint * > & constraints, const Vec3 & motorPos );
+void AddMover( BodyPool & bodies, std::vector< Constraint * > & constraints, const Vec3 & pos );
+void AddShapePile( BodyPool & bodies, const Vec3 & pos, const int numX, const int numY, const int height );
+void AddMeshGround( BodyPool & bodies, const Vec3 & pos, const int numX, const int numY, const float spacing );
+void AddTerrain( BodyPool & bodies, const Vec3 & pos, const int numX, const int numY, const float spacing );
+ShapeCompound * NewDumbbell();
+void AddDumbbellPile( BodyPool & bodies, const Vec3 & pos, const int numX, const int numY, const int height );
@@ -0,0 +1,178 @@
+//
+//  SceneBatch.cpp
+//
+#include "SceneBatch.h"
+#include <algorithm>
+
+/*
+====================================================
+SceneBatch::SceneBatch
+====================================================
+*/
+SceneBatch::SceneBatch( const int numThreads ) :
+    m_generation( 0 ),
+    m_numBusy( 0 ),
+    m_isStopping( false ),
+    m_job( JOB_UPDATE ),
+    m_jobSeconds( 0.0f ),
+    m_nextScene( 0 ) {
+    int numWorkers = ( numThreads > 0 ) ? numThreads : (int)std::thread::hardware_concurrency();
+    numWorkers = std::max( numWorkers - 1, 0 );
+    for ( int i = 0; i < numWorkers; i++ ) {
+        m_workers.push_back( std::thread( &SceneBatch::WorkerLoop, this ) );
+    }
+}
+
+/*
+====================================================
+SceneBatch::~SceneBatch
+====================================================
+*/
+SceneBatch::~SceneBatch() {
+    {
+        std::lock_guard< std::mutex > lock( m_mutex );
+        m_isStopping = true;
+    }
+    m_wakeWorkers.notify_all();
+    for ( int i = 0; i < m_workers.size(); i++ ) {
+        m_workers[ i ].join();
+    }
+
+    Clear();
+}
+
+/*
+====================================================
+SceneBatch::AddScene
+====================================================
+*/
+Scene * SceneBatch::AddScene( const char * preset ) {
+    Scene * scene = new Scene;
+    if ( !scene->SetPreset( preset ) ) {
+        delete scene;
+        return NULL;
+    }
+    m_scenes.push_back( scene );
+    return scene;
+}
+
+/*
+====================================================
+SceneBatch::Clear
+====================================================
+*/
+void SceneBatch::Clear() {
+    for ( int i = 0; i < m_scenes.size(); i++ ) {
+        delete m_scenes[ i ];
+    }
+    m_scenes.clear();
+}
+
+/*
+====================================================
+SceneBatch::Reset
+====================================================
+*/
+void SceneBatch::Reset() {
+    Run( JOB_RESET, 0.0f );
+}
+
+/*
+====================================================
+SceneBatch::Update
+====================================================
+*/
+void SceneBatch::Update( const float dt_sec ) {
+    Run( JOB_UPDATE, dt_sec );
+}
+
+/*
+====================================================
+SceneBatch::Step
+====================================================
+*/
+void SceneBatch::Step( const float elapsed_sec ) {
+    Run( JOB_STEP, elapsed_sec );
+}
+
+/*
+====================================================
+SceneBatch::Run
+
+Hands the job to the workers, helps with it, and waits for them to finish
+====================================================
+*/
+void SceneBatch::Run( const job_t job, const float seconds ) {
+    {
+        std::lock_guard< std::mutex > lock( m_mutex );
+        m_job = job;
+        m_jobSeconds = seconds;
+        m_nextScene.store( 0 );
+        m_numBusy = (int)m_workers.size();
+        m_generation++;
+    }
+    m_wakeWorkers.notify_all();
+
+    RunJob();
+
+    std::unique_lock< std::mutex > lock( m_mutex );
+    m_jobDone.wait( lock, [ this ]() { return 0 == m_numBusy; } );
+}
+
+/*
+====================================================
+SceneBatch::RunJob
+
+Takes scenes one at a time until there are none left, so threads
+that drew cheap scenes move on to the others
+====================================================
+*/
+void SceneBatch::RunJob() {
+    const int numScenes = (int)m_scenes.size();
+    while ( true ) {
+        const int idx = m_nextScene.fetch_add( 1 );
+        if ( idx >= numScenes ) {
+            return;
+        }
+
+        Scene * scene = m_scenes[ idx ];
+        switch ( m_job ) {
+            case JOB_RESET: {
+                scene->Reset();
+            } break;
+            case JOB_UPDATE: {
+                scene->Update( m_jobSeconds );
+            } break;
+            case JOB_STEP: {
+                scene->Step( m_jobSeconds );
+            } break;
+        }
+    }
+}
+
+/*
+====================================================
+SceneBatch::WorkerLoop
+====================================================
+*/
+void SceneBatch::WorkerLoop() {
+    long long generation = 0;
+    while ( true ) {
+        {
+            std::unique_lock< std::mutex > lock( m_mutex );
+            m_wakeWorkers.wait( lock, [ & ]() { return m_isStopping || m_generation != generation; } );
+            if ( m_isStopping ) {
+                return;
+            }
+            generation = m_generation;
+        }
+
+        RunJob();
+
+        std::lock_guard< std::mutex > lock( m_mutex );
+        m_numBusy--;
+        if ( 0 == m_numBusy ) {
+            m_jobDone.notify_one();
+        }
+    }
+}
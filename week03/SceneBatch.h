@@ -0,0 +1,66 @@
+//
+//  SceneBatch.h
+//
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Scene.h"
+
+/*
+====================================================
+SceneBatch
+
+Owns any number of scenes that share no mutable state, and runs the same
+call on all of them at once across a pool of worker threads.  The thread
+that calls in works through the scenes alongside the workers, and returns
+once every scene is done.  Between calls the scenes can be used like any other.
+====================================================
+*/
+class SceneBatch {
+public:
+	explicit SceneBatch( const int numThreads = 0 );	// counting the calling thread, 0 uses every hardware thread
+	~SceneBatch();
+	SceneBatch( const SceneBatch & rhs ) = delete;
+	SceneBatch & operator = ( const SceneBatch & rhs ) = delete;
+
+	// Returns NULL for an unknown preset, the scene is only built by the next Reset
+	Scene * AddScene( const char * preset );
+	void Clear();
+
+	int GetNumScenes() const { return (int)m_scenes.size(); }
+	Scene * GetScene( const int idx ) { return m_scenes[ idx ]; }
+	int GetNumThreads() const { return (int)m_workers.size() + 1; }
+
+	void Reset();
+	void Update( const float dt_sec );
+	void Step( const float elapsed_sec );
+
+private:
+	enum job_t {
+		JOB_RESET,
+		JOB_UPDATE,
+		JOB_STEP,
+	};
+
+	void Run( const job_t job, const float seconds );
+	void RunJob();
+	void WorkerLoop();
+
+	std::vector< Scene * > m_scenes;
+
+	std::vector< std::thread > m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_wakeWorkers;
+	std::condition_variable m_jobDone;
+	long long m_generation;	// bumped for every job, workers run each generation once
+	int m_numBusy;			// workers still on the current job
+	bool m_isStopping;
+
+	job_t m_job;
+	float m_jobSeconds;
+	std::atomic< int > m_nextScene;	// the next scene nobody has taken yet
+};
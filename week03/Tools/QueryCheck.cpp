@@ -0,0 +1,681 @@
+//
+//  QueryCheck.cpp
+//
+//  Checks the batched scene queries against the plain ones on a stepped
+//  scene preset, and prints how many queries disagree.  Exits with 1 when
+//  any of them do.
+//
+//  usage: week03_query_check [--scene name] [--frames N] [--queries N] [--seed N]
+//      rays: RayCastMany (packets of four, across worker threads) against
+//          RayCast one ray at a time, in every mode
+//      casts: shapes swept onto lone bodies where the answer is known, and
+//          ShapeCastMany against ShapeCast one at a time
+//      overlaps: Overlap against GJK_DoesIntersect with every convex body,
+//          and OverlapMany against Overlap one at a time
+//      volumes: QueryAABB and QueryFrustum against testing every body's world
+//          bounds, and the physics thread's snapshot culling against its own bounds
+//
+#include "Scene.h"
+#include "PhysicsThread.h"
+#include "Physics/GJK.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+/*
+====================================================
+random_t
+
+A small LCG, the same numbers on every platform
+====================================================
+*/
+struct random_t {
+    unsigned int state;
+
+    explicit random_t( const unsigned int seed ) : state( seed ) {}
+
+    unsigned int Next() {
+        state = state * 1664525u + 1013904223u;
+        return state >> 8;
+    }
+
+    // Uniform in [ lo, hi ]
+    float Float( const float lo, const float hi ) {
+        return lo + ( hi - lo ) * (float)( Next() & 0xffff ) / 65535.0f;
+    }
+
+    Vec3 UnitVector() {
+        while ( true ) {
+            Vec3 v( Float( -1, 1 ), Float( -1, 1 ), Float( -1, 1 ) );
+            const float lenSqr = v.GetLengthSqr();
+            if ( lenSqr > 0.01f && lenSqr <= 1.0f ) {
+                return v / sqrtf( lenSqr );
+            }
+        }
+    }
+};
+
+static const char * g_modeNames[] = { "closest", "any", "all" };
+
+/*
+====================================================
+GetBodyBounds
+====================================================
+*/
+static Bounds GetBodyBounds( const Body & body ) {
+    return body.m_shape->GetBounds( body.m_position, body.m_orientation );
+}
+
+/*
+====================================================
+GetDynamicBounds
+
+The bounds of the bodies that move, the static ones can be far bigger than
+where anything happens
+====================================================
+*/
+static Bounds GetDynamicBounds( const Scene & scene ) {
+    Bounds bounds;
+    for ( int i = 0; i < scene.m_bodies.size(); i++ ) {
+        if ( scene.m_bodies.IsAlive( i ) && !scene.m_bodies[ i ].IsStatic() ) {
+            bounds.Expand( GetBodyBounds( scene.m_bodies[ i ] ) );
+        }
+    }
+    if ( bounds.mins.x > bounds.maxs.x ) {
+        bounds.Expand( Vec3( -5, -5, 0 ) );
+        bounds.Expand( Vec3( 5, 5, 5 ) );
+    }
+    return bounds;
+}
+
+/*
+================================================================================================
+
+Rays
+
+================================================================================================
+*/
+
+/*
+====================================================
+MakeRays
+
+Most rays go every which way through the busy part of the scene.  Every
+fourth one is axis aligned and starts exactly on a face of some body's
+bounds, where the slab tests divide zero by zero.
+====================================================
+*/
+static void MakeRays( const Scene & scene, random_t & rng, const int num, std::vector< ray_t > & rays ) {
+    const Bounds area = GetDynamicBounds( scene );
+    const float length = ( area.maxs - area.mins ).GetMagnitude() * 2.0f;
+
+    rays.resize( num );
+    for ( int i = 0; i < num; i++ ) {
+        const int bodyIdx = (int)( rng.Next() % (unsigned int)scene.m_bodies.size() );
+        if ( 3 == ( i & 3 ) && scene.m_bodies.IsAlive( bodyIdx ) ) {
+            const Bounds bounds = GetBodyBounds( scene.m_bodies[ bodyIdx ] );
+            const int axis = (int)( rng.Next() % 3 );
+            Vec3 start( rng.Float( bounds.mins.x, bounds.maxs.x ), rng.Float( bounds.mins.y, bounds.maxs.y ), rng.Float( bounds.mins.z, bounds.maxs.z ) );
+            Vec3 dir( 0, 0, 0 );
+            dir[ axis ] = -1.0f;
+            start[ axis ] = bounds.maxs[ axis ] + 1.0f;
+            start[ ( axis + 1 ) % 3 ] = ( rng.Next() & 1 ) ? bounds.mins[ ( axis + 1 ) % 3 ] : bounds.maxs[ ( axis + 1 ) % 3 ];
+            rays[ i ] = ray_t( start, dir, length );
+            continue;
+        }
+
+        const Vec3 start( rng.Float( area.mins.x, area.maxs.x ), rng.Float( area.mins.y, area.maxs.y ), rng.Float( area.mins.z, area.maxs.z + 2.0f ) );
+        rays[ i ] = ray_t( start, rng.UnitVector(), length );
+    }
+}
+
+/*
+====================================================
+IsSameHit
+
+The same body hit at the same distance.  Two bodies can be hit at exactly
+the same distance, then either one is right.
+====================================================
+*/
+static bool IsSameHit( const rayHit_t & a, const rayHit_t & b ) {
+    const float tolerance = 1e-5f * std::max( 1.0f, fabsf( a.t ) );
+    if ( fabsf( a.t - b.t ) > tolerance ) {
+        return false;
+    }
+    return a.body == b.body || a.t == b.t;
+}
+
+static bool CompareByBody( const rayHit_t & a, const rayHit_t & b ) {
+    return a.body < b.body;
+}
+
+/*
+====================================================
+IsSameResult
+
+Compares the hits of one query of a batch against the hits of the same
+query on its own
+====================================================
+*/
+static bool IsSameResult( const rayCastMode_t mode, const rayHit_t * batchHits, const int numBatch, const std::vector< rayHit_t > & single ) {
+    if ( numBatch != (int)single.size() ) {
+        return false;
+    }
+    if ( 0 == numBatch ) {
+        return true;
+    }
+
+    switch ( mode ) {
+        case RAYCAST_CLOSEST: {
+            return IsSameHit( batchHits[ 0 ], single[ 0 ] );
+        }
+        case RAYCAST_ANY: {
+            // Any hit will do, the batch and the single query can find different ones first
+            return true;
+        }
+        case RAYCAST_ALL: {
+            // Hits at the same distance can come in either order
+            std::vector< rayHit_t > a( batchHits, batchHits + numBatch );
+            std::vector< rayHit_t > b( single );
+            std::stable_sort( a.begin(), a.end(), CompareByBody );
+            std::stable_sort( b.begin(), b.end(), CompareByBody );
+            for ( int i = 0; i < numBatch; i++ ) {
+                if ( a[ i ].body != b[ i ].body || !IsSameHit( a[ i ], b[ i ] ) ) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+====================================================
+CheckRays
+====================================================
+*/
+static int CheckRays( Scene & scene, const int numRays, const unsigned int seed ) {
+    random_t rng( seed );
+    std::vector< ray_t > rays;
+    MakeRays( scene, rng, numRays, rays );
+
+    int numMismatches = 0;
+    std::vector< rayHit_t > batchHits;
+    std::vector< rayResult_t > results( numRays );
+    std::vector< rayHit_t > single;
+    for ( int m = RAYCAST_CLOSEST; m <= RAYCAST_ALL; m++ ) {
+        const rayCastMode_t mode = (rayCastMode_t)m;
+        scene.RayCastMany( rays.data(), numRays, mode, batchHits, results.data() );
+
+        int numHit = 0;
+        int numBad = 0;
+        for ( int i = 0; i < numRays; i++ ) {
+            scene.RayCast( rays[ i ], mode, single );
+            numHit += single.empty() ? 0 : 1;
+            if ( !IsSameResult( mode, batchHits.data() + results[ i ].first, results[ i ].count, single ) ) {
+                if ( numBad < 4 ) {
+                    printf( "  ray %d: batch has %d hits, single has %d\n", i, results[ i ].count, (int)single.size() );
+                }
+                numBad++;
+            }
+        }
+        printf( "rays/%-8s %6d rays %6d hit %6d mismatched\n", g_modeNames[ m ], numRays, numHit, numBad );
+        numMismatches += numBad;
+    }
+    return numMismatches;
+}
+
+/*
+================================================================================================
+
+Shape Casts
+
+================================================================================================
+*/
+
+static Shape * MakeBox( const Vec3 & halfExtents ) {
+    const Vec3 corners[ 2 ] = { halfExtents * -1.0f, halfExtents };
+    return new ShapeBox( corners, 2 );
+}
+
+/*
+====================================================
+knownCast_t
+
+A shape swept onto a single static body at the origin, and where it has to land
+====================================================
+*/
+struct knownCast_t {
+    const char * name;
+    Shape * target;
+    Shape * shape;
+    Vec3 position;
+    Quat orientation;
+    Vec3 dir;
+    float distance;
+    bool isHit;
+    float t;		// distance travelled to the hit
+    Vec3 normal;
+};
+
+/*
+====================================================
+CheckKnownCasts
+
+Spheres and boxes against boxes and spheres, straight and at an angle, a
+tiny sphere onto a huge box (the case where GJK_ShapeCast has to step past
+its own rounding), misses, and casts that start overlapping
+====================================================
+*/
+static int CheckKnownCasts() {
+    const float halfSqrt2 = 0.5f * sqrtf( 2.0f );
+    const Quat identity( 0, 0, 0, 1 );
+    const Quat tilted( Vec3( 1, 0, 0 ), 0.25f * 3.14159265f );	// an edge of the box points down
+    Vec3 diagonal( 1, 0, -1 );
+    diagonal.Normalize();
+
+    Shape * unitBox = MakeBox( Vec3( 1, 1, 1 ) );
+    Shape * bigBox = MakeBox( Vec3( 50, 50, 1 ) );
+    Shape * unitSphere = new ShapeSphere( 1.0f );
+    Shape * halfBox = MakeBox( Vec3( 0.5f, 0.5f, 0.5f ) );
+    Shape * halfSphere = new ShapeSphere( 0.5f );
+    Shape * tinySphere = new ShapeSphere( 0.01f );
+
+    const knownCast_t casts[] = {
+        { "sphere onto box", unitBox, halfSphere, Vec3( 0, 0, 5 ), identity, Vec3( 0, 0, -1 ), 10.0f, true, 3.5f, Vec3( 0, 0, 1 ) },
+        { "box onto sphere", unitSphere, halfBox, Vec3( -5, 0, 0 ), identity, Vec3( 1, 0, 0 ), 10.0f, true, 3.5f, Vec3( -1, 0, 0 ) },
+        { "sphere onto sphere", unitSphere, halfSphere, Vec3( -4, 0, 0 ), identity, Vec3( 1, 0, 0 ), 8.0f, true, 2.5f, Vec3( -1, 0, 0 ) },
+        { "box onto box", unitBox, halfBox, Vec3( 0.2f, -0.3f, 5 ), identity, Vec3( 0, 0, -1 ), 10.0f, true, 3.5f, Vec3( 0, 0, 1 ) },
+        { "tilted box onto box", unitBox, halfBox, Vec3( 0, 0, 5 ), tilted, Vec3( 0, 0, -1 ), 10.0f, true, 4.0f - halfSqrt2, Vec3( 0, 0, 1 ) },
+        { "tiny sphere onto huge box", bigBox, tinySphere, Vec3( 3, 7, 5 ), identity, Vec3( 0, 0, -1 ), 10.0f, true, 3.99f, Vec3( 0, 0, 1 ) },
+        { "tiny sphere onto huge box at 45", bigBox, tinySphere, Vec3( 0, 0, 5 ), identity, diagonal, 10.0f, true, 3.99f * sqrtf( 2.0f ), Vec3( 0, 0, 1 ) },
+        { "sphere past box", unitBox, halfSphere, Vec3( 0, 3, 5 ), identity, Vec3( 0, 0, -1 ), 10.0f, false, 0.0f, Vec3( 0, 0, 0 ) },
+        { "sphere short of box", unitBox, halfSphere, Vec3( 0, 0, 5 ), identity, Vec3( 0, 0, -1 ), 3.0f, false, 0.0f, Vec3( 0, 0, 0 ) },
+        { "sphere away from box", unitBox, halfSphere, Vec3( 0, 0, 5 ), identity, Vec3( 0, 0, 1 ), 10.0f, false, 0.0f, Vec3( 0, 0, 0 ) },
+        { "box starting inside box", unitBox, halfBox, Vec3( 0, 0, 1 ), identity, Vec3( 0, 0, -1 ), 10.0f, true, 0.0f, Vec3( 0, 0, 1 ) },
+    };
+    const int numCasts = sizeof( casts ) / sizeof( casts[ 0 ] );
+
+    int numBad = 0;
+    std::vector< rayHit_t > hits;
+    for ( int i = 0; i < numCasts; i++ ) {
+        const knownCast_t & cast = casts[ i ];
+
+        Scene scene;
+        Body body;
+        body.m_position.Zero();
+        body.m_orientation = identity;
+        body.m_invMass = 0.0f;
+        body.m_shape = cast.target;
+        scene.AddBody( body );
+
+        bodyTransform_t transform;
+        transform.position = cast.position;
+        transform.orientation = cast.orientation;
+        const bool isHit = scene.ShapeCast( cast.shape, transform, cast.dir, cast.distance, RAYCAST_CLOSEST, hits );
+
+        // GJK_ShapeCast stops within a millimetre or so of the surface
+        bool isRight = ( isHit == cast.isHit );
+        if ( isRight && isHit ) {
+            isRight = fabsf( hits[ 0 ].t - cast.t ) < 0.005f && hits[ 0 ].normal.Dot( cast.normal ) > 0.999f;
+        }
+        if ( !isRight ) {
+            numBad++;
+            if ( isHit ) {
+                printf( "  %s: hit at %.4f normal ( %.3f %.3f %.3f )\n", cast.name, hits[ 0 ].t, hits[ 0 ].normal.x, hits[ 0 ].normal.y, hits[ 0 ].normal.z );
+            } else {
+                printf( "  %s: missed\n", cast.name );
+            }
+        }
+
+        // The scene owns its bodies' shapes, the targets are shared by the casts
+        scene.m_bodies[ 0 ].m_shape = NULL;
+    }
+    printf( "casts/known %7d casts %17d wrong\n", numCasts, numBad );
+
+    delete unitBox;
+    delete bigBox;
+    delete unitSphere;
+    delete halfBox;
+    delete halfSphere;
+    delete tinySphere;
+    return numBad;
+}
+
+/*
+====================================================
+IsSameHits
+
+Batched and single queries run the same code, so their hits are identical
+====================================================
+*/
+static bool IsSameHits( const rayHit_t * a, const int numA, const std::vector< rayHit_t > & b ) {
+    if ( numA != (int)b.size() ) {
+        return false;
+    }
+    for ( int i = 0; i < numA; i++ ) {
+        if ( a[ i ].body != b[ i ].body || a[ i ].t != b[ i ].t || a[ i ].normal != b[ i ].normal ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+====================================================
+CheckShapeCasts
+====================================================
+*/
+static int CheckShapeCasts( Scene & scene, const int numCasts, const unsigned int seed ) {
+    random_t rng( seed );
+    std::vector< ray_t > rays;
+    MakeRays( scene, rng, numCasts, rays );
+
+    Shape * shapes[ 2 ] = { new ShapeSphere( 0.25f ), MakeBox( Vec3( 0.3f, 0.2f, 0.1f ) ) };
+    std::vector< shapeCast_t > casts( numCasts );
+    for ( int i = 0; i < numCasts; i++ ) {
+        Quat orientation( rng.Float( -1, 1 ), rng.Float( -1, 1 ), rng.Float( -1, 1 ), rng.Float( -1, 1 ) );
+        orientation.Normalize();
+        casts[ i ] = shapeCast_t( shapes[ i & 1 ], rays[ i ].start, orientation, rays[ i ].dir, rays[ i ].maxT );
+    }
+
+    int numMismatches = 0;
+    std::vector< rayHit_t > batchHits;
+    std::vector< rayResult_t > results( numCasts );
+    std::vector< rayHit_t > single;
+    for ( int m = RAYCAST_CLOSEST; m <= RAYCAST_ALL; m++ ) {
+        const rayCastMode_t mode = (rayCastMode_t)m;
+        scene.ShapeCastMany( casts.data(), numCasts, mode, batchHits, results.data() );
+
+        int numHit = 0;
+        int numBad = 0;
+        for ( int i = 0; i < numCasts; i++ ) {
+            bodyTransform_t transform;
+            transform.position = casts[ i ].position;
+            transform.orientation = casts[ i ].orientation;
+            scene.ShapeCast( casts[ i ].shape, transform, casts[ i ].dir, casts[ i ].maxT, mode, single );
+            numHit += single.empty() ? 0 : 1;
+            if ( !IsSameHits( batchHits.data() + results[ i ].first, results[ i ].count, single ) ) {
+                numBad++;
+            }
+        }
+        printf( "casts/%-7s %6d casts %6d hit %6d mismatched\n", g_modeNames[ m ], numCasts, numHit, numBad );
+        numMismatches += numBad;
+    }
+
+    delete shapes[ 0 ];
+    delete shapes[ 1 ];
+    return numMismatches;
+}
+
+/*
+================================================================================================
+
+Overlaps
+
+================================================================================================
+*/
+
+static bool IsConvex( const Body & body ) {
+    return body.m_shape->GetType() < Shape::SHAPE_COMPOUND;
+}
+
+/*
+====================================================
+CheckOverlaps
+
+Only the convex bodies are checked by brute force, the others are made of
+pieces that Overlap takes apart the same way the narrow phase does
+====================================================
+*/
+static int CheckOverlaps( Scene & scene, const int numQueries, const unsigned int seed ) {
+    random_t rng( seed );
+    const Bounds area = GetDynamicBounds( scene );
+
+    Shape * shapes[ 2 ] = { new ShapeSphere( 1.0f ), MakeBox( Vec3( 1.0f, 0.5f, 0.25f ) ) };
+    std::vector< overlap_t > queries( numQueries );
+    for ( int i = 0; i < numQueries; i++ ) {
+        Quat orientation( rng.Float( -1, 1 ), rng.Float( -1, 1 ), rng.Float( -1, 1 ), rng.Float( -1, 1 ) );
+        orientation.Normalize();
+        const Vec3 position( rng.Float( area.mins.x, area.maxs.x ), rng.Float( area.mins.y, area.maxs.y ), rng.Float( area.mins.z, area.maxs.z ) );
+        queries[ i ] = overlap_t( shapes[ i & 1 ], position, orientation );
+    }
+
+    std::vector< int > batchBodies;
+    std::vector< rayResult_t > results( numQueries );
+    scene.OverlapMany( queries.data(), numQueries, batchBodies, results.data() );
+
+    int numFound = 0;
+    int numBruteBad = 0;
+    int numBatchBad = 0;
+    std::vector< int > found;
+    std::vector< int > convexFound;
+    std::vector< int > brute;
+    for ( int i = 0; i < numQueries; i++ ) {
+        const overlap_t & query = queries[ i ];
+        bodyTransform_t transform;
+        transform.position = query.position;
+        transform.orientation = query.orientation;
+        scene.Overlap( query.shape, transform, found );
+        numFound += (int)found.size();
+
+        const std::vector< int > batch( batchBodies.begin() + results[ i ].first, batchBodies.begin() + results[ i ].first + results[ i ].count );
+        if ( batch != found ) {
+            numBatchBad++;
+        }
+
+        Body queryBody;
+        queryBody.m_shape = const_cast< Shape * >( query.shape );
+        queryBody.m_position = query.position;
+        queryBody.m_orientation = query.orientation;
+        brute.clear();
+        for ( int b = 0; b < scene.m_bodies.size(); b++ ) {
+            if ( scene.m_bodies.IsAlive( b ) && IsConvex( scene.m_bodies[ b ] ) && GJK_DoesIntersect( &queryBody, &scene.m_bodies[ b ] ) ) {
+                brute.push_back( b );
+            }
+        }
+        convexFound.clear();
+        for ( int j = 0; j < found.size(); j++ ) {
+            if ( IsConvex( scene.m_bodies[ found[ j ] ] ) ) {
+                convexFound.push_back( found[ j ] );
+            }
+        }
+        if ( convexFound != brute ) {
+            if ( numBruteBad < 4 ) {
+                printf( "  overlap %d: found %d convex bodies, brute force %d\n", i, (int)convexFound.size(), (int)brute.size() );
+            }
+            numBruteBad++;
+        }
+    }
+    printf( "overlaps/brute %4d queries %5d found %6d mismatched\n", numQueries, numFound, numBruteBad );
+    printf( "overlaps/batch %4d queries %5d found %6d mismatched\n", numQueries, numFound, numBatchBad );
+
+    delete shapes[ 0 ];
+    delete shapes[ 1 ];
+    return numBruteBad + numBatchBad;
+}
+
+/*
+================================================================================================
+
+Volumes
+
+================================================================================================
+*/
+
+/*
+====================================================
+MakeFrustum
+
+Odd ones are orthographic, like the shadow camera's
+====================================================
+*/
+static frustum_t MakeFrustum( random_t & rng, const Bounds & area, const int i ) {
+    const Vec3 center = ( area.mins + area.maxs ) * 0.5f;
+    const float extent = ( area.maxs - area.mins ).GetMagnitude();
+
+    Vec3 pos;
+    Vec3 lookAt;
+    Vec3 dir;
+    do {
+        pos = center + rng.UnitVector() * rng.Float( 0.25f, 1.0f ) * extent;
+        lookAt = Vec3( rng.Float( area.mins.x, area.maxs.x ), rng.Float( area.mins.y, area.maxs.y ), rng.Float( area.mins.z, area.maxs.z ) );
+        dir = lookAt - pos;
+    } while ( dir.GetMagnitude() < 0.1f || fabsf( dir.z ) > 0.95f * dir.GetMagnitude() );
+
+    Mat4 matView;
+    matView.LookAt( pos, lookAt, Vec3( 0, 0, 1 ) );
+
+    Mat4 matProj;
+    if ( i & 1 ) {
+        const float size = rng.Float( 1.0f, 0.5f * extent );
+        matProj.OrthoVulkan( -size, size, -size, size, 0.0f, rng.Float( 1.0f, 2.0f ) * extent );
+    } else {
+        matProj.PerspectiveVulkan( rng.Float( 20.0f, 90.0f ), rng.Float( 1.0f, 2.0f ), 0.1f, rng.Float( 0.25f, 2.0f ) * extent );
+    }
+    return frustum_t( matProj, matView, ( i & 2 ) ? 1.0f : 0.0f );
+}
+
+/*
+====================================================
+CheckVolumes
+
+Against the world bounds of every live body.  The snapshot is captured
+after the scene's last step, so it culls at least the bodies the scene
+does, and exactly the ones whose bounds over both steps touch the frustum.
+====================================================
+*/
+static int CheckVolumes( Scene & scene, const int numQueries, const unsigned int seed ) {
+    random_t rng( seed );
+    const Bounds area = GetDynamicBounds( scene );
+
+    sceneSnapshot_t snapshot;
+    snapshot.CaptureBodies( scene );
+
+    int numBoxBad = 0;
+    int numFrustumBad = 0;
+    int numSnapshotBad = 0;
+    int numBoxFound = 0;
+    int numFrustumFound = 0;
+    int numSnapshotFound = 0;
+    std::vector< int > found;
+    std::vector< int > brute;
+    for ( int i = 0; i < numQueries; i++ ) {
+        Bounds box;
+        box.Expand( Vec3( rng.Float( area.mins.x, area.maxs.x ), rng.Float( area.mins.y, area.maxs.y ), rng.Float( area.mins.z, area.maxs.z ) ) );
+        box.Expand( box.mins + Vec3( rng.Float( 0.0f, 4.0f ), rng.Float( 0.0f, 4.0f ), rng.Float( 0.0f, 4.0f ) ) );
+        scene.QueryAABB( box, found );
+        brute.clear();
+        for ( int b = 0; b < scene.m_bodies.size(); b++ ) {
+            if ( scene.m_bodies.IsAlive( b ) && GetBodyBounds( scene.m_bodies[ b ] ).DoesIntersect( box ) ) {
+                brute.push_back( b );
+            }
+        }
+        numBoxFound += (int)found.size();
+        if ( found != brute ) {
+            if ( numBoxBad < 4 ) {
+                printf( "  aabb %d: found %d bodies, brute force %d\n", i, (int)found.size(), (int)brute.size() );
+            }
+            numBoxBad++;
+        }
+
+        const frustum_t frustum = MakeFrustum( rng, area, i );
+        scene.QueryFrustum( frustum, found );
+        brute.clear();
+        for ( int b = 0; b < scene.m_bodies.size(); b++ ) {
+            if ( scene.m_bodies.IsAlive( b ) && VOLUME_OUTSIDE != frustum.Classify( GetBodyBounds( scene.m_bodies[ b ] ) ) ) {
+                brute.push_back( b );
+            }
+        }
+        numFrustumFound += (int)found.size();
+        if ( found != brute ) {
+            if ( numFrustumBad < 4 ) {
+                printf( "  frustum %d: found %d bodies, brute force %d\n", i, (int)found.size(), (int)brute.size() );
+            }
+            numFrustumBad++;
+        }
+
+        const std::vector< int > sceneFound = found;
+        snapshot.QueryFrustum( frustum, found );
+        brute.clear();
+        for ( int b = 0; b < snapshot.GetNumBodies(); b++ ) {
+            if ( !snapshot.IsAlive( b ) ) {
+                continue;
+            }
+            const Shape * shape = scene.m_bodies[ b ].m_shape;
+            Bounds bounds = shape->GetBounds( snapshot.current[ b ].position, snapshot.current[ b ].orientation );
+            if ( b < (int)snapshot.previous.size() ) {
+                bounds.Expand( shape->GetBounds( snapshot.previous[ b ].position, snapshot.previous[ b ].orientation ) );
+            }
+            if ( VOLUME_OUTSIDE != frustum.Classify( bounds ) ) {
+                brute.push_back( b );
+            }
+        }
+        numSnapshotFound += (int)found.size();
+        if ( found != brute || !std::includes( found.begin(), found.end(), sceneFound.begin(), sceneFound.end() ) ) {
+            if ( numSnapshotBad < 4 ) {
+                printf( "  snapshot %d: found %d bodies, brute force %d, scene %d\n", i, (int)found.size(), (int)brute.size(), (int)sceneFound.size() );
+            }
+            numSnapshotBad++;
+        }
+    }
+    printf( "volumes/aabb     %4d queries %6d found %6d mismatched\n", numQueries, numBoxFound, numBoxBad );
+    printf( "volumes/frustum  %4d queries %6d found %6d mismatched\n", numQueries, numFrustumFound, numFrustumBad );
+    printf( "volumes/snapshot %4d queries %6d found %6d mismatched\n", numQueries, numSnapshotFound, numSnapshotBad );
+    return numBoxBad + numFrustumBad + numSnapshotBad;
+}
+
+/*
+====================================================
+main
+====================================================
+*/
+int main( int argc, char ** argv ) {
+    const char * preset = "pile_1k";
+    int numFrames = 60;
+    int numQueries = 4096;
+    unsigned int seed = 1;
+
+    for ( int i = 1; i < argc; i++ ) {
+        const bool hasValue = ( i + 1 < argc );
+        if ( 0 == strcmp( argv[ i ], "--scene" ) && hasValue ) {
+            preset = argv[ ++i ];
+        } else if ( 0 == strcmp( argv[ i ], "--frames" ) && hasValue ) {
+            numFrames = atoi( argv[ ++i ] );
+        } else if ( 0 == strcmp( argv[ i ], "--queries" ) && hasValue ) {
+            numQueries = atoi( argv[ ++i ] );
+        } else if ( 0 == strcmp( argv[ i ], "--seed" ) && hasValue ) {
+            seed = (unsigned int)strtoul( argv[ ++i ], NULL, 10 );
+        } else {
+            fprintf( stderr, "usage: %s [--scene name] [--frames N] [--queries N] [--seed N]\n", argv[ 0 ] );
+            return 1;
+        }
+    }
+
+    FillDiamond();
+
+    Scene scene;
+    if ( !scene.SetPreset( preset ) ) {
+        fprintf( stderr, "unknown scene preset '%s'\n", preset );
+        return 1;
+    }
+    scene.Reset();
+    for ( int frame = 0; frame < numFrames; frame++ ) {
+        scene.Update( 1.0f / 60.0f );
+    }
+    printf( "'%s' after %d frames, %d bodies\n", preset, numFrames, scene.m_bodies.GetNumAlive() );
+
+    int numMismatches = 0;
+    numMismatches += CheckRays( scene, numQueries, seed );
+    numMismatches += CheckKnownCasts();
+    numMismatches += CheckShapeCasts( scene, numQueries / 4, seed );
+    numMismatches += CheckOverlaps( scene, numQueries / 4, seed );
+    numMismatches += CheckVolumes( scene, numQueries / 4, seed );
+
+    printf( "%d mismatch(es)\n", numMismatches );
+    return ( 0 == numMismatches ) ? 0 : 1;
+}
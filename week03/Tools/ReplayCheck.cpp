@@ -0,0 +1,183 @@
+//
+//  ReplayCheck.cpp
+//
+//  Records a scene preset being poked at into a replay log, or replays a
+//  log and reports where it stops matching.  Checking with more than one
+//  thread replays the log on all of them at once, every one must match.
+//
+//  usage: week03_replay_check record [--scene name] [--frames N] [--dt seconds] [--seed N] --out file
+//         week03_replay_check check file [--threads N]
+//      record spawns a body every 30 frames and kicks a random dynamic body every 10
+//
+#include "Replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+/*
+====================================================
+Random
+
+A small LCG, the same numbers on every platform
+====================================================
+*/
+static unsigned int Random( unsigned int & seed ) {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+static float RandomFloat( unsigned int & seed, const float min, const float max ) {
+    return min + ( max - min ) * (float)( Random( seed ) & 0xffff ) / 65535.0f;
+}
+
+/*
+====================================================
+Record
+====================================================
+*/
+static int Record( const char * preset, const int numFrames, const float dt, unsigned int seed, const char * outPath ) {
+    Scene scene;
+    if ( !scene.SetPreset( preset ) ) {
+        fprintf( stderr, "unknown scene preset '%s'\n", preset );
+        return 1;
+    }
+    scene.Reset();
+
+    ReplayRecorder recorder;
+    recorder.Begin( scene );
+    for ( int frame = 0; frame < numFrames; frame++ ) {
+        if ( 0 == frame % 30 ) {
+            replaySpawn_t spawn;
+            spawn.shape = ( Random( seed ) & 1 ) ? replaySpawn_t::SPAWN_BOX : replaySpawn_t::SPAWN_SPHERE;
+            spawn.size = Vec3( RandomFloat( seed, 0.25f, 0.75f ), RandomFloat( seed, 0.25f, 0.75f ), RandomFloat( seed, 0.25f, 0.75f ) );
+            spawn.position = Vec3( RandomFloat( seed, -5.0f, 5.0f ), RandomFloat( seed, -5.0f, 5.0f ), RandomFloat( seed, 10.0f, 15.0f ) );
+            spawn.linearVelocity = Vec3( 0, 0, RandomFloat( seed, -20.0f, 0.0f ) );
+            recorder.Spawn( scene, spawn );
+        }
+
+        if ( 0 == frame % 10 && scene.m_bodies.size() > 0 ) {
+            const int body = (int)( Random( seed ) % (unsigned int)scene.m_bodies.size() );
+            if ( scene.m_bodies.IsAlive( body ) && scene.m_bodies[ body ].m_invMass > 0.0f ) {
+                const float mass = 1.0f / scene.m_bodies[ body ].m_invMass;
+                const Vec3 kick = Vec3( RandomFloat( seed, -1.0f, 1.0f ), RandomFloat( seed, -1.0f, 1.0f ), 1.0f ) * mass * 5.0f;
+                recorder.ApplyImpulse( scene, body, scene.m_bodies[ body ].GetCenterOfMassWorldSpace(), kick );
+            }
+        }
+
+        recorder.Update( scene, dt );
+    }
+
+    if ( !recorder.GetLog().Save( outPath ) ) {
+        fprintf( stderr, "couldn't write '%s'\n", outPath );
+        return 1;
+    }
+    printf( "recorded %d steps of '%s' to %s\n", numFrames, preset, outPath );
+    return 0;
+}
+
+/*
+====================================================
+Check
+====================================================
+*/
+static int Check( const char * path, const int numThreads ) {
+    replayLog_t log;
+    if ( !log.Load( path ) ) {
+        fprintf( stderr, "couldn't read replay '%s'\n", path );
+        return 1;
+    }
+
+    std::vector< replayCheck_t > results( numThreads );
+    std::vector< std::thread > threads;
+    for ( int i = 1; i < numThreads; i++ ) {
+        threads.push_back( std::thread( [ &log, &results, i ]() { results[ i ] = CheckReplay( log ); } ) );
+    }
+    results[ 0 ] = CheckReplay( log );
+    for ( int i = 0; i < threads.size(); i++ ) {
+        threads[ i ].join();
+    }
+
+    bool isDiverged = false;
+    for ( int i = 0; i < numThreads; i++ ) {
+        const replayCheck_t & result = results[ i ];
+        if ( !result.isDiverged ) {
+            printf( "replay %d: matched all %d steps of '%s'\n", i, result.numStepsRun, log.preset.c_str() );
+            continue;
+        }
+
+        isDiverged = true;
+        if ( result.step < 0 ) {
+            printf( "replay %d: diverged before the first step, body %d\n", i, result.body );
+        } else {
+            printf( "replay %d: diverged at step %d, body %d\n", i, result.step, result.body );
+        }
+    }
+    return isDiverged ? 1 : 0;
+}
+
+/*
+====================================================
+main
+====================================================
+*/
+int main( int argc, char ** argv ) {
+    const char * usage = "usage: %s record [--scene name] [--frames N] [--dt seconds] [--seed N] --out file\n"
+                         "       %s check file [--threads N]\n";
+    if ( argc < 2 ) {
+        fprintf( stderr, usage, argv[ 0 ], argv[ 0 ] );
+        return 1;
+    }
+
+    FillDiamond();
+
+    if ( 0 == strcmp( argv[ 1 ], "record" ) ) {
+        const char * preset = "default";
+        const char * outPath = NULL;
+        int numFrames = 300;
+        float dt = 1.0f / 60.0f;
+        unsigned int seed = 1;
+        for ( int i = 2; i < argc; i++ ) {
+            const bool hasValue = ( i + 1 < argc );
+            if ( 0 == strcmp( argv[ i ], "--scene" ) && hasValue ) {
+                preset = argv[ ++i ];
+            } else if ( 0 == strcmp( argv[ i ], "--frames" ) && hasValue ) {
+                numFrames = atoi( argv[ ++i ] );
+            } else if ( 0 == strcmp( argv[ i ], "--dt" ) && hasValue ) {
+                dt = (float)atof( argv[ ++i ] );
+            } else if ( 0 == strcmp( argv[ i ], "--seed" ) && hasValue ) {
+                seed = (unsigned int)atoi( argv[ ++i ] );
+            } else if ( 0 == strcmp( argv[ i ], "--out" ) && hasValue ) {
+                outPath = argv[ ++i ];
+            } else {
+                outPath = NULL;
+                break;
+            }
+        }
+        if ( NULL == outPath ) {
+            fprintf( stderr, usage, argv[ 0 ], argv[ 0 ] );
+            return 1;
+        }
+        return Record( preset, numFrames, dt, seed, outPath );
+    }
+
+    if ( 0 == strcmp( argv[ 1 ], "check" ) && argc >= 3 ) {
+        int numThreads = 1;
+        for ( int i = 3; i < argc; i++ ) {
+            if ( 0 == strcmp( argv[ i ], "--threads" ) && i + 1 < argc ) {
+                numThreads = atoi( argv[ ++i ] );
+            } else {
+                fprintf( stderr, usage, argv[ 0 ], argv[ 0 ] );
+                return 1;
+            }
+        }
+        if ( numThreads < 1 ) {
+            numThreads = 1;
+        }
+        return Check( argv[ 2 ], numThreads );
+    }
+
+    fprintf( stderr, usage, argv[ 0 ], argv[ 0 ] );
+    return 1;
+}
@@ -0,0 +1,369 @@
+//
+//  SettleCheck.cpp
+//
+//  Drops bodies onto static ground of every kind and checks that they come
+//  to rest on its surface, neither sunk into it nor hovering, and that
+//  none of them fell through.  Exits with 1 when any of them didn't.
+//
+//  usage: week03_settle_check [--frames N]
+//      drops: a sphere, a box, a diamond hull and a dumbbell, each let go tilted just
+//          above the ground and thrown straight down at it fast enough to need
+//          a time of impact, onto a box, a triangle mesh and a heightfield
+//      crossed: a dumbbell dropped across another has to come to rest on it,
+//          stepped twice as long
+//      piles: the mesh and terrain presets stepped twice as long, no body may
+//          end up under the ground, and no more may still be moving than
+//          in the shapes preset, the same pile on a box.  The compound
+//          preset's dumbbells all have to settle on a box.
+//
+#include "Scene.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+/*
+====================================================
+GetLowestPoint
+====================================================
+*/
+static Vec3 GetLowestPoint( const Body & body ) {
+    return body.m_shape->Support( Vec3( 0, 0, -1 ), body.m_position, body.m_orientation, 0.0f );
+}
+
+/*
+====================================================
+IsAtRest
+
+Nothing slows a rolling sphere down, so spheres, and dumbbells rolling on
+theirs, only count as moving while they bounce
+====================================================
+*/
+static bool IsAtRest( const Body & body, const float maxSpeed ) {
+    const Shape::shapeType_t type = body.m_shape->GetType();
+    if ( Shape::SHAPE_SPHERE == type || Shape::SHAPE_COMPOUND == type ) {
+        return fabsf( body.m_linearVelocity.z ) < maxSpeed;
+    }
+    return body.m_linearVelocity.GetMagnitude() < maxSpeed && body.m_angularVelocity.GetMagnitude() < maxSpeed;
+}
+
+/*
+====================================================
+GetGroundHeight
+
+The height of the ground body's surface under pt.  Heightfields are
+sampled finely enough that blending the four samples around pt is
+within a few millimetres of their triangles.
+====================================================
+*/
+static float GetGroundHeight( const Body & ground, const Vec3 & pt ) {
+    if ( Shape::SHAPE_HEIGHTFIELD != ground.m_shape->GetType() ) {
+        return ground.m_shape->GetBounds( ground.m_position, ground.m_orientation ).maxs.z;
+    }
+
+    const ShapeHeightfield * field = (const ShapeHeightfield *)ground.m_shape;
+    const Vec3 local = pt - ground.m_position;
+    const float fx = std::min( std::max( local.x / field->m_spacing, 0.0f ), (float)( field->m_numX - 1 ) );
+    const float fy = std::min( std::max( local.y / field->m_spacing, 0.0f ), (float)( field->m_numY - 1 ) );
+    const int x = std::min( (int)fx, field->m_numX - 2 );
+    const int y = std::min( (int)fy, field->m_numY - 2 );
+    const float u = fx - (float)x;
+    const float v = fy - (float)y;
+    const float h00 = field->GetPoint( x, y ).z;
+    const float h10 = field->GetPoint( x + 1, y ).z;
+    const float h01 = field->GetPoint( x, y + 1 ).z;
+    const float h11 = field->GetPoint( x + 1, y + 1 ).z;
+    const float height = ( h00 * ( 1.0f - u ) + h10 * u ) * ( 1.0f - v ) + ( h01 * ( 1.0f - u ) + h11 * u ) * v;
+    return ground.m_position.z + height;
+}
+
+/*
+================================================================================================
+
+Drops
+
+================================================================================================
+*/
+
+enum groundType_t {
+    GROUND_BOX,
+    GROUND_MESH,
+    GROUND_HEIGHTFIELD,
+    GROUND_NUM,
+};
+static const char * g_groundNames[ GROUND_NUM ] = { "box", "mesh", "heightfield" };
+
+enum dropType_t {
+    DROP_SPHERE,
+    DROP_BOX,
+    DROP_HULL,
+    DROP_DUMBBELL,
+    DROP_NUM,
+};
+static const char * g_dropNames[ DROP_NUM ] = { "sphere", "box", "hull", "dumbbell" };
+
+/*
+====================================================
+AddGround
+
+Every kind of ground is flat, with its surface at z = 0 and 100 units across
+====================================================
+*/
+static void AddGround( Scene & scene, const int type ) {
+    switch ( type ) {
+        case GROUND_BOX: {
+            Body body;
+            body.m_orientation = Quat( 0, 0, 0, 1 );
+            body.m_invMass = 0.0f;
+            body.m_elasticity = 0.5f;
+            body.m_friction = 0.5f;
+            body.m_shape = new ShapeBox( g_boxGround, sizeof( g_boxGround ) / sizeof( Vec3 ) );
+            scene.AddBody( body );
+        } break;
+        case GROUND_MESH: {
+            AddMeshGround( scene.m_bodies, Vec3( -50, -50, 0 ), 101, 101, 1.0f );
+        } break;
+        default: {
+            const std::vector< float > heights( 101 * 101, 0.0f );
+            Body body;
+            body.m_position = Vec3( -50, -50, 0 );
+            body.m_orientation = Quat( 0, 0, 0, 1 );
+            body.m_invMass = 0.0f;
+            body.m_elasticity = 0.5f;
+            body.m_friction = 0.5f;
+            body.m_shape = new ShapeHeightfield( heights.data(), 101, 101, 1.0f );
+            scene.AddBody( body );
+        } break;
+    }
+}
+
+/*
+====================================================
+MakeDropShape
+====================================================
+*/
+static Shape * MakeDropShape( const int type, const ShapeConvex & diamond ) {
+    switch ( type ) {
+        case DROP_SPHERE: return new ShapeSphere( 1.0f );
+        case DROP_BOX: return new ShapeBox( g_boxUnit, sizeof( g_boxUnit ) / sizeof( Vec3 ) );
+        case DROP_HULL: return new ShapeConvex( diamond );
+        default: return NewDumbbell();
+    }
+}
+
+/*
+====================================================
+CheckDrops
+
+Gentle drops have to come to rest within a few centimetres of the surface,
+which is about what the solver's slop lets them sink or bounce.  Fast ones
+land hard enough to be thrown about, on a box as much as on the others, so
+they only have to stay on top of the ground.
+====================================================
+*/
+static int CheckDrops( const int numFrames ) {
+    const float maxDepth = 0.05f;
+    const float maxSpeed = 0.05f;
+
+    const ShapeConvex diamond( g_diamond, sizeof( g_diamond ) / sizeof( Vec3 ) );
+
+    int numBad = 0;
+    for ( int ground = 0; ground < GROUND_NUM; ground++ ) {
+        for ( int drop = 0; drop < DROP_NUM; drop++ ) {
+            for ( int isFast = 0; isFast < 2; isFast++ ) {
+                Scene scene;
+                AddGround( scene, ground );
+
+                Body body;
+                body.m_position = isFast ? Vec3( 0.3f, 0.2f, 10.0f ) : Vec3( 0.3f, 0.2f, 2.0f );
+                body.m_orientation = Quat( Vec3( 1, 1, 0 ).Normalize(), 0.3f );
+                body.m_linearVelocity = isFast ? Vec3( 0, 0, -60.0f ) : Vec3( 0, 0, 0 );	// a unit per step, enough to turn on continuous collision
+                body.m_invMass = 1.0f;
+                body.m_elasticity = 0.0f;
+                body.m_friction = 0.5f;
+                body.m_shape = MakeDropShape( drop, diamond );
+                const int idx = scene.AddBody( body ).index;
+
+                // Until it's thrown off the edge, the body's center never goes under the surface
+                float lowestCenter = body.m_position.z;
+                for ( int frame = 0; frame < numFrames; frame++ ) {
+                    scene.Update( 1.0f / 60.0f );
+                    const Vec3 & pos = scene.m_bodies[ idx ].m_position;
+                    if ( fabsf( pos.x ) < 50.0f && fabsf( pos.y ) < 25.0f ) {
+                        lowestCenter = std::min( lowestCenter, pos.z );
+                    }
+                }
+
+                const Body & dropped = scene.m_bodies[ idx ];
+                const float height = GetLowestPoint( dropped ).z;
+                bool isRight = ( lowestCenter > 0.0f );
+                if ( !isFast ) {
+                    isRight = isRight && fabsf( height ) < maxDepth && IsAtRest( dropped, maxSpeed );
+                }
+                if ( !isRight ) {
+                    numBad++;
+                }
+                printf( "drops/%-11s %-6s %-6s lowest center %6.3f, end lowest %8.3f speed %6.3f spin %6.3f%s\n", g_groundNames[ ground ], g_dropNames[ drop ],
+                    isFast ? "fast" : "gentle", lowestCenter, height, dropped.m_linearVelocity.GetMagnitude(), dropped.m_angularVelocity.GetMagnitude(),
+                    isRight ? "" : ( isFast ? "  FELL THROUGH" : "  NOT SETTLED" ) );
+            }
+        }
+    }
+    return numBad;
+}
+
+/*
+====================================================
+CheckCrossed
+
+Compound against compound.  The top dumbbell lands with its bar across
+the bottom one's, its spheres clear of the ground, so it can only rest
+on the bottom dumbbell.  It rocks on the bar for a while before it does.
+====================================================
+*/
+static int CheckCrossed( const int numFrames ) {
+    const float maxDepth = 0.05f;
+    const float maxSpeed = 0.05f;
+
+    Scene scene;
+    AddGround( scene, GROUND_BOX );
+
+    Body body;
+    body.m_position = Vec3( 0, 0, 0.5f );
+    body.m_orientation = Quat( 0, 0, 0, 1 );
+    body.m_invMass = 1.0f;
+    body.m_elasticity = 0.0f;
+    body.m_friction = 0.5f;
+    body.m_shape = NewDumbbell();
+    const int bottomIdx = scene.AddBody( body ).index;
+
+    body.m_position = Vec3( 0, 0, 2.0f );
+    body.m_orientation = Quat( Vec3( 0, 0, 1 ), 3.1415f / 2.0f );
+    body.m_shape = NewDumbbell();
+    const int topIdx = scene.AddBody( body ).index;
+
+    for ( int frame = 0; frame < numFrames; frame++ ) {
+        scene.Update( 1.0f / 60.0f );
+    }
+
+    // Resting on the bottom bar puts the top one's center a bar's thickness above the bottom one's
+    const Body & bottom = scene.m_bodies[ bottomIdx ];
+    const Body & top = scene.m_bodies[ topIdx ];
+    const float gap = top.m_position.z - bottom.m_position.z - 0.3f;
+    const bool isRight = fabsf( gap ) < maxDepth && IsAtRest( top, maxSpeed ) && IsAtRest( bottom, maxSpeed );
+    printf( "crossed dumbbells    bottom z %6.3f, top z %6.3f, gap %6.3f speed %6.3f spin %6.3f%s\n", bottom.m_position.z, top.m_position.z, gap,
+        top.m_linearVelocity.GetMagnitude(), top.m_angularVelocity.GetMagnitude(), isRight ? "" : "  NOT SETTLED" );
+    return isRight ? 0 : 1;
+}
+
+/*
+================================================================================================
+
+Piles
+
+================================================================================================
+*/
+
+/*
+====================================================
+CheckPile
+
+Steps a preset whose only static body is its ground.  Returns how many
+bodies ended up under the ground, and how many are still moving.
+====================================================
+*/
+static void CheckPile( const char * preset, const int numFrames, int & numUnder, int & numMoving ) {
+    const float maxDepth = 0.1f;
+    const float maxSpeed = 0.1f;
+
+    Scene scene;
+    scene.SetPreset( preset );
+    scene.Reset();
+    for ( int frame = 0; frame < numFrames; frame++ ) {
+        scene.Update( 1.0f / 60.0f );
+    }
+
+    const Body * ground = NULL;
+    for ( int i = 0; i < scene.m_bodies.size(); i++ ) {
+        if ( scene.m_bodies.IsAlive( i ) && scene.m_bodies[ i ].IsStatic() && NULL == ground ) {
+            ground = &scene.m_bodies[ i ];
+        }
+    }
+
+    int numBodies = 0;
+    float deepest = 0.0f;
+    numUnder = 0;
+    numMoving = 0;
+    for ( int i = 0; i < scene.m_bodies.size(); i++ ) {
+        if ( !scene.m_bodies.IsAlive( i ) || scene.m_bodies[ i ].IsStatic() ) {
+            continue;
+        }
+        const Body & body = scene.m_bodies[ i ];
+        const Vec3 lowest = GetLowestPoint( body );
+        const float depth = GetGroundHeight( *ground, lowest ) - lowest.z;
+        deepest = std::max( deepest, depth );
+        numBodies++;
+        if ( depth > maxDepth ) {
+            numUnder++;
+        }
+        if ( !IsAtRest( body, maxSpeed ) ) {
+            numMoving++;
+        }
+    }
+    printf( "piles/%-8s %4d bodies %4d under the ground %4d moving, deepest %.3f\n", preset, numBodies, numUnder, numMoving, deepest );
+}
+
+/*
+====================================================
+CheckPiles
+
+The same pile of spheres, boxes and hulls on a mesh and on a heightfield
+has to settle at least as well as it does on a box
+====================================================
+*/
+static int CheckPiles( const int numFrames ) {
+    int numUnder;
+    int numBoxMoving;
+    CheckPile( "shapes", numFrames, numUnder, numBoxMoving );
+
+    int numBad = numUnder;
+    const char * presets[] = { "mesh", "terrain" };
+    for ( int i = 0; i < 2; i++ ) {
+        int numMoving;
+        CheckPile( presets[ i ], numFrames, numUnder, numMoving );
+        numBad += numUnder + std::max( numMoving - numBoxMoving, 0 );
+    }
+
+    int numMoving;
+    CheckPile( "compound", numFrames, numUnder, numMoving );
+    numBad += numUnder + numMoving;
+    return numBad;
+}
+
+/*
+====================================================
+main
+====================================================
+*/
+int main( int argc, char ** argv ) {
+    int numFrames = 600;
+    for ( int i = 1; i < argc; i++ ) {
+        if ( 0 == strcmp( argv[ i ], "--frames" ) && i + 1 < argc ) {
+            numFrames = atoi( argv[ ++i ] );
+        } else {
+            fprintf( stderr, "usage: %s [--frames N]\n", argv[ 0 ] );
+            return 1;
+        }
+    }
+
+    FillDiamond();
+
+    int numBad = 0;
+    numBad += CheckDrops( numFrames );
+    numBad += CheckCrossed( numFrames * 2 );
+    numBad += CheckPiles( numFrames * 2 );
+
+    printf( "%d unsettled\n", numBad );
+    return ( 0 == numBad ) ? 0 : 1;
+}
@@ -0,0 +1,135 @@
+//
+//  SnapshotCheck.cpp
+//
+//  Saves a stepped scene preset, steps it on, restores the save and steps
+//  it on again.  Both runs have to hash the same, bit for bit, after every
+//  step.  Then times Scene::SaveState and Scene::RestoreState.
+//
+//  usage: week03_snapshot_check [--scene name] [--warmup N] [--frames N] [--repeats N]
+//      warmup frames are stepped before the save, frames after it, both at 60hz
+//
+#include "Replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+/*
+====================================================
+StepAndHash
+
+The hash of the bodies after each of numFrames updates
+====================================================
+*/
+static void StepAndHash( Scene & scene, const int numFrames, std::vector< unsigned long long > & hashes ) {
+    std::vector< unsigned int > bodyHashes;
+    hashes.resize( numFrames );
+    for ( int frame = 0; frame < numFrames; frame++ ) {
+        scene.Update( 1.0f / 60.0f );
+        hashes[ frame ] = HashBodies( scene.m_bodies, bodyHashes );
+    }
+}
+
+/*
+====================================================
+GetMicroseconds
+====================================================
+*/
+static double GetMicroseconds( const std::chrono::steady_clock::time_point & start ) {
+    return std::chrono::duration< double, std::micro >( std::chrono::steady_clock::now() - start ).count();
+}
+
+/*
+====================================================
+main
+====================================================
+*/
+int main( int argc, char ** argv ) {
+    const char * preset = "pile_1k";
+    int numWarmup = 60;
+    int numFrames = 60;
+    int numRepeats = 200;
+
+    for ( int i = 1; i < argc; i++ ) {
+        const bool hasValue = ( i + 1 < argc );
+        if ( 0 == strcmp( argv[ i ], "--scene" ) && hasValue ) {
+            preset = argv[ ++i ];
+        } else if ( 0 == strcmp( argv[ i ], "--warmup" ) && hasValue ) {
+            numWarmup = atoi( argv[ ++i ] );
+        } else if ( 0 == strcmp( argv[ i ], "--frames" ) && hasValue ) {
+            numFrames = atoi( argv[ ++i ] );
+        } else if ( 0 == strcmp( argv[ i ], "--repeats" ) && hasValue ) {
+            numRepeats = atoi( argv[ ++i ] );
+        } else {
+            fprintf( stderr, "usage: %s [--scene name] [--warmup N] [--frames N] [--repeats N]\n", argv[ 0 ] );
+            return 1;
+        }
+    }
+    if ( numRepeats < 1 ) {
+        numRepeats = 1;
+    }
+
+    FillDiamond();
+
+    Scene scene;
+    if ( !scene.SetPreset( preset ) ) {
+        fprintf( stderr, "unknown scene preset '%s'\n", preset );
+        return 1;
+    }
+    scene.Reset();
+    for ( int frame = 0; frame < numWarmup; frame++ ) {
+        scene.Update( 1.0f / 60.0f );
+    }
+
+    std::vector< unsigned int > bodyHashes;
+    const unsigned long long savedHash = HashBodies( scene.m_bodies, bodyHashes );
+    sceneState_t state;
+    scene.SaveState( state );
+    printf( "'%s' after %d frames, %d bodies, %d manifolds, %.1f KB saved\n", preset, numWarmup,
+        scene.m_bodies.GetNumAlive(), (int)state.manifolds.manifolds.size(), state.GetNumBytes() / 1024.0 );
+
+    //
+    //	save -> step -> restore -> step
+    //
+    std::vector< unsigned long long > firstHashes;
+    std::vector< unsigned long long > secondHashes;
+    StepAndHash( scene, numFrames, firstHashes );
+
+    if ( !scene.RestoreState( state ) ) {
+        printf( "RestoreState failed\n" );
+        return 1;
+    }
+    if ( HashBodies( scene.m_bodies, bodyHashes ) != savedHash ) {
+        printf( "restored bodies don't match the save\n" );
+        return 1;
+    }
+    StepAndHash( scene, numFrames, secondHashes );
+
+    for ( int frame = 0; frame < numFrames; frame++ ) {
+        if ( firstHashes[ frame ] != secondHashes[ frame ] ) {
+            printf( "diverged %d frames after the restore\n", frame + 1 );
+            return 1;
+        }
+    }
+    printf( "matched all %d frames after the restore\n", numFrames );
+
+    //
+    //	Timing, the scene is back where it was saved so every restore only copies
+    //
+    scene.RestoreState( state );
+    double saveUS = 0.0;
+    double restoreUS = 0.0;
+    for ( int i = 0; i < numRepeats; i++ ) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        scene.SaveState( state );
+        saveUS += GetMicroseconds( start );
+
+        start = std::chrono::steady_clock::now();
+        scene.RestoreState( state );
+        restoreUS += GetMicroseconds( start );
+    }
+    printf( "SaveState    %8.2f us\n", saveUS / numRepeats );
+    printf( "RestoreState %8.2f us\n", restoreUS / numRepeats );
+    return 0;
+}